@@ -0,0 +1,110 @@
+/*
+ * vonsh-arenabench: cost of an arena tick against the number of snakes. All
+ * snakes are bots, a snake that dies is spawned again right away. Reports
+ * time per tick of the arena step itself and of the bots deciding, average
+ * length of the snakes and how they died. The fullscreen board is 1920x1080
+ * pixels in tiles of the game, the large one 3840x2160. First checks for a
+ * while that bodies, board and the sets of fields stay consistent.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim_arena.h"
+
+#define MIN_BENCH_NS (300000000LL) /* minimum measured time per case */
+#define MIN_TICKS (200) /* ticks measured at least, also after warm up */
+#define SPAWN_LENGTH (4)
+#define TICK_BUDGET_US (1000.0) /* what a tick may cost */
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void fail(const char *what, int s, uint32_t tick) {
+    fprintf(stderr, "Arena inconsistent at tick %u: %s (snake %d)\n", tick, what, s);
+    exit(1);
+}
+
+/* Walks every body from tail to head and accounts for every field */
+static void check(const SimArena *a) {
+    long snake_cells = 0;
+    for (int s = 0; s < a->n; s++) {
+        if (!a->alive[s]) continue;
+        int x = a->tx[s], y = a->ty[s];
+        for (int k = 0; k < a->length[s]; k++) {
+            if (x < 0 || y < 0 || x >= a->w || y >= a->h) fail("body leaves the board", s, a->tick);
+            int c = a->w * y + x;
+            if (a->cell[c] != s + 1) fail("body field of somebody else", s, a->tick);
+            if (k == a->length[s] - 1 && (x != a->hx[s] || y != a->hy[s])) fail("body does not end at head", s, a->tick);
+            x += sim_arena_link_dx(a->link[c]);
+            y += sim_arena_link_dy(a->link[c]);
+        }
+        snake_cells += a->length[s];
+    }
+    if (snake_cells + a->free_count + a->food_count != (long)a->w * a->h) fail("fields unaccounted for", -1, a->tick);
+    for (int i = 0; i < a->free_count; i++) {
+        if (a->cell[a->free_cells[i]] != 0 || a->slot[a->free_cells[i]] != i) fail("empty field set", -1, a->tick);
+    }
+    for (int i = 0; i < a->food_count; i++) {
+        if (a->cell[a->food_cells[i]] != SIM_ARENA_FOOD || a->slot[a->food_cells[i]] != i) fail("food set", -1, a->tick);
+    }
+}
+
+static void run_case(int w, int h, int n) {
+    SimArena a;
+    SimInput *in = malloc((size_t)n * sizeof(SimInput));
+    if (in == NULL || !sim_arena_init(&a, n, w, h)) {
+        fprintf(stderr, "Out of memory for %d snakes\n", n);
+        exit(1);
+    }
+    sim_arena_reset(&a, 1);
+    for (int s = 0; s < n; s++) sim_arena_spawn(&a, s, SPAWN_LENGTH);
+    for (int t = 0; t < MIN_TICKS; t++) { /* warm up: let the snakes grow and spread */
+        for (int s = 0; s < n; s++) in[s] = a.alive[s] ? sim_arena_bot_input(&a, s) : SimInputNone;
+        sim_arena_step(&a, in);
+        for (int s = 0; s < n; s++) if (!a.alive[s]) sim_arena_spawn(&a, s, SPAWN_LENGTH);
+        check(&a);
+    }
+    a.head_on = a.crashed = 0;
+
+    long long step_ns = 0, bot_ns = 0, ticks = 0, alive = 0, length = 0;
+    while (step_ns + bot_ns < MIN_BENCH_NS || ticks < MIN_TICKS) {
+        long long t0 = now_ns();
+        for (int s = 0; s < n; s++) in[s] = a.alive[s] ? sim_arena_bot_input(&a, s) : SimInputNone;
+        long long t1 = now_ns();
+        sim_arena_step(&a, in);
+        long long t2 = now_ns();
+        bot_ns += t1 - t0;
+        step_ns += t2 - t1;
+        ticks++;
+        for (int s = 0; s < n; s++) {
+            if (a.alive[s]) {
+                alive++;
+                length += a.length[s];
+            }
+            else sim_arena_spawn(&a, s, SPAWN_LENGTH);
+        }
+    }
+    double step_us = step_ns / 1e3 / ticks;
+    printf("%4dx%-5d %6d %10.2f %10.2f %9.1f %10.2f %10.2f  %s\n", w, h, n, step_us, bot_ns / 1e3 / ticks,
+           (double)length / alive, (double)a.crashed / ticks, (double)a.head_on / ticks,
+           step_us < TICK_BUDGET_US ? "ok" : "OVER BUDGET");
+    free(in);
+    sim_arena_free(&a);
+}
+
+int main(void) {
+    static const int boards[][2] = { {1920 / 16, 1080 / 16 - 1}, {3840 / 16, 2160 / 16 - 1} };
+    static const int counts[] = { 1, 4, 16, 64, 256, 1024 };
+
+    printf("%-10s %6s %10s %10s %9s %10s %10s\n", "board", "snakes", "step us", "bots us", "length",
+           "crash/t", "head-on/t");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+            run_case(boards[b][0], boards[b][1], counts[c]);
+        }
+    }
+    return 0;
+}
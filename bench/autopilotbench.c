@@ -0,0 +1,131 @@
+/*
+ * vonsh-autopilotbench: decision time of the autopilot controller. On boards
+ * of several sizes the autopilot plays games for a while, with its distance
+ * field to the food kept up to date either
+ *   incremental - from the changes in the board journal, or
+ *   full        - by a BFS over the whole board after every change.
+ * Reports mean and worst CPU time of a single decision against the 50 ms tick of
+ * the game, fields visited per tick on average and at worst (which, unlike the
+ * time, does not depend on the machine), and checks the incremental field
+ * against a full one. Fails when the worst incremental decision takes more
+ * than DECIDE_BUDGET_NS.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "sim_controller.h"
+
+#define MIN_BENCH_NS (300000000LL) /* minimum measured time per case */
+#define TICK_NS (50000000LL) /* RENDER_INTERVAL of the game */
+#define DECIDE_BUDGET_NS (TICK_NS / 10) /* share of the tick a decision may take */
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* CPU time of this thread, so that the worst decision is not one the thread was preempted in */
+static long long cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+typedef struct Result {
+    long ticks, games, score;
+    double mean_ns, max_ns;
+    double visited; /* fields visited per tick */
+    long max_visited; /* fields visited in the worst tick */
+} Result;
+
+static void run_mode(int w, int h, bool incremental, Result *res) {
+    SimContext ctx;
+    SimAutopilot ap;
+    if (!sim_init(&ctx, w, h) || !sim_autopilot_init(&ap, w, h)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    ap.incremental = incremental;
+    SimController controller = sim_autopilot_controller(&ap);
+    uint64_t seed = 1;
+    sim_reset(&ctx, seed);
+
+    memset(res, 0, sizeof(*res));
+    long long total = 0, start = now_ns();
+    while (now_ns() - start < MIN_BENCH_NS) {
+        long visited = ap.fields_visited;
+        long long t0 = cpu_ns();
+        SimInput input = sim_controller_decide(&controller, &ctx);
+        long long t = cpu_ns() - t0;
+        total += t;
+        if (t > res->max_ns) res->max_ns = t;
+        if (ap.fields_visited - visited > res->max_visited) res->max_visited = ap.fields_visited - visited;
+        sim_step(&ctx, input, NULL);
+        res->ticks++;
+        if (!ctx.alive) {
+            res->games++;
+            res->score += ctx.score;
+            sim_reset(&ctx, ++seed);
+        }
+    }
+    res->mean_ns = (double)total / res->ticks;
+    res->visited = (double)ap.fields_visited / res->ticks;
+    if (res->games == 0) { /* still the first game */
+        res->games = 1;
+        res->score = ctx.score;
+    }
+
+    if (incremental) {
+        SimAutopilot check;
+        if (!sim_autopilot_init(&check, w, h)) {
+            fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+            exit(1);
+        }
+        check.incremental = false;
+        /* work left over for later ticks is finished first */
+        do sim_autopilot_update(&ap, &ctx);
+        while (ap.rebuilding || ap.cursor != ctx.journal_seq);
+        sim_autopilot_update(&check, &ctx);
+        if (memcmp(ap.dist, check.dist, (size_t)ap.stride * (h + 2) * sizeof(int32_t)) != 0) {
+            fprintf(stderr, "Incremental distance field differs from a full one\n");
+            exit(1);
+        }
+        sim_autopilot_free(&check);
+    }
+    sim_autopilot_free(&ap);
+    sim_free(&ctx);
+}
+
+/* Returns false when the incremental worst case is over budget */
+static bool run_case(int w, int h) {
+    static const char *names[2] = { "full", "incremental" };
+    bool ok = true;
+    for (int m = 0; m < 2; m++) {
+        Result r;
+        run_mode(w, h, m == 1, &r);
+        if (m == 1 && r.max_ns > DECIDE_BUDGET_NS) ok = false;
+        printf("%5dx%-5d %-12s %8ld %9.1f %11.1f %11ld %10.3f %10.3f %8.2f%%\n", w, h, names[m], r.ticks,
+               (double)r.score / r.games, r.visited, r.max_visited, r.mean_ns / 1000, r.max_ns / 1000,
+               100.0 * r.max_ns / TICK_NS);
+    }
+    return ok;
+}
+
+int main(void) {
+    static const int boards[][2] = { {64, 64}, {240, 130}, {512, 512}, {1024, 1024} };
+
+    printf("%-11s %-12s %8s %9s %11s %11s %10s %10s %9s\n", "board", "update", "ticks", "score",
+           "visited/tk", "worst vis", "mean us", "worst us", "of tick");
+    int rc = 0;
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        if (!run_case(boards[b][0], boards[b][1])) {
+            fprintf(stderr, "%dx%d: incremental decision over the budget of %.0f%% of the tick\n",
+                    boards[b][0], boards[b][1], 100.0 * DECIDE_BUDGET_NS / TICK_NS);
+            rc = 1;
+        }
+    }
+    return rc;
+}
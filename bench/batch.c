@@ -0,0 +1,316 @@
+/*
+ * vonsh-batch: plays many independent games driven by the autopilot, for
+ * studies of score distribution over board sizes and growth rules.
+ * Every combination of board size and growth rule plays the given number of
+ * games with seeds 1, 2, 3... Games run on all cores: every worker starts
+ * with its own share of games and, once done, steals half of the games left
+ * to the busiest other worker.
+ * Prints statistics per combination as CSV, and optionally every game too.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sim.h"
+#include "sim_controller.h"
+
+#define MAX_CONFIGS (64) /* combinations of board size and growth rule */
+#define MAX_THREADS (256)
+#define TICK_S (0.05) /* RENDER_INTERVAL of the game */
+
+typedef struct Config {
+    int w, h;
+    int growth; /* see SimContext.growth */
+} Config;
+
+typedef struct GameResult {
+    int config;
+    uint64_t seed;
+    int score, length;
+    uint32_t ticks;
+    bool cut; /* stopped at max_ticks while still alive */
+    double cpu_ms;
+} GameResult;
+
+typedef struct Worker { /* games [next, end) not taken yet */
+    pthread_mutex_t lock;
+    long next, end;
+    long stolen; /* games taken over from other workers */
+    pthread_t thread;
+} Worker;
+
+static Config configs[MAX_CONFIGS];
+static int config_count;
+static long games_per_config = 1000;
+static uint32_t max_ticks = 1000000;
+static GameResult *results;
+static Worker workers[MAX_THREADS];
+static int worker_count;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+/* Takes the next game of worker w, -1 if it has none left */
+static long take_own(Worker *w) {
+    long game = -1;
+    pthread_mutex_lock(&w->lock);
+    if (w->next < w->end) game = w->next++;
+    pthread_mutex_unlock(&w->lock);
+    return game;
+}
+
+/* Moves the upper half of the games left to the worker with most of them over to self */
+static bool steal(Worker *self) {
+    for (;;) {
+        Worker *victim = NULL;
+        long most = 0;
+        for (int i = 0; i < worker_count; i++) {
+            Worker *w = &workers[i];
+            if (w == self) continue;
+            pthread_mutex_lock(&w->lock);
+            long left = w->end - w->next;
+            pthread_mutex_unlock(&w->lock);
+            if (left > most) {
+                most = left;
+                victim = w;
+            }
+        }
+        if (victim == NULL) return false;
+
+        long from = 0, to = 0;
+        pthread_mutex_lock(&victim->lock); /* it may have run out in the meantime */
+        long left = victim->end - victim->next;
+        if (left > 0) {
+            to = victim->end;
+            from = to - (left + 1) / 2;
+            victim->end = from;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (from < to) {
+            pthread_mutex_lock(&self->lock);
+            self->next = from;
+            self->end = to;
+            self->stolen += to - from;
+            pthread_mutex_unlock(&self->lock);
+            return true;
+        }
+    }
+}
+
+static void play_game(SimContext *ctx, SimAutopilot *ap, long game) {
+    GameResult *r = &results[game];
+    r->config = (int)(game / games_per_config);
+    r->seed = (uint64_t)(game % games_per_config) + 1;
+
+    double start = now_ms();
+    SimController controller = sim_autopilot_controller(ap);
+    sim_reset(ctx, r->seed);
+    while (ctx->alive && ctx->tick < max_ticks) {
+        sim_step(ctx, sim_controller_decide(&controller, ctx), NULL);
+    }
+    r->cpu_ms = now_ms() - start;
+    r->score = ctx->score;
+    r->length = ctx->length;
+    r->ticks = ctx->tick;
+    r->cut = ctx->alive;
+}
+
+static void *worker_main(void *arg) {
+    Worker *self = arg;
+    SimContext ctx;
+    SimAutopilot ap;
+    int config = -1;
+
+    for (;;) {
+        long game = take_own(self);
+        if (game < 0) {
+            if (!steal(self)) break;
+            continue;
+        }
+        int c = (int)(game / games_per_config);
+        if (c != config) { /* games of one config are contiguous, so this is rare */
+            if (config >= 0) {
+                sim_autopilot_free(&ap);
+                sim_free(&ctx);
+            }
+            if (!sim_init(&ctx, configs[c].w, configs[c].h) ||
+                !sim_autopilot_init(&ap, configs[c].w, configs[c].h)) {
+                fprintf(stderr, "Out of memory for %dx%d board\n", configs[c].w, configs[c].h);
+                exit(1);
+            }
+            ctx.growth = configs[c].growth;
+            config = c;
+        }
+        play_game(&ctx, &ap, game);
+    }
+    if (config >= 0) {
+        sim_autopilot_free(&ap);
+        sim_free(&ctx);
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void *pa, const void *pb) {
+    double a = *(const double *)pa, b = *(const double *)pb;
+    return (a > b) - (a < b);
+}
+
+/* Value below which share p of sorted v[0..n) lies */
+static double percentile(const double *v, long n, double p) {
+    long i = (long)(p * (n - 1) + 0.5);
+    return v[i];
+}
+
+static void print_summary(FILE *out) {
+    double *v = malloc((size_t)games_per_config * sizeof(double));
+    if (v == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    fprintf(out, "w,h,growth,games,cut,"
+                 "score_mean,score_sd,score_min,score_p10,score_p50,score_p90,score_max,"
+                 "length_mean,length_p50,length_max,"
+                 "ticks_mean,ticks_p50,ticks_max,minutes_mean,cpu_ms_mean\n");
+    for (int c = 0; c < config_count; c++) {
+        const GameResult *r = &results[c * games_per_config];
+        long n = games_per_config, cut = 0;
+        double sum = 0, sum2 = 0, length_sum = 0, ticks_sum = 0, cpu_sum = 0;
+        for (long g = 0; g < n; g++) {
+            sum += r[g].score;
+            sum2 += (double)r[g].score * r[g].score;
+            length_sum += r[g].length;
+            ticks_sum += r[g].ticks;
+            cpu_sum += r[g].cpu_ms;
+            cut += r[g].cut;
+        }
+        double mean = sum / n, var = sum2 / n - mean * mean;
+        fprintf(out, "%d,%d,%d,%ld,%ld,", configs[c].w, configs[c].h, configs[c].growth, n, cut);
+
+        for (long g = 0; g < n; g++) v[g] = r[g].score;
+        qsort(v, n, sizeof(double), compare_doubles);
+        fprintf(out, "%.2f,%.2f,%.0f,%.0f,%.0f,%.0f,%.0f,", mean, var > 0 ? sqrt(var) : 0.0, v[0],
+                percentile(v, n, 0.1), percentile(v, n, 0.5), percentile(v, n, 0.9), v[n - 1]);
+
+        for (long g = 0; g < n; g++) v[g] = r[g].length;
+        qsort(v, n, sizeof(double), compare_doubles);
+        fprintf(out, "%.2f,%.0f,%.0f,", length_sum / n, percentile(v, n, 0.5), v[n - 1]);
+
+        for (long g = 0; g < n; g++) v[g] = r[g].ticks;
+        qsort(v, n, sizeof(double), compare_doubles);
+        fprintf(out, "%.1f,%.0f,%.0f,%.2f,%.3f\n", ticks_sum / n, percentile(v, n, 0.5), v[n - 1],
+                ticks_sum / n * TICK_S / 60, cpu_sum / n);
+    }
+    free(v);
+}
+
+static void print_games(FILE *out) {
+    fprintf(out, "w,h,growth,seed,score,length,ticks,cut,cpu_ms\n");
+    for (long g = 0; g < config_count * games_per_config; g++) {
+        const GameResult *r = &results[g];
+        const Config *c = &configs[r->config];
+        fprintf(out, "%d,%d,%d,%llu,%d,%d,%u,%d,%.3f\n", c->w, c->h, c->growth,
+                (unsigned long long)r->seed, r->score, r->length, r->ticks, r->cut, r->cpu_ms);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [-n GAMES] [-b WxH[,WxH...]] [-g GROWTH[,GROWTH...]] [-j THREADS] [-t MAX_TICKS] [-o FILE]\n"
+        "  -n  games per board size and growth rule (default 1000)\n"
+        "  -b  board sizes (default 28x28,64x64)\n"
+        "  -g  segments grown per food, 0 = current score as in the game (default 0)\n"
+        "  -j  worker threads (default: all cores)\n"
+        "  -t  games still running after that many ticks are stopped (default 1000000)\n"
+        "  -o  also write every single game to FILE as CSV\n"
+        "Statistics per board size and growth rule are written to stdout as CSV.\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *boards = "28x28,64x64", *growths = "0", *games_path = NULL;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:g:j:t:o:h")) != -1) {
+        switch (opt) {
+            case 'n': games_per_config = atol(optarg); break;
+            case 'b': boards = optarg; break;
+            case 'g': growths = optarg; break;
+            case 'j': threads = atol(optarg); break;
+            case 't': max_ticks = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'o': games_path = optarg; break;
+            default: usage(argv[0]); return opt != 'h';
+        }
+    }
+    if (games_per_config < 1 || threads < 1 || max_ticks < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+
+    /* every board size with every growth rule */
+    for (const char *b = boards; *b; b += strcspn(b, ",") + (b[strcspn(b, ",")] == ',')) {
+        int w, h;
+        if (sscanf(b, "%dx%d", &w, &h) != 2 || w < 3 || h < 3) {
+            fprintf(stderr, "Invalid board size '%.*s'\n", (int)strcspn(b, ","), b);
+            return 1;
+        }
+        for (const char *g = growths; *g; g += strcspn(g, ",") + (g[strcspn(g, ",")] == ',')) {
+            if (config_count == MAX_CONFIGS) {
+                fprintf(stderr, "Too many combinations, at most %d\n", MAX_CONFIGS);
+                return 1;
+            }
+            configs[config_count].w = w;
+            configs[config_count].h = h;
+            configs[config_count].growth = atoi(g);
+            config_count++;
+        }
+    }
+
+    long total = config_count * games_per_config;
+    results = calloc((size_t)total, sizeof(GameResult));
+    if (results == NULL) {
+        fprintf(stderr, "Out of memory for %ld games\n", total);
+        return 1;
+    }
+    worker_count = threads < total ? (int)threads : (int)total;
+    for (int i = 0; i < worker_count; i++) {
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].next = total * i / worker_count;
+        workers[i].end = total * (i + 1) / worker_count;
+    }
+
+    double start = now_ms();
+    for (int i = 0; i < worker_count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Could not start worker thread\n");
+            return 1;
+        }
+    }
+    long stolen = 0;
+    for (int i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+        pthread_mutex_destroy(&workers[i].lock);
+        stolen += workers[i].stolen;
+    }
+    double elapsed = now_ms() - start;
+
+    print_summary(stdout);
+    if (games_path) {
+        FILE *out = fopen(games_path, "w");
+        if (out == NULL) {
+            perror("Could not write games file");
+            return 1;
+        }
+        print_games(out);
+        fclose(out);
+    }
+    fprintf(stderr, "%ld games on %d threads in %.2f s (%.0f games/s), %ld games stolen\n", total,
+            worker_count, elapsed / 1e3, total / (elapsed / 1e3), stolen);
+    free(results);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * vonsh-cellbench: memory footprint and full-board scan time of the packed
+ * board field compared to the former 16 byte BoardField structure.
+ * The scan mimics what render_game_view() does: visit every field and pick
+ * out snake and food fields.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+
+typedef struct LegacyField { /* BoardField layout before packing */
+    FieldType type;
+    int p;
+    int pdx;
+    int pdy;
+} LegacyField;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long scan_legacy(const LegacyField *board, int n) {
+    long acc = 0;
+    for (int i = 0; i < n; i++) {
+        switch (board[i].type) {
+            case Snake: acc += board[i].pdx + 2 * board[i].pdy + 3; break;
+            case Food: acc += board[i].p; break;
+            default: break;
+        }
+    }
+    return acc;
+}
+
+static long scan_packed(const BoardField *board, int n) {
+    long acc = 0;
+    for (int i = 0; i < n; i++) {
+        switch (field_type(board[i])) {
+            case Snake: acc += field_pdx(board[i]) + 2 * field_pdy(board[i]) + 3; break;
+            case Food: acc += field_kind(board[i]); break;
+            default: break;
+        }
+    }
+    return acc;
+}
+
+/* Returns average time of one scan in nanoseconds */
+static double time_scan(long (* volatile scan)(const void *, int), const void *board, int n, long *result) {
+    long long elapsed = 0, start = now_ns();
+    int passes = 0;
+    while (elapsed < MIN_BENCH_NS) {
+        *result += scan(board, n);
+        passes++;
+        elapsed = now_ns() - start;
+    }
+    return (double)elapsed / passes;
+}
+
+static long scan_legacy_v(const void *board, int n) { return scan_legacy(board, n); }
+static long scan_packed_v(const void *board, int n) { return scan_packed(board, n); }
+
+static void run_case(int w, int h) {
+    int n = w * h;
+    LegacyField *legacy = calloc(n, sizeof(LegacyField));
+    BoardField *packed = calloc(n, sizeof(BoardField));
+    if (legacy == NULL || packed == NULL) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+
+    /* same random content in both: ~10% snake, ~5% walls, some food */
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 54);
+    static const int dirs[4][2] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+    for (int i = 0; i < n; i++) {
+        uint32_t r = pcg32_boundedrand_r(&rng, 1000);
+        const int *d = dirs[r % 4];
+        if (r < 100) {
+            legacy[i] = (LegacyField){ Snake, 0, d[0], d[1] };
+            packed[i] = make_field(Snake, 0, d[0], d[1]);
+        }
+        else if (r < 150) {
+            legacy[i] = (LegacyField){ Wall, r % WALL_KINDS, 0, 0 };
+            packed[i] = make_field(Wall, r % WALL_KINDS, 0, 0);
+        }
+        else if (r < 151) {
+            legacy[i] = (LegacyField){ Food, r % FOOD_KINDS, 0, 0 };
+            packed[i] = make_field(Food, r % FOOD_KINDS, 0, 0);
+        }
+    }
+
+    long legacy_result = 0, packed_result = 0;
+    double legacy_ns = time_scan(scan_legacy_v, legacy, n, &legacy_result);
+    double packed_ns = time_scan(scan_packed_v, packed, n, &packed_result);
+    if (scan_legacy(legacy, n) != scan_packed(packed, n)) {
+        fprintf(stderr, "Scan results differ\n");
+        exit(1);
+    }
+
+    printf("%5dx%-5d %10zu %10zu %12.1f %12.1f %7.2fx\n", w, h,
+           n * sizeof(LegacyField), n * sizeof(BoardField),
+           legacy_ns / 1000.0, packed_ns / 1000.0, legacy_ns / packed_ns);
+    free(packed);
+    free(legacy);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {240, 130}, {512, 512}, {1024, 1024}, {2048, 2048} };
+
+    printf("field size: %zu bytes before, %zu bytes packed\n", sizeof(LegacyField), sizeof(BoardField));
+    printf("%-11s %10s %10s %12s %12s %8s\n", "board", "bytes old", "bytes new", "scan old us", "scan new us", "speedup");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        run_case(boards[b][0], boards[b][1]);
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * vonsh-clonebench: cost of forking the game state for lookahead search.
+ * From a game in progress it measures
+ *   clone  - full copy with sim_clone()
+ *   undo   - single sim_step_undoable() followed by sim_undo()
+ *   search - random playouts 8 ticks deep, each taken back tick by tick
+ * and checks that undone and cloned states match the original exactly.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+#define BATCH (100) /* operations between clock reads */
+#define SEARCH_DEPTH (8)
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+static bool is_safe(const SimContext *ctx, int d) {
+    int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+    if (x < 0 || y < 0 || x >= ctx->w || y >= ctx->h) return false;
+    if (dirs[d][0] == -ctx->dhx && dirs[d][1] == -ctx->dhy) return false;
+    FieldType t = field_type(sim_field(ctx, x, y));
+    return t == Empty || t == Food;
+}
+
+/* Random turn that does not hit anything right away, if there is one */
+static SimInput safe_input(const SimContext *ctx, pcg32_random_t *rng) {
+    int first = pcg32_boundedrand_r(rng, 4);
+    for (int k = 0; k < 4; k++) {
+        int d = (first + k) % 4;
+        if (is_safe(ctx, d)) return inputs[d];
+    }
+    return SimInputNone;
+}
+
+/* Safe turn towards the food, random safe turn if there is none */
+static SimInput greedy_input(const SimContext *ctx, pcg32_random_t *rng) {
+    for (int d = 0; d < 4; d++) {
+        int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+        if (abs(x - ctx->fx) + abs(y - ctx->fy) < abs(ctx->hx - ctx->fx) + abs(ctx->hy - ctx->fy) &&
+            is_safe(ctx, d)) {
+            return inputs[d];
+        }
+    }
+    return safe_input(ctx, rng);
+}
+
+/* Heads for the food until the snake is long, restarting games that end */
+static void play_midgame(SimContext *ctx, int target_len) {
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 7, 1);
+    uint64_t seed = 1;
+    sim_reset(ctx, seed);
+    for (long t = 0; ctx->length < target_len && t < 10000000; t++) {
+        sim_step(ctx, greedy_input(ctx, &rng), NULL);
+        if (!ctx->alive) sim_reset(ctx, ++seed);
+    }
+}
+
+static bool same_state(const SimContext *a, const SimContext *b) {
+    int n = a->w * a->h;
+    if (a->dhx != b->dhx || a->dhy != b->dhy || a->hx != b->hx || a->hy != b->hy ||
+        a->length != b->length || a->free_count != b->free_count || a->fx != b->fx || a->fy != b->fy ||
+        a->score != b->score || a->expand_counter != b->expand_counter || a->alive != b->alive ||
+        a->rng.state != b->rng.state || a->rng.inc != b->rng.inc) {
+        return false;
+    }
+    for (int y = 0; y < a->h; y++) {
+        for (int x = 0; x < a->w; x++) {
+            if (sim_field(a, x, y) != sim_field(b, x, y)) return false;
+        }
+    }
+    for (int r = 0; r < a->length; r++) {
+        const SimSegment *sa = sim_segment(a, r), *sb = sim_segment(b, r);
+        if (sa->x != sb->x || sa->y != sb->y || a->chars[r] != b->chars[r]) return false;
+    }
+    return memcmp(a->free_cells, b->free_cells, (size_t)a->free_count * sizeof(int)) == 0 &&
+           memcmp(a->free_pos, b->free_pos, (size_t)n * sizeof(int)) == 0 &&
+           memcmp(a->blocked, b->blocked, (size_t)a->bb_stride * a->h * sizeof(uint64_t)) == 0;
+}
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "%s does not restore the state\n", what);
+        exit(1);
+    }
+}
+
+static void run_case(int w, int h, int len) {
+    SimContext ctx, copy;
+    SimUndo undo[SEARCH_DEPTH];
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 2);
+    if (!sim_init(&ctx, w, h) || !sim_init(&copy, w, h)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    play_midgame(&ctx, len);
+
+    long long ops = 0, elapsed = 0, start = now_ns();
+    while (elapsed < MIN_BENCH_NS) {
+        for (int i = 0; i < BATCH; i++) sim_clone(&copy, &ctx);
+        ops += BATCH;
+        elapsed = now_ns() - start;
+    }
+    double clone_ns = (double)elapsed / ops;
+    check(same_state(&ctx, &copy), "sim_clone()");
+
+    ops = elapsed = 0;
+    start = now_ns();
+    while (elapsed < MIN_BENCH_NS) {
+        for (int i = 0; i < BATCH; i++) {
+            sim_step_undoable(&ctx, safe_input(&ctx, &rng), NULL, &undo[0]);
+            sim_undo(&ctx, &undo[0]);
+        }
+        ops += BATCH;
+        elapsed = now_ns() - start;
+    }
+    double undo_ns = (double)elapsed / ops;
+    check(same_state(&ctx, &copy), "sim_undo()");
+
+    ops = elapsed = 0;
+    start = now_ns();
+    while (elapsed < MIN_BENCH_NS) {
+        for (int i = 0; i < BATCH; i++) {
+            int depth = 0;
+            while (depth < SEARCH_DEPTH && ctx.alive) {
+                sim_step_undoable(&ctx, safe_input(&ctx, &rng), NULL, &undo[depth++]);
+            }
+            ops += depth;
+            while (depth > 0) sim_undo(&ctx, &undo[--depth]);
+        }
+        elapsed = now_ns() - start;
+    }
+    double search_ns = (double)elapsed / ops;
+    check(same_state(&ctx, &copy), "Undoing a playout");
+
+    /* an undone future must replay exactly the same way */
+    sim_step_undoable(&ctx, SimInputNone, NULL, &undo[0]);
+    sim_undo(&ctx, &undo[0]);
+    sim_step(&ctx, SimInputNone, NULL);
+    sim_step(&copy, SimInputNone, NULL);
+    check(same_state(&ctx, &copy), "Replaying after undo");
+
+    printf("%5dx%-5d %7d %12.0f %10.1f %12.0f %10.1f %12.0f\n", w, h, ctx.length,
+           1e9 / clone_ns, clone_ns, 1e9 / undo_ns, undo_ns, 1e9 / search_ns);
+    sim_free(&copy);
+    sim_free(&ctx);
+}
+
+int main(void) {
+    static const int boards[][3] = { {28, 28, 40}, {64, 64, 200}, {240, 130, 1000}, {512, 512, 1000} };
+
+    printf("%-11s %7s %12s %10s %12s %10s %12s\n", "board", "length", "clones/s", "clone ns",
+           "step+undo/s", "pair ns", "search tk/s");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        run_case(boards[b][0], boards[b][1], boards[b][2]);
+    }
+    return 0;
+}
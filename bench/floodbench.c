@@ -0,0 +1,177 @@
+/*
+ * vonsh-floodbench: time of a single reachability flood fill from the middle
+ * of the board, for every compiled-in kernel, compared to a plain BFS over
+ * board fields. Results of all kernels are checked against the BFS.
+ * Layouts: empty board, random walls of given density, a serpentine of
+ * vertical corridors joined at alternating ends - the worst case for the
+ * row sweeps of the bitboard fill - and rings around the start joined at
+ * alternating sides. The kernel sim_init() picked is marked with a star,
+ * fails if a fill by it takes longer than a tick can afford.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "sim_reach.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+/* A tick of 50 ms fills at most twice: for the food or to find the head's
+   region for a wall, and once more with a wall location blocked */
+#define FILL_BUDGET_NS (50000000LL / 2)
+
+typedef enum e_Layout {
+    LayoutEmpty,
+    LayoutRandom20,
+    LayoutRandom35,
+    LayoutColumns,
+    LayoutRings
+} Layout;
+
+static const char *layout_names[] = { "empty", "random 20%", "random 35%", "columns", "rings" };
+static bool over_budget = false;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void build_layout(SimContext *ctx, Layout layout) {
+    int w = ctx->w, h = ctx->h;
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 54);
+    SimSegment head = { w / 2, h / 2 };
+    sim_reset(ctx, 42);
+    sim_place_snake(ctx, &head, 1);
+    uint32_t *row = malloc((size_t)w * sizeof(uint32_t));
+    if (row == NULL) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    for (int y = 0; y < h; y++) {
+        pcg32_fill_bounded_r(&rng, row, w, 100);
+        for (int x = 0; x < w; x++) {
+            bool wall = false;
+            switch (layout) {
+                case LayoutRandom20: wall = row[x] < 20; break;
+                case LayoutRandom35: wall = row[x] < 35; break;
+                case LayoutColumns:
+                    /* wall every odd column, gap at the bottom or at the top */
+                    wall = x % 2 == 1 && y != ((x / 2) % 2 ? 0 : h - 1);
+                    break;
+                case LayoutRings: {
+                    /* wall every odd ring around the middle, gap on the right or on the left */
+                    int dx = x - head.x, dy = y - head.y;
+                    int d = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+                    wall = d % 2 == 1 && !(dy == 0 && dx == (d % 4 == 1 ? d : -d));
+                    break;
+                }
+                default: break;
+            }
+            if (wall && (x != head.x || y != head.y)) sim_place_item(ctx, Wall, x, y, 0);
+        }
+    }
+    free(row);
+}
+
+/* Reference: breadth first search over board fields, returns fields reached */
+static long bfs(const SimContext *ctx, int sx, int sy, uint8_t *seen, int *queue) {
+    static const int dirs[4][2] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+    int w = ctx->w, h = ctx->h, head = 0, tail = 0;
+    memset(seen, 0, (size_t)w * h);
+    seen[w * sy + sx] = 1;
+    queue[tail++] = w * sy + sx;
+    while (head < tail) {
+        int i = queue[head++];
+        int x = i % w, y = i / w;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dirs[d][0], ny = y + dirs[d][1];
+            if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+            int ni = w * ny + nx;
+            FieldType t = field_type(sim_field(ctx, nx, ny));
+            if (seen[ni] || t == Snake || t == Wall) continue;
+            seen[ni] = 1;
+            queue[tail++] = ni;
+        }
+    }
+    return tail;
+}
+
+static void run_case(int w, int h, Layout layout) {
+    SimContext ctx;
+    if (!sim_init(&ctx, w, h)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    build_layout(&ctx, layout);
+    int sx = w / 2, sy = h / 2;
+    uint8_t *seen = malloc((size_t)w * h);
+    int *queue = malloc((size_t)w * h * sizeof(int));
+    if (seen == NULL || queue == NULL) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+
+    long reached = 0;
+    long long elapsed = 0, start = now_ns();
+    int passes = 0;
+    while (elapsed < MIN_BENCH_NS) {
+        reached = bfs(&ctx, sx, sy, seen, queue);
+        passes++;
+        elapsed = now_ns() - start;
+    }
+    double bfs_ns = (double)elapsed / passes;
+    printf("%5dx%-5d %-11s %-7s %8s %10ld %12.1f\n", w, h, layout_names[layout], "bfs", "-",
+           reached, bfs_ns / 1000.0);
+
+    SimFloodKernel picked = ctx.flood_kernel;
+    for (SimFloodKernel k = SimFloodScalar; k <= SimFloodAvx2; k++) {
+        if (!sim_flood_kernel_available(k)) continue;
+        ctx.flood_kernel = k;
+        int sweeps = 0;
+        elapsed = 0;
+        passes = 0;
+        start = now_ns();
+        while (elapsed < MIN_BENCH_NS) {
+            sweeps = sim_flood_fill(&ctx, sx, sy);
+            passes++;
+            elapsed = now_ns() - start;
+        }
+        long count = 0;
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                if (sim_reached(&ctx, x, y) != (seen[w * y + x] != 0)) {
+                    fprintf(stderr, "%s kernel differs from BFS at %d,%d\n", sim_flood_kernel_name(k), x, y);
+                    exit(1);
+                }
+                count += sim_reached(&ctx, x, y);
+            }
+        }
+        double ns = (double)elapsed / passes;
+        bool over = k == picked && ns > FILL_BUDGET_NS;
+        over_budget |= over;
+        printf("%5dx%-5d %-11s %-6s%c %8d %10ld %12.1f %7.1fx%s\n", w, h, layout_names[layout],
+               sim_flood_kernel_name(k), k == picked ? '*' : ' ', sweeps, count, ns / 1000.0, bfs_ns / ns,
+               over ? "  over budget" : "");
+    }
+    free(queue);
+    free(seen);
+    sim_free(&ctx);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {240, 130}, {256, 256}, {512, 512}, {1024, 1024} };
+
+    printf("%-11s %-11s %-7s %8s %10s %12s %8s\n", "board", "layout", "kernel", "sweeps", "reached", "fill us", "vs bfs");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        for (Layout l = LayoutEmpty; l <= LayoutRings; l++) {
+            run_case(boards[b][0], boards[b][1], l);
+        }
+    }
+    if (over_budget) {
+        fprintf(stderr, "Fills over the budget of %.1f ms\n", FILL_BUDGET_NS / 1e6);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * vonsh-inputbench: what the turn queue does to quick double turns. A U-turn
+ * is two turns pressed shortly one after the other, at a random moment
+ * between ticks of the game. With a queue of depth 1 (the single pending turn
+ * the game used to have) the second turn is lost whenever both come before
+ * the same tick. Reports for queue depths and gaps between the presses how
+ * many U-turns are completed and how long the turns wait for their tick.
+ */
+#include <stdio.h>
+#include "sim_input_queue.h"
+
+#define GAME_TICK_MS (200) /* RENDER_INTERVAL * CHAR_ANIM_FRAMES of the game */
+#define TRIALS (100000) /* U-turns per depth and gap */
+
+static void turn(SimInput input, int *dhx, int *dhy) {
+    *dhx = (input == SimInputRight) - (input == SimInputLeft);
+    *dhy = (input == SimInputDown) - (input == SimInputUp);
+}
+
+/* Presses a U-turn at t0 and t0 + gap ms while moving up, ticks until both turns are through */
+static bool u_turn(SimInputQueue *q, uint64_t t0, uint64_t gap) {
+    int dhx = 0, dhy = -1;
+    uint64_t press[2] = { t0, t0 + gap };
+    SimInput keys[2] = { SimInputLeft, SimInputDown };
+    int pressed = 0;
+    sim_input_queue_clear(q);
+    for (uint64_t tick = GAME_TICK_MS; pressed < 2 || q->count > 0; tick += GAME_TICK_MS) {
+        while (pressed < 2 && press[pressed] < tick) {
+            sim_input_queue_push(q, keys[pressed], dhx, dhy, press[pressed]);
+            pressed++;
+        }
+        SimInput input = sim_input_queue_take(q, dhx, dhy, tick);
+        if (input != SimInputNone) turn(input, &dhx, &dhy);
+    }
+    return dhx == 0 && dhy == 1;
+}
+
+int main(void) {
+    static const int depths[] = { 1, 2, 3 };
+    static const int gaps[] = { 30, 60, 100, 150, 250 };
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 9);
+
+    printf("U-turns pressed at a random moment, %d ms ticks; completed %% / average wait ms of the turns\n", GAME_TICK_MS);
+    printf("%-6s", "depth");
+    for (size_t g = 0; g < sizeof(gaps)/sizeof(gaps[0]); g++) printf("   gap %3d ms", gaps[g]);
+    printf("\n");
+    for (size_t d = 0; d < sizeof(depths)/sizeof(depths[0]); d++) {
+        printf("%-6d", depths[d]);
+        for (size_t g = 0; g < sizeof(gaps)/sizeof(gaps[0]); g++) {
+            SimInputQueue q;
+            sim_input_queue_init(&q, depths[d]);
+            int done = 0;
+            for (int t = 0; t < TRIALS; t++) {
+                done += u_turn(&q, pcg32_boundedrand_r(&rng, GAME_TICK_MS), (uint64_t)gaps[g]);
+            }
+            printf("  %5.1f%% %5.0f", 100.0 * done / TRIALS, (double)q.wait_sum / q.taken);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * vonsh-journalbench: cost of following board changes. A snake steered
+ * towards the food plays on boards of several sizes, and after every tick an
+ * observer brings its own copy of the board up to date either
+ *   journal - by reading the changes from the board journal, or
+ *   rescan  - by comparing every field with its copy.
+ * Both observers follow the same game, and the tick itself (including writing
+ * the journal) and each observer are timed call by call within that one run.
+ * Every time includes one clock read, which the clock line shows.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum time per case */
+
+typedef struct Mirror { /* observer's copy of the board, in row order */
+    BoardField *fields;
+    uint32_t cursor;
+    long changes; /* changes picked up */
+    long resyncs;
+} Mirror;
+
+static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool is_safe(const SimContext *ctx, int d) {
+    int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+    if (x < 0 || y < 0 || x >= ctx->w || y >= ctx->h) return false;
+    if (dirs[d][0] == -ctx->dhx && dirs[d][1] == -ctx->dhy) return false;
+    FieldType t = field_type(sim_field(ctx, x, y));
+    return t == Empty || t == Food;
+}
+
+/* Safe turn towards the food, any safe turn if there is none */
+static SimInput greedy_input(const SimContext *ctx) {
+    int best = -1;
+    for (int d = 0; d < 4; d++) {
+        if (!is_safe(ctx, d)) continue;
+        int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+        if (abs(x - ctx->fx) + abs(y - ctx->fy) < abs(ctx->hx - ctx->fx) + abs(ctx->hy - ctx->fy)) {
+            return inputs[d];
+        }
+        if (best < 0) best = d;
+    }
+    return best < 0 ? SimInputNone : inputs[best];
+}
+
+static void rescan(const SimContext *ctx, Mirror *m) {
+    for (int y = 0; y < ctx->h; y++) {
+        for (int x = 0; x < ctx->w; x++) {
+            BoardField f = sim_field(ctx, x, y);
+            if (m->fields[ctx->w * y + x] != f) {
+                m->fields[ctx->w * y + x] = f;
+                m->changes++;
+            }
+        }
+    }
+}
+
+static void follow_journal(const SimContext *ctx, Mirror *m) {
+    SimChange change;
+    SimJournalStatus status;
+    while ((status = sim_journal_next(ctx, &m->cursor, &change)) != SimJournalEnd) {
+        if (status == SimJournalResync) {
+            m->resyncs++;
+            rescan(ctx, m);
+        }
+        else {
+            m->fields[ctx->w * change.y + change.x] = change.value;
+            m->changes++;
+        }
+    }
+}
+
+typedef struct Timing { /* nanoseconds per tick */
+    double tick, journal, rescan;
+} Timing;
+
+/*
+ * Plays one game with both observers following it. The tick and every
+ * observer call are timed on their own, so each includes one clock read.
+ */
+static Timing run_observers(int w, int h, Mirror *journal, Mirror *scan, long *ticks_out) {
+    SimContext ctx;
+    if (!sim_init(&ctx, w, h)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    uint64_t seed = 1;
+    sim_reset(&ctx, seed);
+    Mirror *mirrors[2] = { journal, scan };
+    /* both start from a copy of the new board */
+    for (int k = 0; k < 2; k++) {
+        memset(mirrors[k]->fields, 0, (size_t)w * h * sizeof(BoardField));
+        mirrors[k]->cursor = 0;
+    }
+    follow_journal(&ctx, journal);
+    rescan(&ctx, scan);
+    for (int k = 0; k < 2; k++) mirrors[k]->changes = mirrors[k]->resyncs = 0;
+
+    long ticks = 0;
+    long long tick_ns = 0, journal_ns = 0, rescan_ns = 0, start = now_ns();
+    while (now_ns() - start < MIN_BENCH_NS) {
+        long long t0 = now_ns();
+        sim_step(&ctx, greedy_input(&ctx), NULL);
+        if (!ctx.alive) sim_reset(&ctx, ++seed);
+        long long t1 = now_ns();
+        follow_journal(&ctx, journal);
+        long long t2 = now_ns();
+        rescan(&ctx, scan);
+        long long t3 = now_ns();
+        tick_ns += t1 - t0;
+        journal_ns += t2 - t1;
+        rescan_ns += t3 - t2;
+        ticks++;
+    }
+
+    for (int k = 0; k < 2; k++) {
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                if (mirrors[k]->fields[w * y + x] != sim_field(&ctx, x, y)) {
+                    fprintf(stderr, "Observer copy differs from the board at %d,%d\n", x, y);
+                    exit(1);
+                }
+            }
+        }
+    }
+    sim_free(&ctx);
+    *ticks_out = ticks;
+    Timing t = { (double)tick_ns / ticks, (double)journal_ns / ticks, (double)rescan_ns / ticks };
+    return t;
+}
+
+static void run_case(int w, int h) {
+    Mirror journal, scan;
+    long ticks;
+    journal.fields = malloc((size_t)w * h * sizeof(BoardField));
+    scan.fields = malloc((size_t)w * h * sizeof(BoardField));
+    if (journal.fields == NULL || scan.fields == NULL) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    Timing t = run_observers(w, h, &journal, &scan, &ticks);
+    printf("%5dx%-5d %10.1f %12.2f %8ld %12.1f %12.1f %9.0fx\n", w, h, t.tick,
+           (double)journal.changes / ticks, journal.resyncs, t.journal, t.rescan, t.rescan / t.journal);
+    free(journal.fields);
+    free(scan.fields);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {64, 64}, {240, 130}, {512, 512}, {1024, 1024} };
+
+    long long start = now_ns(), reads = 0;
+    while (now_ns() - start < 10000000LL) reads++;
+    printf("clock read %.1f ns\n", 1e7 / reads);
+    printf("%-11s %10s %12s %8s %12s %12s %10s\n", "board", "tick ns", "changes/tk", "resyncs",
+           "journal ns", "rescan ns", "speedup");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        run_case(boards[b][0], boards[b][1]);
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * vonsh-layoutbench: cost of vertical-heavy traversals of the board in each
+ * of the board layouts (see SIM_BOARD_LAYOUT in sim.h):
+ *   walk - follow snake links from head to tail of a snake filling the whole
+ *          board column by column, every step a dependent load one row apart
+ *   bfs  - breadth first search from the middle of an empty board
+ * Boards are plain BoardField arrays here, so all layouts are measured by a
+ * single build.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+#define MIN_BENCH_NS (300000000LL) /* minimum measured time per case */
+
+typedef enum e_Layout {
+    LayoutRows,
+    LayoutTiled,
+    LayoutMorton
+} Layout;
+
+static const char *layout_names[] = { "rows", "tiled", "morton" };
+
+typedef struct Board {
+    int w, h;
+    int tiles_w;
+    int cells;
+    BoardField *fields;
+    int *queue; /* BFS queue of row order field numbers */
+} Board;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#define IDX_ROWS(b, x, y) sim_index_rows((b)->w, x, y)
+#define IDX_TILED(b, x, y) sim_index_tiled((b)->tiles_w, x, y)
+#define IDX_MORTON(b, x, y) sim_index_morton(x, y)
+
+/* Follows snake links from (x,y) until the tail, returns number of fields visited */
+#define DEFINE_WALK(name, IDX) \
+static long name(const Board *b, int x, int y) { \
+    long n = 0; \
+    for (;;) { \
+        BoardField f = b->fields[IDX(b, x, y)]; \
+        n++; \
+        if (field_kind(f)) return n; /* tail is marked by kind 1 */ \
+        x += field_pdx(f); \
+        y += field_pdy(f); \
+    } \
+}
+
+/* Visits every field reachable from (sx,sy), marks them as Snake. Returns their count. */
+#define DEFINE_BFS(name, IDX) \
+static long name(Board *b, int sx, int sy) { \
+    static const int dirs[4][2] = { {0, 1}, {0, -1}, {1, 0}, {-1, 0} }; \
+    int head = 0, tail = 0; \
+    b->fields[IDX(b, sx, sy)] = make_field(Snake, 0, 0, 0); \
+    b->queue[tail++] = b->w * sy + sx; \
+    while (head < tail) { \
+        int i = b->queue[head++]; \
+        int x = i % b->w, y = i / b->w; \
+        for (int d = 0; d < 4; d++) { \
+            int nx = x + dirs[d][0], ny = y + dirs[d][1]; \
+            if (nx < 0 || ny < 0 || nx >= b->w || ny >= b->h) continue; \
+            BoardField *f = &b->fields[IDX(b, nx, ny)]; \
+            if (field_type(*f) != Empty) continue; \
+            *f = make_field(Snake, 0, 0, 0); \
+            b->queue[tail++] = b->w * ny + nx; \
+        } \
+    } \
+    return tail; \
+}
+
+DEFINE_WALK(walk_rows, IDX_ROWS)
+DEFINE_WALK(walk_tiled, IDX_TILED)
+DEFINE_WALK(walk_morton, IDX_MORTON)
+DEFINE_BFS(bfs_rows, IDX_ROWS)
+DEFINE_BFS(bfs_tiled, IDX_TILED)
+DEFINE_BFS(bfs_morton, IDX_MORTON)
+
+static int board_index(const Board *b, Layout layout, int x, int y) {
+    switch (layout) {
+        case LayoutTiled: return IDX_TILED(b, x, y);
+        case LayoutMorton: return IDX_MORTON(b, x, y);
+        default: return IDX_ROWS(b, x, y);
+    }
+}
+
+static void init_board(Board *b, int w, int h, Layout layout) {
+    const int tile = 1 << SIM_TILE_BITS;
+    b->w = w;
+    b->h = h;
+    b->tiles_w = (w + tile - 1) / tile;
+    if (layout == LayoutTiled) {
+        b->cells = b->tiles_w * ((h + tile - 1) / tile) * tile * tile;
+    }
+    else if (layout == LayoutMorton) {
+        int side = 1;
+        while (side < w || side < h) side *= 2;
+        b->cells = side * side;
+    }
+    else {
+        b->cells = w * h;
+    }
+    b->fields = calloc((size_t)b->cells, sizeof(BoardField));
+    b->queue = malloc((size_t)w * h * sizeof(int));
+    if (b->fields == NULL || b->queue == NULL) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+}
+
+/*
+ * Lays snake down column 0, up column 1, down column 2... Links point from
+ * each field to the previous piece, so walking from the head (last field of
+ * the last column) goes back through every column.
+ */
+static void lay_columns_snake(Board *b, Layout layout, int *hx, int *hy) {
+    int px = -1, py = -1;
+    for (int x = 0; x < b->w; x++) {
+        for (int k = 0; k < b->h; k++) {
+            int y = x % 2 ? b->h - 1 - k : k;
+            BoardField f = px < 0 ? make_field(Snake, 1, 0, 0) : make_field(Snake, 0, px - x, py - y);
+            b->fields[board_index(b, layout, x, y)] = f;
+            px = x;
+            py = y;
+        }
+    }
+    *hx = px;
+    *hy = py;
+}
+
+static double time_walk(Board *b, Layout layout, long *visited) {
+    int hx, hy;
+    lay_columns_snake(b, layout, &hx, &hy);
+    long long elapsed = 0, start = now_ns();
+    int passes = 0;
+    while (elapsed < MIN_BENCH_NS) {
+        switch (layout) {
+            case LayoutTiled: *visited = walk_tiled(b, hx, hy); break;
+            case LayoutMorton: *visited = walk_morton(b, hx, hy); break;
+            default: *visited = walk_rows(b, hx, hy); break;
+        }
+        passes++;
+        elapsed = now_ns() - start;
+    }
+    return (double)elapsed / passes;
+}
+
+static double time_bfs(Board *b, Layout layout, long *visited) {
+    long long elapsed = 0;
+    int passes = 0;
+    while (elapsed < MIN_BENCH_NS) {
+        memset(b->fields, 0, (size_t)b->cells * sizeof(BoardField));
+        long long start = now_ns();
+        switch (layout) {
+            case LayoutTiled: *visited = bfs_tiled(b, b->w / 2, b->h / 2); break;
+            case LayoutMorton: *visited = bfs_morton(b, b->w / 2, b->h / 2); break;
+            default: *visited = bfs_rows(b, b->w / 2, b->h / 2); break;
+        }
+        elapsed += now_ns() - start;
+        passes++;
+    }
+    return (double)elapsed / passes;
+}
+
+static void run_case(int w, int h) {
+    double walk_base = 0, bfs_base = 0;
+    for (Layout l = LayoutRows; l <= LayoutMorton; l++) {
+        Board b;
+        long walked, searched;
+        init_board(&b, w, h, l);
+        double walk_ns = time_walk(&b, l, &walked);
+        double bfs_ns = time_bfs(&b, l, &searched);
+        if (walked != (long)w * h || searched != (long)w * h) {
+            fprintf(stderr, "Traversal in %s layout missed fields\n", layout_names[l]);
+            exit(1);
+        }
+        if (l == LayoutRows) {
+            walk_base = walk_ns;
+            bfs_base = bfs_ns;
+        }
+        printf("%5dx%-5d %-7s %10zu %10.2f %7.2fx %10.2f %7.2fx\n", w, h, layout_names[l],
+               (size_t)b.cells * sizeof(BoardField),
+               walk_ns / walked, walk_base / walk_ns, bfs_ns / searched, bfs_base / bfs_ns);
+        free(b.queue);
+        free(b.fields);
+    }
+}
+
+int main(void) {
+    static const int boards[][2] = { {240, 130}, {512, 512}, {1000, 1000}, {2048, 2048}, {4096, 4096} };
+
+    printf("%-11s %-7s %10s %10s %8s %10s %8s\n", "board", "layout", "bytes", "walk ns", "speedup", "bfs ns", "speedup");
+    for (size_t i = 0; i < sizeof(boards)/sizeof(boards[0]); i++) {
+        run_case(boards[i][0], boards[i][1]);
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * vonsh-lockstepbench: stepping many games at once with sim_batch_step()
+ * against stepping them one by one with sim_step(). Every game is steered by
+ * a simple policy reading its observation (go ahead, turn now and then, avoid
+ * what is in the way), dead games are restarted with a new seed. Reports
+ * steps per second of the stepping alone, both ways timed in turn on the same
+ * games tick by tick, and first checks for a while that
+ * the batched games stay bit-identical to the single ones, every change in
+ * the board journal included.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "sim_batch.h"
+
+#define MIN_BENCH_NS (300000000LL) /* minimum measured time per case and way of stepping */
+#define CHECK_TICKS (3000) /* ticks compared against single games */
+
+static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool blocked(const SimBatch *b, const SimObservation *obs, int x, int y) {
+    if (x < 0 || y < 0 || x >= b->w || y >= b->h) return true;
+    return sim_observed_blocked(b, obs, x, y);
+}
+
+/* Input for game g: keeps going, now and then turns, avoids obstacles */
+static SimInput policy(const SimBatch *b, int g, int dhx, int dhy, pcg32_random_t *rng) {
+    SimObservation obs = sim_batch_observe(b, g);
+    uint32_t r = pcg32_random_r(rng);
+    if (r % 8 != 0 && !blocked(b, &obs, obs.hx + dhx, obs.hy + dhy)) return SimInputNone;
+    for (int k = 0; k < 4; k++) {
+        int d = (r / 8 + k) % 4;
+        if (dirs[d][0] == -dhx && dirs[d][1] == -dhy) continue;
+        if (!blocked(b, &obs, obs.hx + dirs[d][0], obs.hy + dirs[d][1])) return inputs[d];
+    }
+    return SimInputNone;
+}
+
+static void fail(const char *what, int g, uint32_t tick) {
+    fprintf(stderr, "Batched game %d differs from single one in %s at tick %u\n", g, what, tick);
+    exit(1);
+}
+
+/* Compares the whole state of batched game g with a single game */
+static void compare(SimBatch *b, int g, const SimContext *single) {
+    const SimContext *c = sim_batch_sync(b, g);
+    int n = c->w * c->h;
+    if (c->hx != single->hx || c->hy != single->hy || c->dhx != single->dhx || c->dhy != single->dhy)
+        fail("head", g, single->tick);
+    if (c->fx != single->fx || c->fy != single->fy || c->score != single->score ||
+        c->expand_counter != single->expand_counter || c->alive != single->alive || c->tick != single->tick)
+        fail("state", g, single->tick);
+    if (c->rng.state != single->rng.state) fail("rng", g, single->tick);
+    if (c->journal_seq != single->journal_seq || c->journal_floor != single->journal_floor)
+        fail("journal", g, single->tick);
+    /* changes since the last reset still in the ring, the ones before were skipped */
+    uint32_t kept = c->journal_seq - c->journal_floor;
+    if (kept > SIM_JOURNAL_SIZE) kept = SIM_JOURNAL_SIZE;
+    for (uint32_t s = c->journal_seq - kept; s != c->journal_seq; s++) {
+        const SimChange *a = &c->journal[s & (SIM_JOURNAL_SIZE - 1)];
+        const SimChange *e = &single->journal[s & (SIM_JOURNAL_SIZE - 1)];
+        if (a->tick != e->tick || a->x != e->x || a->y != e->y || a->old != e->old || a->value != e->value)
+            fail("journal", g, single->tick);
+    }
+    if (memcmp(c->board, single->board, (size_t)c->board_cells * sizeof(BoardField)) != 0)
+        fail("board", g, single->tick);
+    if (c->free_count != single->free_count ||
+        memcmp(c->free_cells, single->free_cells, (size_t)c->free_count * sizeof(int)) != 0 ||
+        memcmp(c->free_pos, single->free_pos, (size_t)n * sizeof(int)) != 0)
+        fail("empty fields", g, single->tick);
+    if (c->length != single->length || memcmp(c->chars, single->chars, (size_t)c->length) != 0)
+        fail("snake", g, single->tick);
+    for (int y = 0; y < c->h; y++) {
+        for (int x = 0; x < c->w; x++) {
+            SimObservation obs = sim_batch_observe(b, g);
+            bool blk = field_type(sim_field(single, x, y)) == Snake || field_type(sim_field(single, x, y)) == Wall;
+            if (sim_observed_blocked(b, &obs, x, y) != blk) fail("observation", g, single->tick);
+        }
+    }
+}
+
+/* Plays the games batched and single side by side with the same inputs */
+static void check(int n, int w, int h) {
+    SimBatch b;
+    SimContext *single = malloc((size_t)n * sizeof(SimContext));
+    SimInput *in = malloc((size_t)n * sizeof(SimInput));
+    pcg32_random_t rng;
+    if (single == NULL || in == NULL || !sim_batch_init(&b, n, w, h)) {
+        fprintf(stderr, "Out of memory for %d games\n", n);
+        exit(1);
+    }
+    pcg32_srandom_r(&rng, 7, 7);
+    uint64_t seed = 0;
+    for (int g = 0; g < n; g++) {
+        if (!sim_init(&single[g], w, h)) {
+            fprintf(stderr, "Out of memory for %d games\n", n);
+            exit(1);
+        }
+        single[g].growth = b.games[g].growth = g % 3; /* the game rule and two fixed ones */
+        sim_reset(&single[g], ++seed);
+        sim_batch_reset(&b, g, seed);
+    }
+    for (int t = 0; t < CHECK_TICKS; t++) {
+        for (int g = 0; g < n; g++) in[g] = policy(&b, g, b.dhx[g], b.dhy[g], &rng);
+        sim_batch_step(&b, in);
+        for (int g = 0; g < n; g++) {
+            sim_step(&single[g], in[g], NULL);
+            if (t % 64 == 0 || !b.alive[g]) compare(&b, g, &single[g]);
+            if (!single[g].alive) {
+                sim_reset(&single[g], ++seed);
+                sim_batch_reset(&b, g, seed);
+            }
+        }
+    }
+    for (int g = 0; g < n; g++) sim_free(&single[g]);
+    free(single);
+    free(in);
+    sim_batch_free(&b);
+}
+
+typedef struct Result {
+    double single_steps_per_s;
+    double batch_steps_per_s;
+    double slow_share; /* ticks that went through sim_step() */
+} Result;
+
+/*
+ * Steps the same games batched and single with the same inputs, timing both
+ * ticks alternately in turn so that drift of the machine hits both alike.
+ */
+static Result run_case(int n, int w, int h) {
+    SimBatch b;
+    SimContext *single = malloc((size_t)n * sizeof(SimContext));
+    SimInput *in = malloc((size_t)n * sizeof(SimInput));
+    pcg32_random_t rng;
+    if (single == NULL || in == NULL || !sim_batch_init(&b, n, w, h)) {
+        fprintf(stderr, "Out of memory for %d games\n", n);
+        exit(1);
+    }
+    pcg32_srandom_r(&rng, 1, 1);
+    uint64_t seed = 0;
+    for (int g = 0; g < n; g++) {
+        if (!sim_init(&single[g], w, h)) {
+            fprintf(stderr, "Out of memory for %d games\n", n);
+            exit(1);
+        }
+        sim_batch_reset(&b, g, ++seed);
+        sim_reset(&single[g], seed);
+    }
+
+    long long steps = 0, single_ns = 0, batch_ns = 0;
+    for (int t = 0; single_ns < MIN_BENCH_NS || batch_ns < MIN_BENCH_NS; t++) {
+        for (int g = 0; g < n; g++) in[g] = policy(&b, g, b.dhx[g], b.dhy[g], &rng);
+        for (int k = 0; k < 2; k++) {
+            long long t0 = now_ns();
+            if ((t + k) % 2 == 0) {
+                for (int g = 0; g < n; g++) sim_step(&single[g], in[g], NULL);
+                single_ns += now_ns() - t0;
+            } else {
+                sim_batch_step(&b, in);
+                batch_ns += now_ns() - t0;
+            }
+        }
+        steps += n;
+        for (int g = 0; g < n; g++) {
+            if (!single[g].alive) {
+                sim_reset(&single[g], ++seed);
+                sim_batch_reset(&b, g, seed);
+            }
+        }
+    }
+    Result r = { steps * 1e9 / single_ns, steps * 1e9 / batch_ns,
+                 (double)b.slow_steps / (b.moves + b.slow_steps) };
+    for (int g = 0; g < n; g++) sim_free(&single[g]);
+    free(single);
+    free(in);
+    sim_batch_free(&b);
+    return r;
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {64, 64}, {100, 70} };
+    static const int counts[] = { 64, 1024, 8192 };
+
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        check(256, boards[b][0], boards[b][1]);
+    }
+    printf("batched games bit-identical to single ones over %d ticks\n", CHECK_TICKS);
+
+    printf("%-9s %6s %-12s %14s %10s %8s\n", "board", "games", "stepping", "steps/s", "ns/step", "slow");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        int w = boards[b][0], h = boards[b][1];
+        for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); c++) {
+            int n = counts[c];
+            Result r = run_case(n, w, h);
+            printf("%3dx%-5d %6d %-12s %14.0f %10.2f %8s\n", w, h, n, "single", r.single_steps_per_s,
+                   1e9 / r.single_steps_per_s, "");
+            printf("%3dx%-5d %6d %-12s %14.0f %10.2f %7.2f%%\n", w, h, n, "batch", r.batch_steps_per_s,
+                   1e9 / r.batch_steps_per_s, 100 * r.slow_share);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * vonsh-remote: stand-in for an external controller. Connects to a game
+ * started with --listen and sends it requests, given on the command line or
+ * one per line on standard input, printing every reply (see sim_remote.h).
+ *   vonsh-remote /tmp/vonsh.sock mode\ stepped "reset 42" "step 100 RRDD" board
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim_remote.h"
+
+static char line[SIM_REMOTE_LINE_MAX];
+
+/* Sends one request and prints its reply. Returns false if the connection broke. */
+static bool request(int fd, FILE *in, const char *req) {
+    size_t len = strlen(req);
+    if (write(fd, req, len) != (ssize_t)len || write(fd, "\n", 1) != 1) return false;
+    if (strcmp(req, "quit") == 0) return true;
+
+    if (fgets(line, sizeof(line), in) == NULL) return false;
+    fputs(line, stdout);
+    int w, h;
+    if (sscanf(line, "board %d %d", &w, &h) == 2) {
+        for (int y = 0; y < h; y++) {
+            if (fgets(line, sizeof(line), in) == NULL) return false;
+            fputs(line, stdout);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s SOCKET [REQUEST...]\n"
+                        "Without requests on the command line they are read from standard input.\n", argv[0]);
+        return 1;
+    }
+    int fd = sim_remote_connect(argv[1]);
+    if (fd == -1) {
+        perror("Could not connect to the game");
+        return 1;
+    }
+    FILE *in = fdopen(fd, "r");
+    if (in == NULL) {
+        perror("fdopen");
+        return 1;
+    }
+
+    bool ok = true;
+    if (argc > 2) {
+        for (int i = 2; i < argc && ok; i++) ok = request(fd, in, argv[i]);
+    }
+    else {
+        static char req[SIM_REMOTE_LINE_MAX];
+        while (ok && fgets(req, sizeof(req), stdin) != NULL) {
+            req[strcspn(req, "\r\n")] = '\0';
+            if (req[0] != '\0') ok = request(fd, in, req);
+            fflush(stdout);
+        }
+    }
+    if (!ok) fprintf(stderr, "Connection to the game was closed\n");
+    fclose(in);
+    return ok ? 0 : 1;
+}
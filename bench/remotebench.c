@@ -0,0 +1,174 @@
+/*
+ * vonsh-remotebench: throughput of remote control over the Unix socket. A
+ * headless game server (sim_remote_serve()) runs in a child process, the
+ * benchmark is its client in stepped mode. The snake follows a closed loop
+ * over the board (as in vonsh-simbench) until it hits a wall seeded on the
+ * way, then the game is reset. Reports round trips and game ticks per second
+ * for step requests of different sizes, against the 200 ms tick of the game.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sim.h"
+#include "sim_remote.h"
+
+#define MIN_BENCH_NS (300000000LL) /* minimum measured time per case */
+#define GAME_TICK_MS (200) /* RENDER_INTERVAL * CHAR_ANIM_FRAMES of the game */
+
+typedef struct State {
+    unsigned tick;
+    int score, alive, hx, hy, dhx, dhy, fx, fy, length;
+} State;
+
+static char line[SIM_REMOTE_LINE_MAX];
+static char req[SIM_REMOTE_LINE_MAX];
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Sends req, reads a single line reply into line */
+static void round_trip(int fd, FILE *in) {
+    size_t len = strlen(req);
+    req[len] = '\n';
+    if (write(fd, req, len + 1) != (ssize_t)len + 1 || fgets(line, sizeof(line), in) == NULL) {
+        fprintf(stderr, "Connection to the server broke\n");
+        exit(1);
+    }
+    req[len] = '\0';
+}
+
+static void parse_state(State *s) {
+    if (sscanf(line, "state %u %d %d %d %d %d %d %d %d %d", &s->tick, &s->score, &s->alive, &s->hx, &s->hy,
+               &s->dhx, &s->dhy, &s->fx, &s->fy, &s->length) != 10) {
+        fprintf(stderr, "Unexpected reply: %s", line);
+        exit(1);
+    }
+}
+
+/* Direction of the closed loop at (x,y), see vonsh-simbench. Board height must be even. */
+static char loop_dir(int w, int h, int x, int y, int *dx, int *dy) {
+    *dx = *dy = 0;
+    if (x == 0 && y > 0) { *dy = -1; return 'U'; }
+    if (x == 0) { *dx = 1; return 'R'; }
+    if (y % 2 == 0) {
+        if (x < w - 2) { *dx = 1; return 'R'; }
+        *dy = 1; return 'D';
+    }
+    if (x > 1 || y == h - 1) { *dx = -1; return 'L'; }
+    *dy = 1; return 'D';
+}
+
+/* Writes inputs for k ticks following the loop from state s into req */
+static void plan_loop(int w, int h, const State *s, int k) {
+    int x = s->hx, y = s->hy, dhx = s->dhx, dhy = s->dhy;
+    int n = sprintf(req, "step %d ", k);
+    for (int i = 0; i < k; i++) {
+        int dx, dy;
+        char c = loop_dir(w, h, x, y, &dx, &dy);
+        if (dx == -dhx && dy == -dhy) c = '.'; /* the game ignores reversing */
+        else { dhx = dx; dhy = dy; }
+        req[n++] = c;
+        x += dhx;
+        y += dhy;
+    }
+    req[n] = '\0';
+}
+
+static void run_server(const char *path, int w, int h) {
+    SimContext ctx;
+    SimRemote r;
+    if (!sim_init(&ctx, w, h) || !sim_reset(&ctx, 1)) exit(1);
+    if (!sim_remote_listen(&r, path)) {
+        perror("Could not listen");
+        exit(1);
+    }
+    printf("ready\n");
+    fflush(stdout);
+    int status = sim_remote_serve(&r, &ctx, GAME_TICK_MS);
+    sim_remote_close(&r);
+    sim_free(&ctx);
+    exit(status == 0 ? 0 : 1);
+}
+
+static void run_case(int fd, FILE *in, int w, int h, int k) {
+    State s;
+    long long trips = 0, ticks = 0, games = 0, start = now_ns(), elapsed = 0;
+    strcpy(req, "reset 1");
+    round_trip(fd, in);
+    parse_state(&s);
+    while (elapsed < MIN_BENCH_NS) {
+        if (!s.alive) {
+            sprintf(req, "reset %lld", ++games + 1);
+        }
+        else {
+            plan_loop(w, h, &s, k);
+        }
+        unsigned before = s.alive ? s.tick : 0;
+        round_trip(fd, in);
+        parse_state(&s);
+        ticks += s.tick - before;
+        trips++;
+        elapsed = now_ns() - start;
+    }
+    double seconds = elapsed / 1e9;
+    printf("%5dx%-5d %8d %12.0f %10.1f %12.0f %10.0fx\n", w, h, k, trips / seconds, 1e6 * seconds / trips,
+           ticks / seconds, ticks / seconds * GAME_TICK_MS / 1000);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {64, 64} };
+    static const int steps[] = { 1, 16, 256, 4096, 65536 };
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/vonsh-remotebench-%d.sock", (int)getpid());
+
+    printf("%-11s %8s %12s %10s %12s %11s\n", "board", "step", "trips/s", "us/trip", "ticks/s", "vs game");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        int w = boards[b][0], h = boards[b][1];
+        int ready[2];
+        if (pipe(ready) == -1) {
+            perror("pipe");
+            return 1;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            dup2(ready[1], STDOUT_FILENO);
+            close(ready[0]);
+            run_server(path, w, h);
+        }
+        close(ready[1]);
+        char buf[8];
+        if (read(ready[0], buf, sizeof(buf)) <= 0) {
+            fprintf(stderr, "Server did not start\n");
+            return 1;
+        }
+        close(ready[0]);
+
+        int fd = sim_remote_connect(path);
+        FILE *in = fd == -1 ? NULL : fdopen(fd, "r");
+        if (in == NULL) {
+            perror("Could not connect to the server");
+            kill(pid, SIGTERM);
+            return 1;
+        }
+        strcpy(req, "mode stepped");
+        round_trip(fd, in);
+        for (size_t k = 0; k < sizeof(steps)/sizeof(steps[0]); k++) run_case(fd, in, w, h, steps[k]);
+        strcpy(req, "shutdown");
+        round_trip(fd, in);
+        fclose(in);
+        waitpid(pid, NULL, 0);
+    }
+    return 0;
+}
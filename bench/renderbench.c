@@ -0,0 +1,145 @@
+/*
+ * vonsh-renderbench: cost of finding what to draw in a frame of the single
+ * snake game, without the drawing itself. Boards of window and fullscreen
+ * sizes hold snakes of several lengths and one food, and every frame a list
+ * of sprites (position, direction of the previous piece, character or food
+ * kind) is gathered
+ *   scan  - by visiting every field of the board, as the renderer once did,
+ *   field - from the body ring, reading each piece's direction from the board,
+ *   ring  - from the body ring alone, as the renderer does now.
+ * All three have to find the same sprites.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+#define FOOD_SPRITE (-1) /* ch of the food sprite */
+
+typedef struct Sprite {
+    int16_t x, y;
+    int8_t pdx, pdy;
+    int16_t ch; /* character, or FOOD_SPRITE */
+} Sprite;
+
+typedef enum e_Path {
+    PathScan,
+    PathField,
+    PathRing
+} Path;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Gathers the sprites of a frame, returns their number */
+static int gather(const SimContext *ctx, int fx, int fy, Path path, Sprite *out) {
+    int n = 0;
+    if (path == PathScan) {
+        /* characters are kept by distance from the head, so the scan needs their ranks too */
+        for (int y = 0; y < ctx->h; y++) {
+            for (int x = 0; x < ctx->w; x++) {
+                BoardField field = sim_field(ctx, x, y);
+                if (field_type(field) == Snake) {
+                    out[n++] = (Sprite){ (int16_t)x, (int16_t)y, (int8_t)field_pdx(field), (int8_t)field_pdy(field), 0 };
+                } else if (field_type(field) == Food) {
+                    out[n++] = (Sprite){ (int16_t)x, (int16_t)y, 0, 0, FOOD_SPRITE };
+                }
+            }
+        }
+        return n;
+    }
+    const SimSegment *tail = sim_segment(ctx, ctx->length - 1);
+    BoardField tail_field = sim_field(ctx, tail->x, tail->y);
+    int px = tail->x + field_pdx(tail_field), py = tail->y + field_pdy(tail_field);
+    for (int i = ctx->length - 1; i >= 0; i--) {
+        const SimSegment *s = sim_segment(ctx, i);
+        if (path == PathField) {
+            BoardField field = sim_field(ctx, s->x, s->y);
+            out[n++] = (Sprite){ s->x, s->y, (int8_t)field_pdx(field), (int8_t)field_pdy(field), ctx->chars[i] };
+        } else {
+            out[n++] = (Sprite){ s->x, s->y, (int8_t)(px - s->x), (int8_t)(py - s->y), ctx->chars[i] };
+            px = s->x;
+            py = s->y;
+        }
+    }
+    if (fx >= 0) out[n++] = (Sprite){ (int16_t)fx, (int16_t)fy, 0, 0, FOOD_SPRITE };
+    return n;
+}
+
+/* Sum of the sprites that does not depend on their order, characters left out (the scan has none) */
+static uint64_t sprites_hash(const Sprite *s, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t v = ((uint64_t)(uint16_t)s[i].x << 32) | ((uint64_t)(uint16_t)s[i].y << 16) |
+                     ((uint64_t)(uint8_t)s[i].pdx << 8) | (uint64_t)(uint8_t)s[i].pdy | ((uint64_t)(s[i].ch < 0) << 48);
+        v *= 0x9E3779B97F4A7C15ULL;
+        sum += v ^ (v >> 29);
+    }
+    return sum;
+}
+
+/* Lays a snake of len pieces row by row, back and forth, from the top left corner, head last */
+static bool place_snake(SimContext *ctx, int len) {
+    SimSegment *body = malloc((size_t)len * sizeof(SimSegment));
+    if (body == NULL) return false;
+    for (int k = 0; k < len; k++) {
+        int y = k / ctx->w, x = k % ctx->w;
+        if (y % 2 == 1) x = ctx->w - 1 - x;
+        body[len - 1 - k] = (SimSegment){ (int16_t)x, (int16_t)y };
+    }
+    bool ok = sim_place_snake(ctx, body, len);
+    free(body);
+    return ok;
+}
+
+static double time_path(const SimContext *ctx, int fx, int fy, Path path, Sprite *out, int *count) {
+    long long frames = 0, t0 = now_ns(), t;
+    volatile int sink = 0;
+    do {
+        for (int k = 0; k < 16; k++) sink += gather(ctx, fx, fy, path, out);
+        frames += 16;
+        t = now_ns();
+    } while (t - t0 < MIN_BENCH_NS);
+    *count = gather(ctx, fx, fy, path, out);
+    return (double)(t - t0) / frames;
+}
+
+int main(void) {
+    /* 40x30 window, 1920x1080 and 3840x2160 fullscreen (a row less for the score), a large custom board */
+    static const int boards[][2] = { {40, 30}, {120, 66}, {240, 134}, {1024, 1024} };
+    static const int lengths[] = { 4, 64, 1024, 0 }; /* 0 - half the board */
+
+    printf("%-10s %8s %8s %12s %12s %12s %9s\n", "board", "length", "sprites", "scan ns", "field ns", "ring ns", "scan/ring");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        int w = boards[b][0], h = boards[b][1];
+        SimContext ctx;
+        Sprite *sprites = malloc(((size_t)w * h + 1) * sizeof(Sprite));
+        if (sprites == NULL || !sim_init(&ctx, w, h) || !sim_reset(&ctx, 1)) return 1;
+        for (size_t l = 0; l < sizeof(lengths)/sizeof(lengths[0]); l++) {
+            int len = lengths[l] > 0 ? lengths[l] : w * h / 2;
+            if (len > w * h / 2) continue;
+            if (!place_snake(&ctx, len)) return 1;
+            int fx = w - 1, fy = h - 1;
+            sim_place_item(&ctx, Food, fx, fy, 0);
+            int n[3];
+            double ns[3];
+            uint64_t hash[3];
+            for (Path p = PathScan; p <= PathRing; p++) {
+                ns[p] = time_path(&ctx, fx, fy, p, sprites, &n[p]);
+                hash[p] = sprites_hash(sprites, n[p]);
+            }
+            if (n[0] != n[1] || n[0] != n[2] || hash[0] != hash[1] || hash[0] != hash[2]) {
+                fprintf(stderr, "%dx%d board, length %d: paths found different sprites\n", w, h, len);
+                return 1;
+            }
+            printf("%4dx%-5d %8d %8d %12.0f %12.0f %12.0f %8.0fx\n", w, h, len, n[0], ns[0], ns[1], ns[2], ns[0] / ns[2]);
+        }
+        sim_free(&ctx);
+        free(sprites);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * vonsh-replaybench: recording and max-speed playback of replays. On boards
+ * of several sizes a snake steered towards the food (with some random turns)
+ * plays whole games, which are recorded, saved, loaded back and replayed.
+ * Reports the size of the input stream and the playback speed, and checks
+ * that every replayed game ends exactly as the recorded one.
+ * Replay files given on the command line are played back instead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "sim_replay.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+#define GAMES (20) /* games recorded per board */
+#define MAX_TICKS (2000000) /* games longer than that are cut off */
+
+static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool is_safe(const SimContext *ctx, int d) {
+    int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+    if (x < 0 || y < 0 || x >= ctx->w || y >= ctx->h) return false;
+    if (dirs[d][0] == -ctx->dhx && dirs[d][1] == -ctx->dhy) return false;
+    FieldType t = field_type(sim_field(ctx, x, y));
+    return t == Empty || t == Food;
+}
+
+/* Safe turn towards the food, now and then a random one, like a player would */
+static SimInput player_input(const SimContext *ctx, pcg32_random_t *rng) {
+    if (pcg32_boundedrand_r(rng, 16) == 0) {
+        int first = pcg32_boundedrand_r(rng, 4);
+        for (int k = 0; k < 4; k++) {
+            int d = (first + k) % 4;
+            if (is_safe(ctx, d)) return inputs[d];
+        }
+        return SimInputNone;
+    }
+    int best = -1;
+    for (int d = 0; d < 4; d++) {
+        if (!is_safe(ctx, d)) continue;
+        int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+        if (abs(x - ctx->fx) + abs(y - ctx->fy) < abs(ctx->hx - ctx->fx) + abs(ctx->hy - ctx->fy)) {
+            best = d;
+            break;
+        }
+        if (best < 0) best = d;
+    }
+    /* keep going straight if that is safe and gets no further from food */
+    if (best < 0 || (dirs[best][0] == ctx->dhx && dirs[best][1] == ctx->dhy)) return SimInputNone;
+    return inputs[best];
+}
+
+/* Plays and records a whole game, returns false if it had to be cut off */
+static bool record_game(SimContext *ctx, SimReplay *r, uint64_t seed, pcg32_random_t *rng) {
+    sim_replay_start(r, ctx->w, ctx->h, seed, 0);
+    sim_reset(ctx, seed);
+    while (ctx->alive && ctx->tick < MAX_TICKS) {
+        SimInput input = player_input(ctx, rng);
+        if (!sim_replay_record(r, ctx->tick, input)) {
+            fprintf(stderr, "Out of memory for replay\n");
+            exit(1);
+        }
+        sim_step(ctx, input, NULL);
+    }
+    if (!sim_replay_finish(r, ctx->tick, ctx->score)) {
+        fprintf(stderr, "Out of memory for replay\n");
+        exit(1);
+    }
+    return !ctx->alive;
+}
+
+/* Returns nanoseconds per tick of playing r back, game by game */
+static double time_playback(SimContext *ctx, SimReplay *r, int n) {
+    long long elapsed = 0, ticks = 0, start = now_ns();
+    while (elapsed < MIN_BENCH_NS) {
+        for (int g = 0; g < n; g++) {
+            if (!sim_replay_run(&r[g], ctx)) {
+                fprintf(stderr, "Replay of game %d diverged at tick %u\n", g, ctx->tick);
+                exit(1);
+            }
+            ticks += ctx->tick;
+        }
+        elapsed = now_ns() - start;
+    }
+    return (double)elapsed / ticks;
+}
+
+static void run_case(int w, int h, const char *tmp_path) {
+    SimContext ctx;
+    SimReplay replays[GAMES] = {{0}};
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 3);
+    if (!sim_init(&ctx, w, h)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+
+    long long ticks = 0, bytes = 0, inputs = 0, score = 0;
+    for (int g = 0; g < GAMES; g++) {
+        SimReplay recorded = {0};
+        record_game(&ctx, &recorded, 1000 + g, &rng);
+        ticks += ctx.tick;
+        score += ctx.score;
+        /* round trip through a file */
+        if (!sim_replay_save(&recorded, tmp_path) || !sim_replay_load(&replays[g], tmp_path)) {
+            fprintf(stderr, "Could not save and load replay via %s\n", tmp_path);
+            exit(1);
+        }
+        if (replays[g].ticks != ctx.tick || replays[g].score != ctx.score ||
+            replays[g].size != recorded.size || memcmp(replays[g].data, recorded.data, recorded.size) != 0) {
+            fprintf(stderr, "Loaded replay differs from the recorded one\n");
+            exit(1);
+        }
+        for (uint32_t t = 0; t < recorded.ticks; t++) inputs += sim_replay_input(&recorded, t) != SimInputNone;
+        bytes += replays[g].size;
+        sim_replay_free(&recorded);
+    }
+
+    double play_ns = time_playback(&ctx, replays, GAMES);
+    printf("%5dx%-5d %10.0f %8.1f %10.2f %9.3f %12.0f %10.1f\n", w, h, (double)ticks / GAMES,
+           (double)score / GAMES, (double)inputs / ticks * 1000, (double)bytes * 8 / ticks,
+           1e9 / play_ns, play_ns);
+    for (int g = 0; g < GAMES; g++) sim_replay_free(&replays[g]);
+    sim_free(&ctx);
+}
+
+static int play_files(int argc, char **argv) {
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        SimReplay r = {0};
+        SimContext ctx;
+        if (!sim_replay_load(&r, argv[i])) {
+            fprintf(stderr, "Could not read replay file '%s'\n", argv[i]);
+            failed++;
+            continue;
+        }
+        if (!sim_init(&ctx, r.w, r.h)) {
+            fprintf(stderr, "Out of memory for %dx%d board\n", r.w, r.h);
+            exit(1);
+        }
+        double play_ns = time_playback(&ctx, &r, 1);
+        bool ok = sim_replay_run(&r, &ctx);
+        printf("%s: %dx%d board, %u ticks, score %d, %zu bytes, %.0f ticks/s%s\n", argv[i], r.w, r.h,
+               r.ticks, r.score, r.size, 1e9 / play_ns, ok ? "" : " DIVERGED");
+        failed += !ok;
+        sim_free(&ctx);
+        sim_replay_free(&r);
+    }
+    return failed != 0;
+}
+
+int main(int argc, char **argv) {
+    static const int boards[][2] = { {28, 28}, {64, 64}, {240, 130}, {512, 512} };
+    if (argc > 1) return play_files(argc, argv);
+
+    char tmp_path[] = "/tmp/vonsh-replaybench-XXXXXX";
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    printf("%-11s %10s %8s %10s %9s %12s %10s\n", "board", "ticks", "score", "inputs/1k",
+           "bits/tick", "playback/s", "tick ns");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        run_case(boards[b][0], boards[b][1], tmp_path);
+    }
+    unlink(tmp_path);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * vonsh-rewindbench: memory and latency of rewinding with the delta ring.
+ * The snake heads for the food (and grows, so food and walls are seeded)
+ * while every tick is kept in the ring; then the game is rewound, checking
+ * that the state before is restored exactly. Reports bytes per tick against
+ * a plain SimUndo and a full copy of the state, the ring needed for 30
+ * seconds of play, how long stepping back over it takes and how many ticks
+ * a ring of 1 KB holds (checking that dropping old ticks works, too).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "sim_rewind.h"
+
+#define GAME_TICK_MS (200) /* RENDER_INTERVAL * CHAR_ANIM_FRAMES of the game */
+#define REWIND_SECONDS (30)
+#define REWIND_TICKS (REWIND_SECONDS * 1000 / GAME_TICK_MS)
+#define ROUNDS (2000) /* rewinds checked and timed per board */
+#define SMALL_RING (1024) /* bytes of the ring that has to drop old ticks */
+#define SMALL_RING_TICKS (1000)
+
+static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool is_safe(const SimContext *ctx, int d) {
+    int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+    if (x < 0 || y < 0 || x >= ctx->w || y >= ctx->h) return false;
+    if (dirs[d][0] == -ctx->dhx && dirs[d][1] == -ctx->dhy) return false;
+    FieldType t = field_type(sim_field(ctx, x, y));
+    return t == Empty || t == Food;
+}
+
+/* Safe turn towards the food, random safe turn if there is none */
+static SimInput greedy_input(const SimContext *ctx, pcg32_random_t *rng) {
+    for (int d = 0; d < 4; d++) {
+        int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+        if (abs(x - ctx->fx) + abs(y - ctx->fy) < abs(ctx->hx - ctx->fx) + abs(ctx->hy - ctx->fy) &&
+            is_safe(ctx, d)) {
+            return inputs[d];
+        }
+    }
+    int first = pcg32_boundedrand_r(rng, 4);
+    for (int k = 0; k < 4; k++) {
+        if (is_safe(ctx, (first + k) % 4)) return inputs[(first + k) % 4];
+    }
+    return SimInputNone;
+}
+
+static bool same_state(const SimContext *a, const SimContext *b) {
+    int n = a->w * a->h;
+    if (a->dhx != b->dhx || a->dhy != b->dhy || a->hx != b->hx || a->hy != b->hy || a->tick != b->tick ||
+        a->length != b->length || a->free_count != b->free_count || a->fx != b->fx || a->fy != b->fy ||
+        a->score != b->score || a->expand_counter != b->expand_counter || a->alive != b->alive ||
+        a->rng.state != b->rng.state || a->rng.inc != b->rng.inc) {
+        return false;
+    }
+    for (int r = 0; r < a->length; r++) {
+        const SimSegment *sa = sim_segment(a, r), *sb = sim_segment(b, r);
+        if (sa->x != sb->x || sa->y != sb->y) return false;
+    }
+    return memcmp(a->board, b->board, (size_t)a->board_cells * sizeof(BoardField)) == 0 &&
+           memcmp(a->free_cells, b->free_cells, (size_t)a->free_count * sizeof(int)) == 0 &&
+           memcmp(a->free_pos, b->free_pos, (size_t)n * sizeof(int)) == 0 &&
+           memcmp(a->blocked, b->blocked, (size_t)a->bb_stride * a->h * sizeof(uint64_t)) == 0;
+}
+
+/* Bytes sim_clone() copies for a game of the board */
+static size_t state_bytes(const SimContext *ctx) {
+    int n = ctx->w * ctx->h;
+    return (size_t)ctx->board_cells * sizeof(BoardField) + 2 * (size_t)n * sizeof(int) +
+           (size_t)ctx->bb_stride * ctx->h * sizeof(uint64_t) + (size_t)ctx->length * (sizeof(SimSegment) + 1);
+}
+
+/*
+ * Plays on with a ring too small to hold all ticks, rewinds as far as it
+ * goes and compares with a game replayed up to that tick from the start.
+ * Returns the number of ticks the ring held, 0 if the game ended before it
+ * was full.
+ */
+static uint32_t check_small_ring(SimContext *ctx, SimContext *start, pcg32_random_t *rng) {
+    static SimInput played[SMALL_RING_TICKS];
+    SimRewind rw;
+    if (!sim_rewind_init(&rw, SMALL_RING, SMALL_RING_TICKS)) exit(1);
+    sim_clone(start, ctx);
+    int ticks = 0;
+    while (ticks < SMALL_RING_TICKS && ctx->alive) {
+        played[ticks] = greedy_input(ctx, rng);
+        sim_rewind_step(&rw, ctx, played[ticks++], NULL);
+    }
+    uint32_t held = rw.count;
+    while (sim_rewind_back(&rw, ctx));
+    for (int t = 0; t < ticks - (int)held; t++) sim_step(start, played[t], NULL);
+    if (!same_state(ctx, start)) {
+        fprintf(stderr, "Rewinding a full ring of %d bytes does not restore the state\n", SMALL_RING);
+        exit(1);
+    }
+    sim_rewind_free(&rw);
+    return held < (uint32_t)ticks ? held : 0;
+}
+
+static void run_case(int w, int h) {
+    SimContext ctx, before;
+    SimRewind rw;
+    pcg32_random_t rng;
+    if (!sim_init(&ctx, w, h) || !sim_init(&before, w, h) ||
+        !sim_rewind_init(&rw, (size_t)REWIND_TICKS * (SIM_REWIND_MAX_RECORD + 2), REWIND_TICKS)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    pcg32_srandom_r(&rng, 42, 3);
+    uint64_t seed = 1;
+    sim_reset(&ctx, seed);
+
+    long long rewind_ns = 0, rewound = 0;
+    size_t copy_bytes = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        if (!ctx.alive) sim_reset(&ctx, ++seed);
+        sim_rewind_clear(&rw);
+        sim_clone(&before, &ctx);
+        int ticks = 1 + pcg32_boundedrand_r(&rng, REWIND_TICKS);
+        for (int t = 0; t < ticks; t++) sim_rewind_step(&rw, &ctx, greedy_input(&ctx, &rng), NULL);
+        if (state_bytes(&ctx) > copy_bytes) copy_bytes = state_bytes(&ctx);
+
+        /* everything back, then play on */
+        long long t0 = now_ns();
+        while (sim_rewind_back(&rw, &ctx)) rewound++;
+        rewind_ns += now_ns() - t0;
+        if (!same_state(&ctx, &before)) {
+            fprintf(stderr, "Rewinding %d ticks on %dx%d board does not restore the state\n", ticks, w, h);
+            exit(1);
+        }
+        for (int k = 0; k < ticks; k++) sim_step(&ctx, greedy_input(&ctx, &rng), NULL);
+    }
+
+    uint32_t held = 0;
+    while ((held = check_small_ring(&ctx, &before, &rng)) == 0) {
+        sim_reset(&ctx, ++seed); /* until a game lasts long enough to fill the ring */
+    }
+
+    double per_tick = (double)rw.bytes_written / rw.records_written;
+    printf("%4dx%-5d %10.1f %10zu %10zu %12.0f %12.2f %12.2f %10u\n", w, h, per_tick, sizeof(SimUndo),
+           copy_bytes, per_tick * REWIND_TICKS, (double)rewind_ns / rewound,
+           (double)rewind_ns / rewound * REWIND_TICKS / 1e3, held);
+    sim_rewind_free(&rw);
+    sim_free(&before);
+    sim_free(&ctx);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {40, 30}, {120, 66}, {240, 134} };
+
+    printf("%d seconds = %d ticks of the game, ring sized for that many worst case records (%d bytes)\n",
+           REWIND_SECONDS, REWIND_TICKS, REWIND_TICKS * (SIM_REWIND_MAX_RECORD + 2));
+    printf("%-10s %10s %10s %10s %12s %12s %12s %10s\n", "board", "bytes/tk", "undo B", "copy B",
+           "30s bytes", "back ns/tk", "30s back us", "ticks/1KB");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        run_case(boards[b][0], boards[b][1]);
+    }
+    return 0;
+}
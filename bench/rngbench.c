@@ -0,0 +1,109 @@
+/*
+ * vonsh-rngbench: throughput of one-at-a-time PCG draws compared to the bulk
+ * pcg32_fill_r() and pcg32_fill_bounded_r(), for buffer sizes from a small
+ * game board to a million fields. Also checks that bulk output equals the
+ * sequential one and that pcg32_advance_r() lands on the same state.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pcg_basic.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+#define BOUND (8) /* e.g. number of ground tiles */
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void check_sequences(uint32_t *buf, size_t n) {
+    pcg32_random_t a, b;
+    pcg32_srandom_r(&a, 42, 54);
+    b = a;
+    pcg32_fill_r(&a, buf, n);
+    for (size_t i = 0; i < n; i++) {
+        if (buf[i] != pcg32_random_r(&b)) {
+            fprintf(stderr, "pcg32_fill_r differs from pcg32_random_r at %zu\n", i);
+            exit(1);
+        }
+    }
+    if (a.state != b.state) {
+        fprintf(stderr, "pcg32_fill_r leaves generator in a different state\n");
+        exit(1);
+    }
+    pcg32_srandom_r(&b, 42, 54);
+    pcg32_advance_r(&b, n);
+    if (a.state != b.state) {
+        fprintf(stderr, "pcg32_advance_r does not match %zu draws\n", n);
+        exit(1);
+    }
+    pcg32_fill_bounded_r(&a, buf, n, BOUND);
+    for (size_t i = 0; i < n; i++) {
+        if (buf[i] >= BOUND) {
+            fprintf(stderr, "pcg32_fill_bounded_r out of bounds\n");
+            exit(1);
+        }
+    }
+}
+
+typedef enum e_Method {
+    MethodRandom,
+    MethodFill,
+    MethodBoundedRand,
+    MethodFillBounded
+} Method;
+
+/* Returns nanoseconds per number */
+static double time_method(Method method, uint32_t *buf, size_t n, uint32_t *sink) {
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 54);
+    long long elapsed = 0, start = now_ns();
+    long long numbers = 0;
+    while (elapsed < MIN_BENCH_NS) {
+        switch (method) {
+            case MethodRandom:
+                for (size_t i = 0; i < n; i++) buf[i] = pcg32_random_r(&rng);
+                break;
+            case MethodFill:
+                pcg32_fill_r(&rng, buf, n);
+                break;
+            case MethodBoundedRand:
+                for (size_t i = 0; i < n; i++) buf[i] = pcg32_boundedrand_r(&rng, BOUND);
+                break;
+            case MethodFillBounded:
+                pcg32_fill_bounded_r(&rng, buf, n, BOUND);
+                break;
+        }
+        *sink += buf[n / 2];
+        numbers += n;
+        elapsed = now_ns() - start;
+    }
+    return (double)elapsed / numbers;
+}
+
+int main(void) {
+    static const size_t sizes[] = { 784, 31200, 262144, 1048576 };
+    uint32_t sink = 0;
+
+    printf("%10s %12s %12s %8s %14s %14s %8s\n", "numbers", "random ns", "fill ns", "speedup",
+           "boundedrand ns", "fill_bnd ns", "speedup");
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        uint32_t *buf = malloc(n * sizeof(uint32_t));
+        if (buf == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        check_sequences(buf, n);
+        double random_ns = time_method(MethodRandom, buf, n, &sink);
+        double fill_ns = time_method(MethodFill, buf, n, &sink);
+        double bounded_ns = time_method(MethodBoundedRand, buf, n, &sink);
+        double fill_bounded_ns = time_method(MethodFillBounded, buf, n, &sink);
+        printf("%10zu %12.3f %12.3f %7.2fx %14.3f %14.3f %7.2fx\n", n, random_ns, fill_ns,
+               random_ns / fill_ns, bounded_ns, fill_bounded_ns, bounded_ns / fill_bounded_ns);
+        free(buf);
+    }
+    return sink == 0xdeadbeef; /* keeps the results alive */
+}
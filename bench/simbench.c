@@ -0,0 +1,106 @@
+/*
+ * vonsh-simbench: measures cost of the game rules alone (no rendering, no SDL).
+ * For each board size and snake length the snake is laid along a closed loop
+ * covering all but the last board column and steered around it for as long as
+ * needed. Food sits in the last column, so the loop never reaches it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+#define MIN_BENCH_NS (200000000LL) /* minimum measured time per case */
+#define BATCH_TICKS (1000) /* ticks between clock reads */
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Direction of the closed loop at (x,y): rows are walked back and forth over
+ * columns 1..w-2, column 0 leads back up to the start. Board height must be even.
+ */
+static SimInput loop_dir(int w, int h, int x, int y) {
+    if (x == 0) return y > 0 ? SimInputUp : SimInputRight;
+    if (y % 2 == 0) return x < w - 2 ? SimInputRight : SimInputDown;
+    if (x > 1) return SimInputLeft;
+    return y == h - 1 ? SimInputLeft : SimInputDown;
+}
+
+static void move_dir(SimInput dir, int *x, int *y) {
+    switch (dir) {
+        case SimInputLeft: (*x)--; break;
+        case SimInputRight: (*x)++; break;
+        case SimInputUp: (*y)--; break;
+        case SimInputDown: (*y)++; break;
+        default: break;
+    }
+}
+
+/* Lays a snake of given length along the loop. Returns false if it does not fit. */
+static bool lay_snake(SimContext *ctx, int len) {
+    int loop_len = (ctx->w - 1) * ctx->h;
+    if (len >= loop_len) return false;
+
+    SimSegment *body = malloc((size_t)len * sizeof(SimSegment));
+    if (body == NULL) return false;
+    /* walk the loop from its start - first visited field becomes the tail */
+    int x = 0, y = 0;
+    for (int i = len - 1; i >= 0; i--) {
+        body[i].x = x;
+        body[i].y = y;
+        move_dir(loop_dir(ctx->w, ctx->h, x, y), &x, &y);
+    }
+    sim_reset(ctx, 42);
+    bool ok = sim_place_snake(ctx, body, len);
+    sim_place_item(ctx, Food, ctx->w - 1, 0, 0);
+    free(body);
+    return ok;
+}
+
+static void run_case(int w, int h, int len) {
+    SimContext ctx;
+    SimEvents events;
+    if (!sim_init(&ctx, w, h)) {
+        fprintf(stderr, "Out of memory for %dx%d board\n", w, h);
+        exit(1);
+    }
+    if (!lay_snake(&ctx, len)) {
+        sim_free(&ctx);
+        return;
+    }
+
+    long long ticks = 0, elapsed = 0;
+    long long start = now_ns();
+    while (elapsed < MIN_BENCH_NS) {
+        for (int i = 0; i < BATCH_TICKS; i++) {
+            sim_step(&ctx, loop_dir(w, h, ctx.hx, ctx.hy), &events);
+        }
+        ticks += BATCH_TICKS;
+        elapsed = now_ns() - start;
+    }
+    if (!ctx.alive || ctx.length != len) {
+        fprintf(stderr, "Snake left the loop during benchmark run\n");
+        exit(1);
+    }
+
+    double ns_per_tick = (double)elapsed / ticks;
+    printf("%5dx%-5d %8d %14.0f %12.1f\n", w, h, len, 1e9 / ns_per_tick, ns_per_tick);
+    sim_free(&ctx);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {64, 64}, {240, 130}, {512, 512} };
+    static const int lengths[] = { 1, 10, 100, 1000, 10000, 100000 };
+
+    printf("%-11s %8s %14s %12s\n", "board", "length", "ticks/s", "ns/tick");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        for (size_t l = 0; l < sizeof(lengths)/sizeof(lengths[0]); l++) {
+            run_case(boards[b][0], boards[b][1], lengths[l]);
+        }
+    }
+    return 0;
+}
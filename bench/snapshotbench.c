@@ -0,0 +1,226 @@
+/*
+ * vonsh-snapshotbench: round trip and speed of snapshots. A game is played
+ * for a while, saved and loaded into another context; the copy has to equal
+ * the original and play on exactly the same way, its replay included. Damaged
+ * and cut off files have to be refused, and so do files with the right hash
+ * but a state that does not agree with its board. Reports file size and the time to
+ * save and to load (the file stays in the page cache, so this is the cost of
+ * the code rather than of the disk).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "sim_snapshot.h"
+
+#define ROUNDS (20) /* saves and loads timed per board */
+#define PLAY_ON_TICKS (500) /* ticks both games go on after loading */
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void fail(const char *what, int w, int h) {
+    fprintf(stderr, "%dx%d board: %s\n", w, h, what);
+    exit(1);
+}
+
+static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+static bool is_safe(const SimContext *ctx, int d) {
+    int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+    if (x < 0 || y < 0 || x >= ctx->w || y >= ctx->h) return false;
+    if (dirs[d][0] == -ctx->dhx && dirs[d][1] == -ctx->dhy) return false;
+    FieldType t = field_type(sim_field(ctx, x, y));
+    return t == Empty || t == Food;
+}
+
+/* Safe turn towards the food, random safe turn if there is none */
+static SimInput greedy_input(const SimContext *ctx, pcg32_random_t *rng) {
+    for (int d = 0; d < 4; d++) {
+        int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+        if (abs(x - ctx->fx) + abs(y - ctx->fy) < abs(ctx->hx - ctx->fx) + abs(ctx->hy - ctx->fy) &&
+            is_safe(ctx, d)) {
+            return inputs[d];
+        }
+    }
+    int first = pcg32_boundedrand_r(rng, 4);
+    for (int k = 0; k < 4; k++) {
+        if (is_safe(ctx, (first + k) % 4)) return inputs[(first + k) % 4];
+    }
+    return SimInputNone;
+}
+
+static bool same_state(const SimContext *a, const SimContext *b) {
+    int n = a->w * a->h;
+    if (a->dhx != b->dhx || a->dhy != b->dhy || a->hx != b->hx || a->hy != b->hy || a->tick != b->tick ||
+        a->length != b->length || a->free_count != b->free_count || a->fx != b->fx || a->fy != b->fy ||
+        a->score != b->score || a->expand_counter != b->expand_counter || a->growth != b->growth ||
+        a->alive != b->alive || a->rng.state != b->rng.state || a->rng.inc != b->rng.inc) {
+        return false;
+    }
+    for (int r = 0; r < a->length; r++) {
+        const SimSegment *sa = sim_segment(a, r), *sb = sim_segment(b, r);
+        if (sa->x != sb->x || sa->y != sb->y || a->chars[r] != b->chars[r]) return false;
+    }
+    return memcmp(a->board, b->board, (size_t)a->board_cells * sizeof(BoardField)) == 0 &&
+           memcmp(a->free_cells, b->free_cells, (size_t)a->free_count * sizeof(int)) == 0 &&
+           memcmp(a->free_pos, b->free_pos, (size_t)n * sizeof(int)) == 0 &&
+           memcmp(a->blocked, b->blocked, (size_t)a->bb_stride * a->h * sizeof(uint64_t)) == 0;
+}
+
+/* Changes one byte of the file at pos (from the end if negative) or cuts it there */
+static void damage(const char *src, const char *dst, long pos, bool cut) {
+    FILE *in = fopen(src, "rb"), *out = fopen(dst, "wb");
+    if (in == NULL || out == NULL) exit(1);
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if (pos < 0) pos += size;
+    for (long i = 0; i < size; i++) {
+        int c = fgetc(in);
+        if (i == pos && cut) break;
+        fputc(i == pos ? c ^ 0x40 : c, out);
+    }
+    fclose(in);
+    fclose(out);
+}
+
+enum { CorruptWall, CorruptFree, CorruptFreeCount, CorruptBody, CorruptFood, CorruptChar, CORRUPTIONS };
+
+/* Saves ctx to path with one part of its state made to disagree with the board, hash and all */
+static void save_corrupted(const SimContext *ctx, SimContext *bad, int how, const char *path) {
+    if (!sim_clone(bad, ctx)) exit(1);
+    int head = bad->w * bad->hy + bad->hx;
+    int empty = bad->free_cells[0];
+    switch (how) {
+        case CorruptWall: /* board changed past the set of empty fields */
+            bad->board[sim_field_index(bad, empty % bad->w, empty / bad->w)] = make_field(Wall, 0, 0, 0);
+            break;
+        case CorruptFree: /* snake field listed as empty */
+            bad->free_cells[0] = head;
+            break;
+        case CorruptFreeCount: /* an empty field left out */
+            bad->free_count--;
+            break;
+        case CorruptBody: /* head moved onto an empty field */
+            sim_segment(bad, 0)->x = empty % bad->w;
+            sim_segment(bad, 0)->y = empty / bad->w;
+            bad->hx = empty % bad->w;
+            bad->hy = empty / bad->w;
+            break;
+        case CorruptFood: /* food position on an empty field */
+            bad->fx = empty % bad->w;
+            bad->fy = empty / bad->w;
+            break;
+        case CorruptChar:
+            bad->chars[0] = TOTAL_CHARS;
+            break;
+    }
+    if (!sim_snapshot_save(bad, NULL, 0, path)) exit(1);
+}
+
+/* Plays a game of the board for the given ticks (or as long as it lasts), records its replay */
+static void play(SimContext *ctx, SimReplay *replay, pcg32_random_t *rng, uint64_t *seed, uint32_t ticks) {
+    do {
+        sim_reset(ctx, ++*seed);
+        sim_replay_start(replay, ctx->w, ctx->h, *seed, 7);
+        while (ctx->alive && ctx->tick < ticks) {
+            SimInput input = greedy_input(ctx, rng);
+            sim_replay_record(replay, ctx->tick, input);
+            sim_step(ctx, input, NULL);
+        }
+    } while (!ctx->alive);
+}
+
+static void run_case(int w, int h, const char *path, const char *bad_path) {
+    SimContext ctx, copy;
+    SimReplay replay = {0}, copy_replay = {0};
+    pcg32_random_t rng;
+    uint64_t seed = 0;
+    uint32_t frame = 0;
+    if (!sim_init(&ctx, w, h) || !sim_init(&copy, 28, 28) /* loading reallocates */) fail("out of memory", w, h);
+    pcg32_srandom_r(&rng, 42, 5);
+    ctx.growth = 2; /* long snakes also on large boards */
+
+    long long save_ns = 0, load_ns = 0;
+    long size = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        play(&ctx, &replay, &rng, &seed, 200 + 50 * round);
+        long long t0 = now_ns();
+        if (!sim_snapshot_save(&ctx, &replay, (uint32_t)round, path)) fail("could not save", w, h);
+        long long t1 = now_ns();
+        if (!sim_snapshot_load(&copy, &copy_replay, &frame, path)) fail("could not load", w, h);
+        long long t2 = now_ns();
+        save_ns += t1 - t0;
+        load_ns += t2 - t1;
+        if (!same_state(&ctx, &copy) || frame != (uint32_t)round) fail("loaded state differs", w, h);
+        if (copy_replay.seed != replay.seed || copy_replay.ground_seed != replay.ground_seed ||
+            copy_replay.size != replay.size || memcmp(copy_replay.data, replay.data, replay.size) != 0) {
+            fail("loaded replay differs", w, h);
+        }
+    }
+    FILE *f = fopen(path, "rb");
+    if (f != NULL) {
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fclose(f);
+    }
+
+    /* both games go on the same way, and the replay still tells the whole game */
+    for (int t = 0; t < PLAY_ON_TICKS && ctx.alive; t++) {
+        SimInput input = greedy_input(&ctx, &rng);
+        sim_replay_record(&replay, ctx.tick, input);
+        sim_replay_record(&copy_replay, copy.tick, input);
+        sim_step(&ctx, input, NULL);
+        sim_step(&copy, input, NULL);
+    }
+    if (!same_state(&ctx, &copy)) fail("loaded game plays on differently", w, h);
+    sim_replay_finish(&copy_replay, copy.tick, copy.score);
+    if (!sim_replay_run(&copy_replay, &copy) || !same_state(&ctx, &copy)) fail("replay of loaded game differs", w, h);
+
+    /* states that disagree with their board are refused, though the hash is right */
+    SimContext bad;
+    if (!sim_init(&bad, w, h)) fail("out of memory", w, h);
+    for (int how = 0; how < CORRUPTIONS; how++) {
+        save_corrupted(&ctx, &bad, how, bad_path);
+        if (sim_snapshot_load(&copy, &copy_replay, &frame, bad_path)) fail("corrupted state was loaded", w, h);
+    }
+    sim_free(&bad);
+
+    /* damaged files are refused */
+    long spots[] = { 0, 40, (long)sizeof(SimSnapshotHeader) + 1, size / 2, -1 };
+    for (size_t k = 0; k < sizeof(spots)/sizeof(spots[0]); k++) {
+        damage(path, bad_path, spots[k], false);
+        if (sim_snapshot_load(&copy, &copy_replay, &frame, bad_path)) fail("damaged file was loaded", w, h);
+        damage(path, bad_path, spots[k], true);
+        if (sim_snapshot_load(&copy, &copy_replay, &frame, bad_path)) fail("cut off file was loaded", w, h);
+    }
+
+    printf("%4dx%-5d %8d %10ld %10.3f %10.3f\n", w, h, ctx.length, size,
+           save_ns / 1e6 / ROUNDS, load_ns / 1e6 / ROUNDS);
+    sim_replay_free(&copy_replay);
+    sim_replay_free(&replay);
+    sim_free(&copy);
+    sim_free(&ctx);
+}
+
+int main(void) {
+    static const int boards[][2] = { {28, 28}, {40, 30}, {120, 66}, {240, 134}, {1024, 1024} };
+    char path[64], bad_path[64];
+    snprintf(path, sizeof(path), "/tmp/vonsh-snapshotbench-%d.vsn", (int)getpid());
+    snprintf(bad_path, sizeof(bad_path), "/tmp/vonsh-snapshotbench-%d-bad.vsn", (int)getpid());
+
+    printf("%-10s %8s %10s %10s %10s\n", "board", "length", "bytes", "save ms", "load ms");
+    for (size_t b = 0; b < sizeof(boards)/sizeof(boards[0]); b++) {
+        run_case(boards[b][0], boards[b][1], path, bad_path);
+    }
+    remove(path);
+    remove(bad_path);
+    return 0;
+}
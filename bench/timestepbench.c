@@ -0,0 +1,149 @@
+/*
+ * vonsh-timestepbench: the fixed step game clock against displays of several
+ * refresh rates, with frames coming late at random and some dropped. Checks
+ * that the game ticks exactly as often as real time says, and reports how
+ * smoothly the snake moves from frame to frame: the distance it is drawn off
+ * the place real time puts it at, and the spread of its moves per frame. The
+ * old way of drawing only at the 50 ms steps is shown for comparison, and so
+ * is how late the steps come and how much their intervals vary. Then measures
+ * how precisely waits for the next frame end: sleeping whole milliseconds as
+ * SDL_Delay() does, sleeping the exact time, and sleeping with a final spin.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim_clock.h"
+
+#define STEP_MS (50.0) /* RENDER_INTERVAL of the game */
+#define STEPS_PER_TICK (4) /* CHAR_ANIM_FRAMES of the game */
+#define RUN_MS (600000.0) /* ten minutes of play per case */
+#define MAX_LAG_MS (1000.0)
+#define SPIN_MS (0.3) /* SLEEP_SPIN_MS of the game */
+#define SLEEPS (200) /* waits timed per length */
+
+typedef struct Result {
+    uint64_t ticks;
+    double max_off; /* fields drawn off the place of real time */
+    double move_mean, move_sd; /* fields moved per frame */
+    SimClock clock;
+} Result;
+
+/* Place of the snake in fields at t ms, the first step ticks at STEP_MS, ticks move it a field on */
+static double ideal_place(double t) {
+    return (t - STEP_MS) / (STEP_MS * STEPS_PER_TICK) - 1.0;
+}
+
+/*
+ * Runs the clock with frames of a display at hz, each late by up to jitter_ms
+ * and dropped (shown a refresh later) with probability drop. interpolate
+ * draws in between steps, otherwise the phase of the last step is drawn.
+ */
+static Result run(double hz, double jitter_ms, double drop, bool interpolate, pcg32_random_t *rng) {
+    SimClock c;
+    sim_clock_init(&c, STEP_MS, MAX_LAG_MS);
+    Result r = {0};
+    uint32_t frame = 0; /* steps of the game */
+    double refresh = 1000.0 / hz, t = 0.0, last = 0.0, prev_place = 0.0;
+    double sum = 0.0, sum_sq = 0.0;
+    uint64_t frames = 0;
+    while (t < RUN_MS) {
+        t += refresh;
+        while ((double)pcg32_boundedrand_r(rng, 1000000) < drop * 1000000.0) t += refresh;
+        double shown = fmax(last, t + jitter_ms * pcg32_boundedrand_r(rng, 1001) / 1000.0); /* in order */
+        int steps = sim_clock_advance(&c, shown - last);
+        last = shown;
+        for (int i = 0; i < steps; i++) {
+            if (frame % STEPS_PER_TICK == 0) r.ticks++;
+            frame++;
+        }
+        double phase = interpolate ? sim_clock_tick_phase(frame, STEPS_PER_TICK, sim_clock_alpha(&c))
+                                   : sim_clock_tick_phase(frame, STEPS_PER_TICK, 1.0);
+        /* drawn between the fields of the last two ticks */
+        double place = (double)r.ticks - 2.0 + phase;
+        double off = fabs(place - ideal_place(shown));
+        if (off > r.max_off) r.max_off = off;
+        if (frames > 0) {
+            double move = place - prev_place;
+            sum += move;
+            sum_sq += move * move;
+        }
+        prev_place = place;
+        frames++;
+    }
+    r.move_mean = sum / (frames - 1);
+    r.clock = c;
+    r.move_sd = sqrt(fmax(0.0, sum_sq / (frames - 1) - r.move_mean * r.move_mean));
+    /* every tick real time asked for has come, none more (within rounding of the sums of frame times) */
+    uint64_t fewest = (uint64_t)((last - 1e-6 - STEP_MS) / (STEP_MS * STEPS_PER_TICK)) + 1;
+    uint64_t most = (uint64_t)((last + 1e-6 - STEP_MS) / (STEP_MS * STEPS_PER_TICK)) + 1;
+    if (c.skipped_ms == 0.0 && (r.ticks < fewest || r.ticks > most)) {
+        fprintf(stderr, "%.0f Hz: %llu ticks instead of %llu\n", hz, (unsigned long long)r.ticks, (unsigned long long)fewest);
+        exit(1);
+    }
+    return r;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(double ms) {
+    long long ns = (long long)(ms * 1e6);
+    struct timespec ts = { (time_t)(ns / 1000000000), (long)(ns % 1000000000) };
+    nanosleep(&ts, NULL);
+}
+
+/* Waits of ms the given way (0 - whole ms, 1 - exact, 2 - with a spin), prints how far off they end */
+static void time_sleeps(double ms, int way) {
+    double sum = 0.0, max = 0.0;
+    for (int i = 0; i < SLEEPS; i++) {
+        double t0 = now_ms();
+        if (way == 0) sleep_ms(floor(ms));
+        else if (way == 1) sleep_ms(ms);
+        else sim_sleep_precise(ms, SPIN_MS);
+        double off = fabs(now_ms() - t0 - ms);
+        sum += off;
+        if (off > max) max = off;
+    }
+    printf(" %8.3f %7.3f", sum / SLEEPS, max);
+}
+
+int main(void) {
+    static const double rates[] = { 60.0, 120.0, 144.0 };
+    static const struct { double jitter_ms, drop; const char *name; } loads[] = {
+        { 0.0, 0.0, "steady" },
+        { 2.0, 0.0, "2 ms jitter" },
+        { 2.0, 0.05, "2 ms jitter, 5% dropped" },
+        { 8.0, 0.20, "8 ms jitter, 20% dropped" },
+    };
+    pcg32_random_t rng;
+    pcg32_srandom_r(&rng, 42, 11);
+
+    printf("%.0f s of play per case; off: fields drawn off real time at most, move: fields per frame mean/sd\n",
+           RUN_MS / 1000.0);
+    printf("late: ms steps come after they were due avg/max, jitter: ms their intervals are off avg/max\n");
+    printf("%-6s %-26s %8s %18s %18s %16s %16s\n", "Hz", "frames", "ticks", "stepped off/sd", "smooth off/sd", "late", "jitter");
+    for (size_t h = 0; h < sizeof(rates)/sizeof(rates[0]); h++) {
+        for (size_t l = 0; l < sizeof(loads)/sizeof(loads[0]); l++) {
+            pcg32_random_t rng_copy = rng;
+            Result stepped = run(rates[h], loads[l].jitter_ms, loads[l].drop, false, &rng_copy);
+            Result smooth = run(rates[h], loads[l].jitter_ms, loads[l].drop, true, &rng);
+            const SimClock *c = &smooth.clock;
+            printf("%-6.0f %-26s %8llu %9.3f %8.4f %9.3f %8.4f %7.2f %8.2f %7.2f %8.2f\n", rates[h], loads[l].name,
+                   (unsigned long long)smooth.ticks, stepped.max_off, stepped.move_sd, smooth.max_off, smooth.move_sd,
+                   c->late_sum_ms / c->steps, c->late_max_ms, c->jitter_sum_ms / (c->steps - 1), c->jitter_max_ms);
+        }
+    }
+
+    static const double waits[] = { 1.5, 4.2, 6.9, 8.3, 16.7 };
+    printf("\nwaits of ms end off by ms avg/max: whole ms (SDL_Delay), exact sleep, sleep and %.1f ms spin\n", SPIN_MS);
+    for (size_t w = 0; w < sizeof(waits)/sizeof(waits[0]); w++) {
+        printf("%6.1f", waits[w]);
+        for (int way = 0; way < 3; way++) time_sleeps(waits[w], way);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool arena_start(uint64_t seed);
+void arena_update(void);
+void arena_free(void);
+
+#endif // ARENA_H
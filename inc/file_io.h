@@ -4,5 +4,6 @@
 #include <SDL2/SDL.h>
 
 void load_texture(SDL_Texture **txt, const char *filepath);
+void ensure_dir_exists(const char *dir_path);
 
 #endif // FILE_IO_H
@@ -2,16 +2,23 @@
 #define GAME_LOGIC_H
 
 #include <SDL2/SDL.h>
+#include "sim.h"
 
 void start_play(void);
+void start_play_seed(uint64_t seed);
+void start_replay(void);
+void start_restored_play(uint32_t frame);
 void pause_play(void);
 void resume_play(void);
 void update_play_state(void);
+void advance_play_state(SimInput input);
+void rewind_play_state(void);
 void handle_playing_events(SDL_Event *event);
 void handle_paused_events(SDL_Event *event);
 void switch_to_game_over(void);
 // Board utilities, to be used by other modules
 void reinit_game_board_resources(void);
+void sync_game_board(void);
 void create_windowed_display(void);
 void create_fullscreen_display(void);
 
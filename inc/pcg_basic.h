@@ -32,6 +32,7 @@
 #define PCG_BASIC_H_INCLUDED 1
 
 #include <inttypes.h>
+#include <stddef.h>
 
 #if __cplusplus
 extern "C" {
@@ -71,6 +72,34 @@ uint32_t pcg32_random_r(pcg32_random_t* rng);
 uint32_t pcg32_boundedrand(uint32_t bound);
 uint32_t pcg32_boundedrand_r(pcg32_random_t* rng, uint32_t bound);
 
+// pcg32_advance(delta)
+// pcg32_advance_r(rng, delta):
+//     Multi-step advance functions (jump-ahead, jump-back)
+
+void pcg32_advance(uint64_t delta);
+void pcg32_advance_r(pcg32_random_t* rng, uint64_t delta);
+
+// pcg32_fill(buf, n)
+// pcg32_fill_r(rng, buf, n):
+//     Fill buf with n uniformly distributed 32-bit numbers - the same
+//     numbers n calls of pcg32_random_r would return, but generated
+//     PCG32_LANES at a time
+
+#define PCG32_LANES 8
+
+void pcg32_fill(uint32_t* buf, size_t n);
+void pcg32_fill_r(pcg32_random_t* rng, uint32_t* buf, size_t n);
+
+// pcg32_fill_bounded(buf, n, bound)
+// pcg32_fill_bounded_r(rng, buf, n, bound):
+//     Fill buf with n uniformly distributed numbers, r, where 0 <= r < bound
+//     (multiply-shift mapping, not the same numbers as pcg32_boundedrand_r).
+//     No number is below a bound of 0, buf is then left as it is.
+
+void pcg32_fill_bounded(uint32_t* buf, size_t n, uint32_t bound);
+void pcg32_fill_bounded_r(pcg32_random_t* rng, uint32_t* buf, size_t n,
+                          uint32_t bound);
+
 #if __cplusplus
 }
 #endif
@@ -0,0 +1,10 @@
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include <stdbool.h>
+
+bool remote_start(const char *path);
+void remote_poll(void);
+int remote_serve_headless(const char *path);
+
+#endif // REMOTE_H
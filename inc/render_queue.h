@@ -0,0 +1,49 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+/*
+ * Queue of the draws of a frame. Sprites and rectangles are recorded with a
+ * key of layer, texture, blend mode and color and drawn by
+ * render_queue_flush() before the frame is presented: layer by layer, and
+ * within a layer sorted so that draws of the same texture, blend mode and
+ * color come together and go to the sprite batcher in as few pieces as
+ * possible. Draws of the same key keep the order they were given in. Whatever
+ * has to cover something else of the frame goes to a higher layer; within a
+ * layer draws may be reordered.
+ */
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+typedef enum e_RenderLayer {
+    RenderLayerBoard, /* board or menu background */
+    RenderLayerSprites, /* snakes, food */
+    RenderLayerHud, /* score line, pause text */
+    RenderLayerPanel, /* darkened box of a menu or overlay */
+    RenderLayerPanelContent, /* what is in the box */
+    RenderLayerTop /* fps counter */
+} RenderLayer;
+
+typedef struct RenderQueueStats {
+    uint64_t draws; /* sprites and rectangles given */
+    uint64_t draw_calls; /* renderer calls they took */
+    uint64_t texture_changes; /* draws of another texture than the draw before */
+    uint64_t blend_changes; /* blend mode set on a texture or for rectangles */
+    uint64_t color_changes; /* tint or rectangle color other than of the draw before */
+} RenderQueueStats;
+
+void render_queue_init(SDL_Renderer *renderer, bool sorting);
+void render_queue_free(void);
+void render_queue_layer(RenderLayer layer);
+void render_queue_copy(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst);
+void render_queue_copy_n(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int n);
+void render_queue_copy_color(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, SDL_Color color);
+void render_queue_copy_blend(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, SDL_BlendMode blend,
+                             SDL_Color color);
+void render_queue_fill_rect(const SDL_Rect *rect, SDL_Color color);
+void render_queue_outline_rect(const SDL_Rect *rect, SDL_Color color);
+void render_queue_flush(void);
+const RenderQueueStats *render_queue_last_frame(void);
+const RenderQueueStats *render_queue_totals(void);
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,9 @@
+#ifndef REPLAYS_H
+#define REPLAYS_H
+
+#include "sim_replay.h"
+
+void replays_save(const SimReplay *replay);
+int replays_play_fast(const char *path);
+
+#endif // REPLAYS_H
@@ -0,0 +1,285 @@
+#ifndef SIM_H
+#define SIM_H
+
+/*
+ * Headless game simulation core.
+ * Contains only the rules of the game - no SDL, no audio, no globals.
+ * Everything a simulation needs lives in SimContext, side effects are
+ * reported back to the caller as a list of SimEvents.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pcg_basic.h"
+
+#define TOTAL_CHARS (24) // Number of total characters
+#define FOOD_KINDS (6) // Number of different kinds of food
+#define WALL_KINDS (4) // Number of different kinds of wall
+#define SIM_MAX_EVENTS (8) // Upper bound of events generated by a single tick
+#define SIM_MAX_CHANGES (4) // Upper bound of board fields changed by a single tick
+#define SIM_JOURNAL_SIZE (256) // Board changes kept for journal readers, power of two
+#define SIM_MAX_SIDE (UINT16_MAX) // Largest board width or height, positions are kept in 16 bits
+#define SIM_MAX_FIELDS (1 << 26) // Largest board including layout padding, keeps field counts in int
+
+typedef enum e_FieldType { /* indicates what is inside game board field */
+    Empty,
+    Snake,
+    Food,
+    Wall
+} FieldType;
+
+/*
+ * Game board field packed into a single unsigned integer:
+ *   bits 0-1: type of the field (FieldType)
+ *   bits 2-3: direction to previous piece of snake (snake fields only)
+ *   bits 4- : parameter (kind of food, kind of wall)
+ * Width is selected at build time with SIM_CELL_BITS (8 or 16). 8 bits leave
+ * room for 16 kinds of items, 16 bits for 4096.
+ */
+#ifndef SIM_CELL_BITS
+#define SIM_CELL_BITS (8)
+#endif
+#if SIM_CELL_BITS == 8
+typedef uint8_t BoardField;
+#elif SIM_CELL_BITS == 16
+typedef uint16_t BoardField;
+#else
+#error "SIM_CELL_BITS must be 8 or 16"
+#endif
+
+#define FIELD_TYPE_MASK (0x3)
+#define FIELD_DIR_SHIFT (2)
+#define FIELD_DIR_MASK (0x3)
+#define FIELD_KIND_SHIFT (4)
+
+static inline BoardField make_field(FieldType type, int kind, int pdx, int pdy) {
+    /* directions: 0 right(or none), 1 down, 2 left, 3 up - so that Empty is 0 */
+    int dir = pdx ? 1 - pdx : (pdy ? 2 - pdy : 0);
+    return (BoardField)(type | (dir << FIELD_DIR_SHIFT) | (kind << FIELD_KIND_SHIFT));
+}
+
+static inline FieldType field_type(BoardField field) {
+    return (FieldType)(field & FIELD_TYPE_MASK);
+}
+
+static inline int field_kind(BoardField field) {
+    return field >> FIELD_KIND_SHIFT;
+}
+
+/* delta x to previous piece of snake */
+static inline int field_pdx(BoardField field) {
+    int dir = (field >> FIELD_DIR_SHIFT) & FIELD_DIR_MASK;
+    return (dir == 0) - (dir == 2);
+}
+
+/* delta y to previous piece of snake */
+static inline int field_pdy(BoardField field) {
+    int dir = (field >> FIELD_DIR_SHIFT) & FIELD_DIR_MASK;
+    return (dir == 1) - (dir == 3);
+}
+
+/*
+ * Order of fields in board memory, selected at build time with SIM_BOARD_LAYOUT:
+ *   SIM_LAYOUT_ROWS:   row after row (w*y + x)
+ *   SIM_LAYOUT_TILED:  8x8 tiles in row order, rows of a tile in one cache line
+ *   SIM_LAYOUT_MORTON: Z-order curve over the board padded to a power of two square
+ * Tiled and Morton layouts keep vertical neighbours close together in memory.
+ * The board is only ever accessed through sim_field_index(), everything else
+ * (set of empty fields, bitboards) uses row order regardless of the layout.
+ */
+#define SIM_LAYOUT_ROWS (1) /* not 0, which an unknown name evaluates to in #if */
+#define SIM_LAYOUT_TILED (2)
+#define SIM_LAYOUT_MORTON (3)
+#ifndef SIM_BOARD_LAYOUT
+#define SIM_BOARD_LAYOUT SIM_LAYOUT_ROWS
+#endif
+#if SIM_BOARD_LAYOUT != SIM_LAYOUT_ROWS && SIM_BOARD_LAYOUT != SIM_LAYOUT_TILED && \
+    SIM_BOARD_LAYOUT != SIM_LAYOUT_MORTON
+#error "SIM_BOARD_LAYOUT must be SIM_LAYOUT_ROWS, SIM_LAYOUT_TILED or SIM_LAYOUT_MORTON"
+#endif
+#define SIM_TILE_BITS (3) /* tiles are 8x8 fields */
+
+static inline int sim_index_rows(int w, int x, int y) {
+    return w * y + x;
+}
+
+static inline int sim_index_tiled(int tiles_w, int x, int y) {
+    const int t = SIM_TILE_BITS, m = (1 << t) - 1;
+    int tile = tiles_w * (y >> t) + (x >> t);
+    return (tile << (2 * t)) | ((y & m) << t) | (x & m);
+}
+
+/* spreads lower 16 bits of v to even bit positions */
+static inline uint32_t morton_spread(uint32_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+static inline int sim_index_morton(int x, int y) {
+    return (int)(morton_spread(x) | (morton_spread(y) << 1));
+}
+
+typedef struct SimSegment { /* position of single piece of snake body */
+    int x, y;
+} SimSegment;
+
+typedef enum e_SimInput { /* direction change requested for the next tick */
+    SimInputNone,
+    SimInputLeft,
+    SimInputRight,
+    SimInputUp,
+    SimInputDown
+} SimInput;
+
+typedef enum e_SimEventType {
+    SimEventFoodEaten, /* head entered food at (x,y), p is the food kind */
+    SimEventFoodSeeded, /* new food of kind p placed at (x,y) */
+    SimEventWallSeeded, /* new wall of kind p placed at (x,y) */
+    SimEventExpand, /* snake grew by one segment at tail (x,y) */
+    SimEventDied /* head crashed while moving to (x,y) */
+} SimEventType;
+
+typedef struct SimEvent {
+    SimEventType type;
+    int x, y;
+    int p;
+} SimEvent;
+
+typedef struct SimEvents {
+    int count;
+    SimEvent items[SIM_MAX_EVENTS];
+} SimEvents;
+
+/*
+ * Board journal: every change of a board field is appended to a fixed ring
+ * in SimContext. Any number of readers (renderer, autosave, observers) follow
+ * it at their own pace, each with its own cursor, instead of rescanning the
+ * board. A reader that falls more than SIM_JOURNAL_SIZE changes behind, or
+ * reads across a reset of the whole board, is told to resync.
+ * Head moved = Snake written, tail moved = Snake cleared, item spawned =
+ * Food or Wall written over Empty.
+ */
+typedef struct SimChange { /* single board field change */
+    uint32_t tick; /* tick that made the change */
+    uint16_t x, y;
+    BoardField old, value;
+} SimChange;
+
+typedef enum e_SimJournalStatus {
+    SimJournalChange, /* next change was read */
+    SimJournalEnd, /* reader is up to date */
+    SimJournalResync /* changes were lost - rescan the board, cursor is now up to date */
+} SimJournalStatus;
+
+typedef struct SimFieldChange { /* previous content of a field changed by a tick */
+    int cell; /* field number in row order */
+    BoardField old;
+    int free_slot; /* slot in free_cells the field was taken from, if it was empty */
+    int free_moved; /* field moved into that slot */
+} SimFieldChange;
+
+typedef struct SimUndo { /* everything needed to take back a single tick */
+    int dhx, dhy, hx, hy;
+    int body_head, length;
+    int fx, fy;
+    int score, expand_counter;
+    bool alive;
+    pcg32_random_t rng;
+    uint32_t tick;
+    int count;
+    SimFieldChange changes[SIM_MAX_CHANGES];
+} SimUndo;
+
+typedef enum e_SimFloodKernel { /* implementation of the flood-fill kernel */
+    SimFloodScalar,
+    SimFloodSse2,
+    SimFloodAvx2
+} SimFloodKernel;
+
+typedef struct SimContext {
+    int w, h; /* board dimensions in fields */
+    BoardField *board; /* in SIM_BOARD_LAYOUT order, see sim_field_index() */
+    int board_cells; /* allocated fields including layout padding */
+    int tiles_w; /* tiles per board row (tiled layout) */
+    int dhx, dhy; /* current direction of movement */
+    int hx, hy; //head position
+    /* Snake body: ring buffer of segment positions, ordered from tail to head.
+       Characters stay at the same distance from the head while the snake moves,
+       so they are kept in a plain array indexed by that distance (0 = head). */
+    SimSegment *body;
+    uint8_t *chars;
+    int body_cap; /* capacity of body ring and chars array */
+    int body_head; /* ring index of the head segment */
+    int length; /* number of snake segments */
+    /* Set of empty fields: dense array of field indices plus position of each
+       field in that array (-1 if field is occupied), for O(1) random picks. */
+    int *free_cells;
+    int *free_pos;
+    int free_count;
+    /* Occupancy bitboard (bit set = snake or wall) and result of the last
+       flood fill, bb_stride 64-bit words per row. Bits past w are blocked. */
+    uint64_t *blocked;
+    uint64_t *reach;
+    int bb_stride;
+    uint32_t *fill_queue; /* w*h fields as y << 16 | x, for fills the sweeps give up on */
+    SimFloodKernel flood_kernel;
+    int fx, fy; /* food position, -1 if there is no food */
+    int score;
+    int expand_counter; /* segments still to grow */
+    int growth; /* segments to grow per food eaten: 0 - current score (the game rule), n - always n */
+    bool alive;
+    uint32_t tick; /* ticks since the game started */
+    /* Journal ring of SIM_JOURNAL_SIZE board changes, see SimChange */
+    SimChange *journal;
+    uint32_t journal_seq; /* number of changes written so far */
+    uint32_t journal_floor; /* first change after the last reset of the whole board */
+    pcg32_random_t rng; /* every random choice of the game comes from here */
+    SimUndo *undo; /* where sim_set_field() records changes, NULL if not recording */
+} SimContext;
+
+bool sim_board_size_is_valid(int64_t w, int64_t h);
+bool sim_init(SimContext *ctx, int w, int h);
+void sim_free(SimContext *ctx);
+bool sim_reset(SimContext *ctx, uint64_t seed);
+bool sim_input_is_valid(const SimContext *ctx, SimInput input);
+void sim_step(SimContext *ctx, SimInput input, SimEvents *events);
+void sim_step_undoable(SimContext *ctx, SimInput input, SimEvents *events, SimUndo *undo);
+void sim_undo(SimContext *ctx, const SimUndo *undo);
+bool sim_clone(SimContext *dst, const SimContext *src);
+SimJournalStatus sim_journal_next(const SimContext *ctx, uint32_t *cursor, SimChange *change);
+bool sim_place_snake(SimContext *ctx, const SimSegment *body, int len);
+void sim_place_item(SimContext *ctx, FieldType item_type, int x, int y, int p);
+void sim_set_field(SimContext *ctx, int x, int y, BoardField value);
+void sim_set_board_field(SimContext *ctx, int x, int y, BoardField value);
+void sim_update_free(SimContext *ctx, int i, FieldType old_type, FieldType new_type);
+
+/* Position of field (x,y) in ctx->board */
+static inline int sim_field_index(const SimContext *ctx, int x, int y) {
+#if SIM_BOARD_LAYOUT == SIM_LAYOUT_TILED
+    return sim_index_tiled(ctx->tiles_w, x, y);
+#elif SIM_BOARD_LAYOUT == SIM_LAYOUT_MORTON
+    (void)ctx;
+    return sim_index_morton(x, y);
+#elif SIM_BOARD_LAYOUT == SIM_LAYOUT_ROWS
+    return sim_index_rows(ctx->w, x, y);
+#else
+#error "SIM_BOARD_LAYOUT must be SIM_LAYOUT_ROWS, SIM_LAYOUT_TILED or SIM_LAYOUT_MORTON"
+#endif
+}
+
+static inline BoardField sim_field(const SimContext *ctx, int x, int y) {
+    return ctx->board[sim_field_index(ctx, x, y)];
+}
+
+/* Returns segment at given distance from the head (0 = head, length-1 = tail) */
+static inline SimSegment* sim_segment(const SimContext *ctx, int rank) {
+    int i = ctx->body_head - rank;
+    if (i < 0) i += ctx->body_cap;
+    return &ctx->body[i];
+}
+
+#endif // SIM_H
@@ -0,0 +1,75 @@
+#ifndef SIM_ARENA_H
+#define SIM_ARENA_H
+
+/*
+ * Arena: many snakes sharing one board, e.g. the player against bots.
+ * Snake state is kept as a structure of arrays indexed by snake. Bodies are
+ * not stored as lists: every snake field links to the next segment towards
+ * the head, so a tail follows the links and a snake costs the same however
+ * long it is. All snakes move at once; a tick first decides every move
+ * (board edge, bodies, heads meeting in one field or swapping places)
+ * against the board as it was, then applies them all, so the order of snakes
+ * does not matter.
+ * Rules: tails of snakes that do not grow leave their field in the same
+ * tick (it can be entered), heads entering the same field all die, and so do
+ * two heads entering each other's field; a dead snake disappears. Food is kept
+ * at food_target pieces.
+ */
+
+#include "sim.h"
+
+#define SIM_ARENA_FOOD (0xFFFF) /* content of a field holding food */
+#define SIM_ARENA_MAX_SNAKES (0xFFFE) /* snake s is stored as s+1 */
+
+typedef struct SimArena {
+    int w, h; /* board dimensions in fields */
+    int n; /* number of snakes */
+    /* board in row order: 0 empty, s+1 snake s, SIM_ARENA_FOOD */
+    uint16_t *cell;
+    uint8_t *link; /* snake fields: direction to the next segment towards the head */
+    /* empty fields and food: dense arrays of field indices plus the position of
+       every field in the array it is in, for O(1) random picks and removal */
+    int *free_cells;
+    int free_count;
+    int *food_cells;
+    int food_count;
+    int *slot;
+    int food_target; /* pieces of food kept on the board */
+    int growth; /* segments to grow per food eaten */
+    /* per snake state */
+    int32_t *hx, *hy; /* head */
+    int32_t *tx, *ty; /* tail */
+    int32_t *dhx, *dhy; /* direction of movement */
+    int32_t *length;
+    int32_t *grow; /* segments still to grow */
+    int32_t *score;
+    uint8_t *alive;
+    /* scratch of a tick: target field of every snake and who claimed each field */
+    int32_t *target;
+    uint8_t *dying;
+    uint32_t *claim_tick;
+    int32_t *claim_by;
+    uint32_t tick;
+    pcg32_random_t rng;
+    /* statistics */
+    long head_on; /* snakes that died meeting another head */
+    long crashed; /* snakes that died on the edge or a body */
+} SimArena;
+
+bool sim_arena_init(SimArena *a, int n, int w, int h);
+void sim_arena_free(SimArena *a);
+void sim_arena_reset(SimArena *a, uint64_t seed);
+bool sim_arena_spawn(SimArena *a, int s, int length);
+int sim_arena_step(SimArena *a, const SimInput *inputs);
+SimInput sim_arena_bot_input(SimArena *a, int s);
+
+/* Direction stored in link: 0 right, 1 down, 2 left, 3 up */
+static inline int sim_arena_link_dx(int link) {
+    return (link == 0) - (link == 2);
+}
+
+static inline int sim_arena_link_dy(int link) {
+    return (link == 1) - (link == 3);
+}
+
+#endif // SIM_ARENA_H
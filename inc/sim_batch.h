@@ -0,0 +1,80 @@
+#ifndef SIM_BATCH_H
+#define SIM_BATCH_H
+
+/*
+ * Lockstep stepping of many games on boards of the same size, e.g. for
+ * training controllers against the exact rules of the game.
+ * The state every tick needs (head, direction, food, growth, ...) is kept as
+ * a structure of arrays indexed by game, and the occupancy bitboards of all
+ * games share one block of memory. Moves and collisions of all games are
+ * planned together in one pass, 4 games at a time with SSE2, before any game
+ * moves. Most ticks just move the snake, which is applied right away to board,
+ * bitboard and journal; the set of empty fields follows every
+ * SIM_BATCH_PENDING moves. The few games that eat, grow or die in a tick go
+ * through sim_step(). Results, board journal included, are bit-identical to
+ * stepping every game on its own.
+ * Moving a snake touches as much memory of its game as sim_step() does, and
+ * that is what a tick costs with thousands of games, so the batch steps about
+ * as fast as single games there (see vonsh-lockstepbench); the gain is in the
+ * plan, the moves are not shared.
+ */
+
+#include "sim.h"
+
+#define SIM_BATCH_PENDING (32) /* moves of a game before its empty fields are brought up to date */
+
+typedef struct SimBatch {
+    int n; /* number of games */
+    int w, h;
+    SimContext *games; /* rest of the state, up to date after sim_batch_sync() */
+    /* per game state used by every tick, authoritative over games[] */
+    int32_t *hx, *hy;
+    int32_t *dhx, *dhy;
+    int32_t *fx, *fy;
+    int32_t *expand_counter;
+    uint32_t *tick;
+    uint8_t *alive;
+    /* occupancy bitboards of all games, bb_words each (see SimContext.blocked) */
+    uint64_t *blocked;
+    int bb_words;
+    /* observation: occupancy of every game packed to grid_words words, bit w*y+x */
+    uint64_t *grid;
+    int grid_words;
+    /* empty fields the moves of every game took and freed since its set of
+       empty fields was last brought up to date, SIM_BATCH_PENDING each */
+    int32_t *pending;
+    uint8_t *pending_moves;
+    /* plan of the current tick: new direction and what the move does */
+    int32_t *plan_dx, *plan_dy;
+    uint8_t *plan;
+    /* statistics */
+    long moves; /* ticks applied by the batch itself */
+    long slow_steps; /* ticks that went through sim_step() */
+} SimBatch;
+
+typedef struct SimObservation { /* what a controller sees of a single game */
+    const uint64_t *grid; /* bit w*y+x set if field (x,y) holds snake or wall */
+    int hx, hy; /* head */
+    int fx, fy; /* food, -1 if there is none */
+    bool alive;
+} SimObservation;
+
+bool sim_batch_init(SimBatch *b, int n, int w, int h);
+void sim_batch_free(SimBatch *b);
+bool sim_batch_reset(SimBatch *b, int g, uint64_t seed);
+int sim_batch_step(SimBatch *b, const SimInput *inputs);
+const SimContext* sim_batch_sync(SimBatch *b, int g);
+
+static inline SimObservation sim_batch_observe(const SimBatch *b, int g) {
+    SimObservation obs = { b->grid + (size_t)b->grid_words * g, b->hx[g], b->hy[g], b->fx[g], b->fy[g],
+                           b->alive[g] != 0 };
+    return obs;
+}
+
+/* Tells if field (x,y) of the observed game holds snake or wall */
+static inline bool sim_observed_blocked(const SimBatch *b, const SimObservation *obs, int x, int y) {
+    int i = b->w * y + x;
+    return (obs->grid[i / 64] >> (i % 64)) & 1;
+}
+
+#endif // SIM_BATCH_H
@@ -0,0 +1,37 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+/*
+ * Fixed step game clock. Real time measured by the caller is added up and
+ * handed out in steps of equal length, however long the frames in between
+ * take, so the speed of the game does not depend on the frame rate and
+ * dropped frames are caught up with exactly. The part of a step gone by
+ * tells the renderer how far to move things in between steps. How late the
+ * steps are handed out after they were due is kept as statistics.
+ */
+
+#include "sim.h"
+
+#define SIM_CLOCK_LATE_BUCKETS (12) /* lateness histogram: under 0.1 ms, 0.1-0.2 ms, 0.2-0.4 ms, ..., last one open */
+
+typedef struct SimClock {
+    double step_ms; /* length of a step */
+    double max_lag_ms; /* real time not stepped through yet is capped to this after stalls */
+    double lag_ms; /* real time not stepped through yet */
+    uint64_t steps; /* steps handed out */
+    double skipped_ms; /* real time dropped by the cap */
+    /* statistics */
+    double late_sum_ms, late_max_ms; /* how long after they were due steps were handed out */
+    double jitter_sum_ms, jitter_max_ms; /* how much the time between handed out steps differs from step_ms */
+    double last_late_ms;
+    uint64_t late_hist[SIM_CLOCK_LATE_BUCKETS];
+    uint64_t bursts; /* calls handing out more than one step, the backlog of a late frame */
+} SimClock;
+
+void sim_clock_init(SimClock *c, double step_ms, double max_lag_ms);
+int sim_clock_advance(SimClock *c, double elapsed_ms);
+double sim_clock_alpha(const SimClock *c);
+float sim_clock_tick_phase(uint32_t step, int steps_per_tick, double alpha);
+void sim_sleep_precise(double ms, double spin_ms);
+
+#endif // SIM_CLOCK_H
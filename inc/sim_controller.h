@@ -0,0 +1,71 @@
+#ifndef SIM_CONTROLLER_H
+#define SIM_CONTROLLER_H
+
+/*
+ * Controllers: anything that decides direction changes of the snake instead
+ * of the player. The front end asks the controller once before every tick.
+ *
+ * Autopilot: built-in controller heading for the food along shortest paths.
+ * It keeps distance of every field to the food (BFS over fields the snake can
+ * enter) and follows the board journal to update it incrementally:
+ *   field freed (tail moved)    - distances that got shorter spread from it,
+ *   field blocked (head, wall)  - only fields whose every shortest path went
+ *                                 through it are recomputed,
+ *   food moved                  - the whole field is recomputed.
+ * Work per tick is bounded: a recompute is spread over several ticks into a
+ * second field, then the changes since it started are caught up with. Until
+ * then decisions use the stale field, or head greedily for the food if that
+ * moved meanwhile. Every move is checked against the board itself.
+ */
+
+#include "sim.h"
+
+#define SIM_DIST_BLOCKED (-1) /* field holds snake or wall */
+#define SIM_DIST_UNREACHED (INT32_MAX) /* no path to the food */
+
+typedef struct SimController {
+    const char *name;
+    SimInput (*decide)(void *self, const SimContext *ctx); /* input for the next tick */
+    void *self;
+} SimController;
+
+typedef struct SimAutopilot {
+    int w, h;
+    int stride; /* w + 2, the board is surrounded by a border of blocked fields */
+    int32_t *dist; /* steps to the food, see sim_autopilot_field() */
+    int32_t *next; /* field being recomputed over several ticks, swapped with dist when done */
+    int *queue; /* BFS queue of row order field numbers */
+    int *region; /* fields that lost their shortest path */
+    int *seeds; /* region fields reached from outside of it, by new distance */
+    int *buckets; /* seeds per distance, then the start of each distance in seeds */
+    uint8_t *lost; /* membership in region (and candidates while it is searched) */
+    uint32_t cursor; /* read position in the board journal */
+    bool incremental; /* false - recompute the whole field on any change, for comparison */
+    bool valid; /* dist is up to date with the board up to cursor */
+    int food; /* field dist leads to, -1 without food, -2 before the first one */
+    bool rebuilding; /* next is being recomputed, the journal is read once it is done */
+    int rebuild_food; /* field next leads to */
+    int rebuild_rows; /* rows of next initialized so far */
+    int rebuild_head, rebuild_tail; /* BFS of next in queue */
+    /* statistics */
+    long full_updates;
+    long incremental_updates;
+    long fields_visited;
+} SimAutopilot;
+
+bool sim_autopilot_init(SimAutopilot *a, int w, int h);
+void sim_autopilot_free(SimAutopilot *a);
+void sim_autopilot_update(SimAutopilot *a, const SimContext *ctx);
+SimInput sim_autopilot_decide(SimAutopilot *a, const SimContext *ctx);
+SimController sim_autopilot_controller(SimAutopilot *a);
+
+/* Position of field (x,y) in a->dist */
+static inline int sim_autopilot_field(const SimAutopilot *a, int x, int y) {
+    return a->stride * (y + 1) + x + 1;
+}
+
+static inline SimInput sim_controller_decide(const SimController *c, const SimContext *ctx) {
+    return c->decide(c->self, ctx);
+}
+
+#endif // SIM_CONTROLLER_H
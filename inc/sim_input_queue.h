@@ -0,0 +1,34 @@
+#ifndef SIM_INPUT_QUEUE_H
+#define SIM_INPUT_QUEUE_H
+
+/*
+ * Queue of turns given between ticks, one of them taken per tick. A turn is
+ * checked against the direction the snake will have after the turns queued
+ * before it, so quick double turns (a U-turn is two of them) are kept instead
+ * of dropped. Every turn carries the time it was given, in any unit of the
+ * caller; the wait until a tick takes it is kept as statistics.
+ */
+
+#include "sim.h"
+
+#define SIM_INPUT_QUEUE_MAX (8) /* largest depth */
+#define SIM_INPUT_WAIT_BUCKETS (12) /* wait histogram: 0, 1, 2-3, 4-7, ... units, last one open */
+
+typedef struct SimInputQueue {
+    SimInput input[SIM_INPUT_QUEUE_MAX];
+    uint64_t stamp[SIM_INPUT_QUEUE_MAX]; /* when each turn was given */
+    int first, count;
+    int depth; /* turns held at most, 1 keeps only the next one */
+    /* statistics */
+    uint64_t taken; /* turns taken by ticks */
+    uint64_t dropped; /* valid turns given while the queue was full */
+    uint64_t wait_sum, wait_max; /* of taken turns */
+    uint64_t wait_hist[SIM_INPUT_WAIT_BUCKETS];
+} SimInputQueue;
+
+void sim_input_queue_init(SimInputQueue *q, int depth);
+void sim_input_queue_clear(SimInputQueue *q);
+bool sim_input_queue_push(SimInputQueue *q, SimInput input, int dhx, int dhy, uint64_t stamp);
+SimInput sim_input_queue_take(SimInputQueue *q, int dhx, int dhy, uint64_t now);
+
+#endif // SIM_INPUT_QUEUE_H
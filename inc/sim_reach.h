@@ -0,0 +1,42 @@
+#ifndef SIM_REACH_H
+#define SIM_REACH_H
+
+/*
+ * Reachability on the game board.
+ * Board occupancy is mirrored in a bitboard (one bit per field, set for
+ * fields the snake cannot enter) and flood-filled 64 fields at a time.
+ * Winding corridors need a sweep of the board per turn, so after
+ * SIM_FLOOD_MAX_SWEEPS sweeps the rest is filled by scanlines instead.
+ */
+
+#include "sim.h"
+
+#define SIM_FLOOD_MAX_SWEEPS (4) /* random boards of up to a third walls seldom need more */
+
+bool sim_reach_init(SimContext *ctx);
+void sim_reach_free(SimContext *ctx);
+void sim_reach_clear(SimContext *ctx);
+int sim_flood_fill(SimContext *ctx, int x, int y);
+bool sim_reaches(SimContext *ctx, int x, int y, int tx, int ty);
+bool sim_flood_kernel_available(SimFloodKernel kernel);
+const char* sim_flood_kernel_name(SimFloodKernel kernel);
+
+/* Marks field as blocked or passable in the occupancy bitboard */
+static inline void sim_reach_set_blocked(SimContext *ctx, int x, int y, bool blocked) {
+    uint64_t *word = &ctx->blocked[ctx->bb_stride * y + x / 64];
+    uint64_t bit = (uint64_t)1 << (x % 64);
+    if (blocked) *word |= bit;
+    else *word &= ~bit;
+}
+
+static inline bool sim_reach_is_blocked(const SimContext *ctx, int x, int y) {
+    return (ctx->blocked[ctx->bb_stride * y + x / 64] >> (x % 64)) & 1;
+}
+
+/* Tells if (x,y) was reached by the last sim_flood_fill() */
+static inline bool sim_reached(const SimContext *ctx, int x, int y) {
+    /* first row of reach is the guard row */
+    return (ctx->reach[ctx->bb_stride * (y + 1) + x / 64] >> (x % 64)) & 1;
+}
+
+#endif // SIM_REACH_H
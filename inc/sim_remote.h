@@ -0,0 +1,59 @@
+#ifndef SIM_REMOTE_H
+#define SIM_REMOTE_H
+
+/*
+ * Remote control: an external process drives the game over a Unix domain
+ * socket, one client at a time. Requests and replies are single text lines
+ * (only the board takes more):
+ *   state                 -> state TICK SCORE ALIVE HX HY DHX DHY FX FY LENGTH
+ *   input L|R|U|D         -> ok        direction change for the next tick
+ *   mode realtime|stepped -> ok        game runs by its own clock / only on step
+ *   step K [INPUTS]       -> state ... stepped mode: up to K ticks, tick i gets
+ *                                      INPUTS[i] (L R U D, anything else = none),
+ *                                      stops early when the snake dies
+ *   reset [SEED]          -> state ... new game
+ *   board                 -> board W H, then H lines of W fields:
+ *                                      . empty, o snake, @ head, * food, # wall
+ *   quit                  -> connection is closed
+ *   shutdown              -> ok        server stops (the game quits)
+ * Anything else is answered with "error ...".
+ */
+
+#include <stddef.h>
+#include "sim.h"
+
+#define SIM_REMOTE_MAX_STEP (65536) /* ticks a single step request can ask for */
+#define SIM_REMOTE_LINE_MAX (SIM_REMOTE_MAX_STEP + 64) /* longest request */
+
+typedef struct SimRemoteHost { /* how requests act on the game */
+    void (*step)(void *self, SimInput input); /* advances the game by one tick */
+    void (*reset)(void *self, uint64_t seed); /* starts a new game */
+    const SimContext *ctx; /* game the requests are about */
+    void *self;
+} SimRemoteHost;
+
+typedef struct SimRemote {
+    int listen_fd;
+    int client_fd; /* -1 while nobody is connected */
+    char *path; /* socket file, removed on close */
+    char *in; /* request being received */
+    size_t in_len;
+    char *out; /* replies not sent yet */
+    size_t out_len, out_cap;
+    bool stepped; /* game advances only on step requests */
+    SimInput input; /* requested for the next realtime tick */
+    bool shutdown; /* client asked the server to stop */
+    pcg32_random_t rng; /* seeds of resets without one */
+    /* statistics */
+    long requests;
+    long ticks_stepped;
+} SimRemote;
+
+bool sim_remote_listen(SimRemote *r, const char *path);
+void sim_remote_close(SimRemote *r);
+int sim_remote_poll(SimRemote *r, const SimRemoteHost *host, int timeout_ms);
+SimInput sim_remote_take_input(SimRemote *r);
+int sim_remote_serve(SimRemote *r, SimContext *ctx, int tick_ms);
+int sim_remote_connect(const char *path);
+
+#endif // SIM_REMOTE_H
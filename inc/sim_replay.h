@@ -0,0 +1,48 @@
+#ifndef SIM_REPLAY_H
+#define SIM_REPLAY_H
+
+/*
+ * Replays: a game is fully determined by board dimensions, the seed passed to
+ * sim_reset() and the inputs given to sim_step(), so only those are recorded.
+ * Ticks without a direction change are not stored at all.
+ *
+ * File format (all numbers are LEB128 varints):
+ *   "VONSHRPL" magic, version byte, w, h, seed, ground_seed,
+ *   one number per input: (ticks since previous input) * 5 + SimInput,
+ *   end mark: (ticks since previous input) * 5 + 0, then final score.
+ * The end mark gives the number of ticks the game lasted.
+ */
+
+#include <stddef.h>
+#include "sim.h"
+
+#define SIM_REPLAY_VERSION (2) /* bumped when the rules play the same inputs out differently */
+
+typedef struct SimReplay {
+    int w, h;
+    uint64_t seed; /* seed of sim_reset() */
+    uint32_t ground_seed; /* cosmetic seed of the front end, not used by the rules */
+    uint32_t ticks; /* length of a finished game */
+    int score; /* final score of a finished game */
+    bool finished; /* end mark was written or read */
+    uint8_t *data; /* encoded inputs */
+    size_t size, cap;
+    uint32_t last_tick; /* tick of the last input recorded or read */
+    /* playback */
+    size_t pos; /* read position in data */
+    uint32_t next_tick; /* tick of the next input */
+    SimInput next_input; /* SimInputNone after the end mark */
+} SimReplay;
+
+void sim_replay_start(SimReplay *r, int w, int h, uint64_t seed, uint32_t ground_seed);
+bool sim_replay_record(SimReplay *r, uint32_t tick, SimInput input);
+void sim_replay_truncate(SimReplay *r, uint32_t tick);
+bool sim_replay_finish(SimReplay *r, uint32_t ticks, int score);
+bool sim_replay_save(const SimReplay *r, const char *path);
+bool sim_replay_load(SimReplay *r, const char *path);
+void sim_replay_rewind(SimReplay *r);
+SimInput sim_replay_input(SimReplay *r, uint32_t tick);
+bool sim_replay_run(SimReplay *r, SimContext *ctx);
+void sim_replay_free(SimReplay *r);
+
+#endif // SIM_REPLAY_H
@@ -0,0 +1,44 @@
+#ifndef SIM_REWIND_H
+#define SIM_REWIND_H
+
+/*
+ * Rewind: ring of the last ticks of a game, each stored as the compressed
+ * SimUndo of the tick. Records are backward deltas against the present
+ * state, which is the only full copy needed: stepping back decodes the newest
+ * record against the current state and undoes the tick with sim_undo(), so
+ * any tick in the ring is reached exactly, in constant time per tick.
+ *
+ * Record (all numbers are LEB128 varints, deltas are zigzag encoded):
+ *   mask of the state values that changed, their deltas before - after,
+ *   steps the random generator took, number of changed fields and for each
+ *   field its number, old content and, if it was empty, its slot in the set
+ *   of empty fields and the field moved into that slot.
+ * Every record is framed by its length byte on both ends, so the ring is
+ * read from either end. The oldest records are dropped when the ring runs
+ * out of bytes or holds max_ticks records.
+ */
+
+#include <stddef.h>
+#include "sim.h"
+
+#define SIM_REWIND_MAX_RECORD (160) /* bytes of the largest possible record */
+
+typedef struct SimRewind {
+    uint8_t *buf;
+    size_t cap; /* bytes of buf */
+    size_t head; /* end of the newest record */
+    size_t used; /* bytes held, including framing */
+    uint32_t count; /* records held */
+    uint32_t max_ticks; /* cap of records held */
+    /* statistics */
+    uint64_t bytes_written; /* all records written, including framing */
+    uint64_t records_written;
+} SimRewind;
+
+bool sim_rewind_init(SimRewind *rw, size_t cap, uint32_t max_ticks);
+void sim_rewind_free(SimRewind *rw);
+void sim_rewind_clear(SimRewind *rw);
+void sim_rewind_step(SimRewind *rw, SimContext *ctx, SimInput input, SimEvents *events);
+bool sim_rewind_back(SimRewind *rw, SimContext *ctx);
+
+#endif // SIM_REWIND_H
@@ -0,0 +1,49 @@
+#ifndef SIM_SNAPSHOT_H
+#define SIM_SNAPSHOT_H
+
+/*
+ * Snapshots: the complete state of a game in one binary file, so that it can
+ * be resumed exactly where it stopped (replays would have to play the whole
+ * game again). The arrays of SimContext are written and read in bulk, in the
+ * byte order of the machine and in the board layout of the build; a snapshot
+ * of another machine or build is refused instead of converted.
+ *
+ * File format:
+ *   SimSnapshotHeader (fixed size, no padding),
+ *   board (board_cells fields), empty fields (free_count ints, in the order
+ *   that decides where items are seeded), snake from tail to head (length
+ *   SimSegments), characters from head to tail (length bytes), inputs of the
+ *   replay recorded so far (replay_size bytes).
+ * The header carries a hash of everything after it, which catches accidents
+ * only. Loading therefore also checks empty fields, snake, food and
+ * characters against the board, and rebuilds the bitboard from it.
+ */
+
+#include <stddef.h>
+#include "sim.h"
+#include "sim_replay.h"
+
+#define SIM_SNAPSHOT_VERSION (2)
+
+typedef struct SimSnapshotHeader {
+    char magic[8]; /* "VONSHSNP" */
+    uint32_t order; /* SIM_SNAPSHOT_ORDER as written by the machine */
+    uint16_t version;
+    uint8_t cell_bits; /* SIM_CELL_BITS of the build */
+    uint8_t layout; /* SIM_BOARD_LAYOUT of the build */
+    uint32_t w, h, board_cells, bb_stride; /* bb_stride of the build, the bitboard is not stored */
+    int32_t dhx, dhy, hx, hy, length, free_count;
+    int32_t fx, fy, score, expand_counter, growth, alive;
+    uint32_t tick;
+    uint32_t frame; /* animation phase of the front end, not used by the rules */
+    uint64_t rng_state, rng_inc;
+    uint64_t replay_seed;
+    uint32_t replay_ground_seed, replay_last_tick;
+    uint32_t has_replay, replay_size;
+    uint64_t hash; /* of everything after the header */
+} SimSnapshotHeader;
+
+bool sim_snapshot_save(const SimContext *ctx, const SimReplay *replay, uint32_t frame, const char *path);
+bool sim_snapshot_load(SimContext *ctx, SimReplay *replay, uint32_t *frame, const char *path);
+
+#endif // SIM_SNAPSHOT_H
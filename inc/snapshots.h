@@ -0,0 +1,11 @@
+#ifndef SNAPSHOTS_H
+#define SNAPSHOTS_H
+
+#include "sim.h"
+
+void snapshots_save(void);
+bool snapshots_load(void);
+const SimContext *snapshots_pending(void);
+void snapshots_resume(void);
+
+#endif // SNAPSHOTS_H
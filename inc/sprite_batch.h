@@ -0,0 +1,31 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+/*
+ * Sprite batcher: sprites copied from the same texture one after another are
+ * held and drawn together by a single SDL_RenderGeometry() call (SDL 2.0.18
+ * and later). Sprites are drawn in the order they were given. Anything drawn
+ * past the batcher (filled rectangles, other render targets, presenting)
+ * needs sprite_batch_flush() first. With older SDL, or if the renderer
+ * refuses geometry, every sprite is an SDL_RenderCopy() of its own.
+ */
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+#define SPRITE_BATCH_MAX (4096) /* sprites held before they are drawn */
+
+typedef struct SpriteBatchStats {
+    uint64_t sprites; /* sprites given */
+    uint64_t draw_calls; /* SDL_RenderGeometry() and SDL_RenderCopy() calls they took */
+} SpriteBatchStats;
+
+void sprite_batch_init(SDL_Renderer *renderer, bool batching);
+void sprite_batch_free(void);
+void sprite_batch_copy(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst);
+void sprite_batch_copy_color(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, SDL_Color color);
+void sprite_batch_flush(void);
+bool sprite_batch_is_batching(void);
+const SpriteBatchStats *sprite_batch_stats(void);
+
+#endif // SPRITE_BATCH_H
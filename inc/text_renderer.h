@@ -3,8 +3,8 @@
 
 #include <SDL2/SDL.h>
 #include "types.h"
-void init_text_renderer(SDL_Renderer* renderer, SDL_Texture* texture);
-int render_text(SDL_Renderer* renderer, SDL_Texture* font, const char* text, int x, int y, TextHorizontalAlignment horizontal_align, TextVerticalAlignment vertical_align, TextColor color);
+void init_text_renderer(SDL_Texture* texture);
+int render_text(const char* text, int x, int y, TextHorizontalAlignment horizontal_align, TextVerticalAlignment vertical_align, TextColor color);
 int get_text_width(const char* text);
 int get_text_height(const char* text);
 
@@ -4,23 +4,33 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include <stdbool.h>
+#include "sim.h"
+#include "sim_replay.h"
+#include "sim_rewind.h"
+#include "sim_input_queue.h"
+#include "sim_remote.h"
+#include "sim_arena.h"
+#include "sim_controller.h"
+#include "atlas.h" /* generated from art/sprites.txt */
+
+#if ATLAS_FOOD_COUNT < FOOD_KINDS || ATLAS_WALL_COUNT < WALL_KINDS
+#error "art/sprites.txt needs a food sprite for every kind of food and a wall sprite for every kind of wall"
+#endif
 
 #define RES_DIR "../share/games/vonsh/" /* resources directory */
 #define USER_SHARE_DIR "~/.local/share/vonsh/"
 #define TOP_SCORES_FILE "top_scores_"VERSION_STR".json"
+#define REPLAYS_DIR "replays/" /* replays of finished games, in USER_SHARE_DIR */
+#define SNAPSHOT_FILE "snapshot_"VERSION_STR".vsn" /* game left on quitting, in USER_SHARE_DIR */
 #define INIT_CONFIG_FILE "config.json" /* configuration file name */
 #define USER_CONFIG_FILE "config_"VERSION_STR".json" /* configuration file name */
 #define WINDOW_TITLE "Vonsh" /* window title string */
 #define BOARD_MIN_WIDTH (28) /* minimum board width in tiles */
 #define BOARD_MIN_HEIGHT (28) /* minimum board height in tiles */
 #define TILE_SIZE (16) /* tile side in pixels */
-#define RENDER_INTERVAL (50)   // Interval between frames in milliseconds
-#define GROUND_TILES (8)  // Number of ground tiles in the tileset
-#define WALL_TILES (4)  // Number of wall tiles in the tileset
-#define FOOD_TILES (6)  // Number of food tiles in the tileset
+#define RENDER_INTERVAL (50)   // Fixed step of the game clock in milliseconds, a tick every CHAR_ANIM_FRAMES steps
 #define FOOD_BLINK_FRAMES (27)
 #define CHAR_ANIM_FRAMES (4) // Number of animation frames for the character
-#define TOTAL_CHARS (24) // Number of total characters
 #define MAX_HISCORES (10)
 #define MAX_NAME_LEN (15)
 #define MENU_WIDTH (20*TILE_SIZE) /* menu width in pixels */
@@ -33,6 +43,14 @@
 #define GAME_OVER_BORDER (16) /* game over overlay border in pixels */
 #define GAME_OVER_ITEM_SPACE (12) /* game over overlay item space in pixels */
 #define FPS_COUNT_INTERVAL (1000) /* interval between FPS counter updates in milliseconds */
+#define MAX_CATCH_UP_MS (1000) /* game clock behind by more after a stall skips the rest instead of racing */
+#define DEFAULT_REFRESH_RATE (60) /* frames per second without vsync if the display does not tell */
+#define SLEEP_SPIN_MS (0.3) /* last part of a wait for the next frame spent spinning, sleeping wakes up about this late */
+#define AUTOPILOT_RESTART_FRAMES (40) /* frames the game over screen is shown before autopilot plays again */
+#define ARENA_SPAWN_LENGTH (4) /* segments a snake entering the arena grows to */
+#define REWIND_DEFAULT_SECONDS (30) /* seconds of play kept for rewinding */
+#define REWIND_MAX_SECONDS (600)
+#define INPUT_QUEUE_DEFAULT_DEPTH (3) /* turns queued for the next ticks */
 //REMARK: despite that there are only 3 different animation frames per character per each direction, animation cycle CHAR_ANIM_FRAMES has 4 frames because one of the frames is shown twice in this cycle
 
 
@@ -47,34 +65,11 @@ typedef enum e_GameState {
     HallOfFame
 } GameState;
 
-typedef enum e_FieldType { /* indicates what is inside game board field */
-    Empty,
-    Snake,
-    Food,
-    Wall
-} FieldType;
-
-typedef struct BoardField {
-    FieldType type; /* type of this field */
-    int p; /* paremeter(kind of character in snake body, kind of food, kind of wall ) */
-    int pdx; /* delta x to previous piece of snake. */
-    int pdy; /* delta y to previous piece of snake. */
-} BoardField;
-
 typedef struct {
     SDL_Window *screen;
     SDL_Renderer *renderer;
     SDL_Texture *txt_game_board;
-    SDL_Texture *txt_env_tileset;
-    SDL_Texture *txt_food_tileset;
-    SDL_Texture *txt_food_marker;
-    SDL_Texture *txt_char_tileset;
-    SDL_Texture *txt_font;
-    SDL_Texture *txt_logo;
-    SDL_Texture *txt_trophy;
-    SDL_Rect *ground_tile;
-    SDL_Rect *wall_tile;
-    SDL_Rect *food_tile;
+    SDL_Texture *txt_atlas; /* all sprites, their places are in atlas.h */
 } Graphics;
 
 typedef struct {
@@ -91,31 +86,54 @@ typedef struct {
     int fullscreen_board_h;
     int *current_board_w;
     int *current_board_h;
+    /* configured window board and mode while a replay or snapshot dictates the board, saved instead of
+       the ones in use; config_board_w is 0 otherwise */
+    int config_board_w;
+    int config_board_h;
+    bool config_fullscreen;
     int window_w;
     int window_h;
     bool fullscreen;
-    int dhx, dhy;
-    int hx, hy; //head position
-    int tx, ty; //tail position
-    int score;
+    SimContext sim; /* rules-only state of the current game */
+    uint32_t board_cursor; /* read position of the game board texture in the sim journal */
+    uint32_t ground_seed; /* selects ground tile of each field */
+    int food_x, food_y, food_kind; /* food to be drawn, food_x is -1 if there is none */
     int hi_score;
     bool new_record;
-    int expand_counter;
-    int ck_press;
-    int frame;
-    float animation_progress;
+    SimInputQueue input_queue; /* turns for the next ticks, stamped with SDL_GetTicks() */
+    int input_queue_depth;
+    SimReplay replay; /* recording of the current game, or replay being played back */
+    bool replaying; /* inputs come from replay instead of the keyboard */
+    bool autopilot_on; /* autopilot plays game after game */
+    SimAutopilot autopilot;
+    SimController controller; /* decides inputs instead of the keyboard if decide is set */
+    bool remote_on; /* an external process can control the game */
+    int arena_snakes; /* snakes of the arena mode, 0 - the usual single snake game */
+    SimArena arena;
+    SimRemote remote;
+    int game_over_frame; /* frame the last game ended at */
+    int frame; /* steps of the game clock */
+    float animation_progress; /* phase of the tick at the current step */
+    float render_progress; /* phase shown, moves on smoothly in between steps */
+    float step_alpha; /* part of the current step gone by at the frame being rendered */
     bool music_on;
     bool sfx_on;
-    BoardField *game_board;
     GameState state;
     char player_name[MAX_NAME_LEN + 1];
     int player_name_len;
-    SDL_TimerID game_timer;
     SDL_KeyCode key_left;
     SDL_KeyCode key_right;
     SDL_KeyCode key_up;
     SDL_KeyCode key_down;
     SDL_KeyCode key_pause;
+    SDL_KeyCode key_rewind;
+    SDL_KeyCode key_save;
+    int rewind_seconds; /* cap of rewinding, 0 turns it off */
+    SimRewind rewind; /* last ticks of the game, empty buffer when off */
+    bool rewinding; /* rewind key is held */
+    bool vsync; /* presenting waits for the display refresh */
+    bool sprite_batching; /* sprites of a texture are drawn together */
+    bool draw_sorting; /* draws of a frame are sorted by texture, blend mode and color */
     bool fps_counter_on;
     int fps;
 } Game;
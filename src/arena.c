@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include "types.h"
+#include "arena.h"
+#include "game_logic.h"
+#include "error_handling.h"
+
+static SimInput *inputs; /* of every snake in the current tick */
+
+/* Sets up an arena game on the current board: the player is snake 0, bots the rest */
+bool arena_start(uint64_t seed) {
+    SimArena *a = &g_game.arena;
+    if (a->w != g_game.sim.w || a->h != g_game.sim.h) {
+        sim_arena_free(a);
+        free(inputs);
+        inputs = malloc((size_t)g_game.arena_snakes * sizeof(SimInput));
+        if (inputs == NULL || !sim_arena_init(a, g_game.arena_snakes, g_game.sim.w, g_game.sim.h)) {
+            set_error("Error: Error allocating memory for %d snakes.", g_game.arena_snakes);
+            return false;
+        }
+    }
+    sim_arena_reset(a, seed);
+    for (int s = 0; s < a->n; s++) {
+        sim_arena_spawn(a, s, ARENA_SPAWN_LENGTH);
+    }
+    if (!a->alive[0]) {
+        set_error("Error: No room for the snake on the game board.");
+        return false;
+    }
+    return true;
+}
+
+/* Plays one tick of the arena, bots that died come back right away */
+void arena_update(void) {
+    SimArena *a = &g_game.arena;
+    for (int s = 0; s < a->n; s++) {
+        inputs[s] = a->alive[s] ? sim_arena_bot_input(a, s) : SimInputNone;
+    }
+    if (!g_game.autopilot_on) {
+        inputs[0] = sim_input_queue_take(&g_game.input_queue, a->dhx[0], a->dhy[0], SDL_GetTicks());
+    }
+    sim_arena_step(a, inputs);
+
+    for (int s = 1; s < a->n; s++) {
+        if (!a->alive[s]) sim_arena_spawn(a, s, ARENA_SPAWN_LENGTH);
+    }
+    if (!a->alive[0]) {
+        switch_to_game_over();
+    }
+}
+
+void arena_free(void) {
+    sim_arena_free(&g_game.arena);
+    free(inputs);
+    inputs = NULL;
+}
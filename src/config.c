@@ -26,16 +26,22 @@ static void save_config_to_path(const char *path) {
     if (!f) return;
 
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "window_board_w", g_game.window_board_w);
-    cJSON_AddNumberToObject(root, "window_board_h", g_game.window_board_h);
-    cJSON_AddBoolToObject(root, "fullscreen", g_game.fullscreen);
+    bool borrowed = g_game.config_board_w > 0; /* board of a replay or snapshot is not the player's */
+    cJSON_AddNumberToObject(root, "window_board_w", borrowed ? g_game.config_board_w : g_game.window_board_w);
+    cJSON_AddNumberToObject(root, "window_board_h", borrowed ? g_game.config_board_h : g_game.window_board_h);
+    cJSON_AddBoolToObject(root, "fullscreen", borrowed ? g_game.config_fullscreen : g_game.fullscreen);
     cJSON_AddBoolToObject(root, "music_on", g_game.music_on);
     cJSON_AddBoolToObject(root, "sfx_on", g_game.sfx_on);
+    cJSON_AddBoolToObject(root, "vsync", g_game.vsync);
     cJSON_AddStringToObject(root, "key_left", SDL_GetKeyName(g_game.key_left));
     cJSON_AddStringToObject(root, "key_right", SDL_GetKeyName(g_game.key_right));
     cJSON_AddStringToObject(root, "key_up", SDL_GetKeyName(g_game.key_up));
     cJSON_AddStringToObject(root, "key_down", SDL_GetKeyName(g_game.key_down));
     cJSON_AddStringToObject(root, "key_pause", SDL_GetKeyName(g_game.key_pause));
+    cJSON_AddStringToObject(root, "key_rewind", SDL_GetKeyName(g_game.key_rewind));
+    cJSON_AddStringToObject(root, "key_save", SDL_GetKeyName(g_game.key_save));
+    cJSON_AddNumberToObject(root, "rewind_seconds", g_game.rewind_seconds);
+    cJSON_AddNumberToObject(root, "input_queue_depth", g_game.input_queue_depth);
 
     char *json_str = cJSON_Print(root);
     fprintf(f, "%s\n", json_str);
@@ -95,8 +101,30 @@ static void load_config_from_path(const char *path) {
         g_game.sfx_on = cJSON_IsTrue(sfx_on);
     }
 
-    const char* keys[] = {"key_left", "key_right", "key_up", "key_down", "key_pause"};
-    SDL_KeyCode* key_vars[] = {&g_game.key_left, &g_game.key_right, &g_game.key_up, &g_game.key_down, &g_game.key_pause};
+    cJSON *vsync = cJSON_GetObjectItem(root, "vsync");
+    g_game.vsync = cJSON_IsBool(vsync) ? cJSON_IsTrue(vsync) : true; /* configs of older versions have none */
+
+    cJSON *rewind_seconds = cJSON_GetObjectItem(root, "rewind_seconds");
+    if (cJSON_IsNumber(rewind_seconds) && rewind_seconds->valueint >= 0) {
+        g_game.rewind_seconds = rewind_seconds->valueint < REWIND_MAX_SECONDS ? rewind_seconds->valueint : REWIND_MAX_SECONDS;
+    }
+    else {
+        g_game.rewind_seconds = REWIND_DEFAULT_SECONDS;
+    }
+
+    cJSON *input_queue_depth = cJSON_GetObjectItem(root, "input_queue_depth");
+    if (cJSON_IsNumber(input_queue_depth) && input_queue_depth->valueint >= 1) {
+        g_game.input_queue_depth = input_queue_depth->valueint < SIM_INPUT_QUEUE_MAX ? input_queue_depth->valueint : SIM_INPUT_QUEUE_MAX;
+    }
+    else {
+        g_game.input_queue_depth = INPUT_QUEUE_DEFAULT_DEPTH;
+    }
+
+    /* configs of older versions have no rewind and save keys */
+    g_game.key_rewind = SDLK_BACKSPACE;
+    g_game.key_save = SDLK_F5;
+    const char* keys[] = {"key_left", "key_right", "key_up", "key_down", "key_pause", "key_rewind", "key_save"};
+    SDL_KeyCode* key_vars[] = {&g_game.key_left, &g_game.key_right, &g_game.key_up, &g_game.key_down, &g_game.key_pause, &g_game.key_rewind, &g_game.key_save};
 
     for (int i = 0; i < (int)(sizeof(keys)/sizeof(keys[0])); i++) {
         cJSON *key_item = cJSON_GetObjectItem(root, keys[i]);
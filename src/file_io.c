@@ -2,6 +2,11 @@
 #include "types.h"
 #include "error_handling.h"
 #include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 /*
     Load image from file and create texture using it
@@ -18,3 +23,29 @@ void load_texture(SDL_Texture **txt, const char *filepath) {
     }
     SDL_FreeSurface(srf);
 }
+
+/* Creates directory and all its missing parents (like mkdir -p) */
+void ensure_dir_exists(const char *dir_path) {
+    char *p = strdup(dir_path);
+    if (!p) return;
+
+    char *slash = p;
+    if (p[0] == '/') slash++;
+
+    while((slash = strchr(slash, '/'))) {
+        *slash = '\0';
+        if (mkdir(p, 0755) != 0 && errno != EEXIST) {
+            perror("mkdir");
+            free(p);
+            return;
+        }
+        *slash = '/';
+        slash++;
+    }
+
+    if (mkdir(p, 0755) != 0 && errno != EEXIST) {
+        perror("mkdir");
+    }
+
+    free(p);
+}
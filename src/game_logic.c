@@ -4,55 +4,112 @@
 #include "error_handling.h"
 #include "pcg_basic.h"
 #include "hiscores.h"
-// Helper function to get a pointer to a board field based on its coordinates
-static inline BoardField* get_board_field(int x, int y) {
-    return &g_game.game_board[(*g_game.current_board_w) * y + x];
+#include "replays.h"
+#include "arena.h"
+#include "snapshots.h"
+#include "sprite_batch.h"
+
+/*
+ * Ground tile of a field - random pattern derived from ground_seed, so that
+ * any single field can be redrawn later
+ */
+static const SDL_Rect* ground_tile_at(int x, int y) {
+    uint32_t h = g_game.ground_seed ^ ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u);
+    h ^= h >> 16; h *= 0x7feb352du;
+    h ^= h >> 15; h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return &atlas_ground[h % ATLAS_GROUND_COUNT];
 }
 
 /*
- * Fills game board with initial content(grass) and pre-renders it to a texture
+ * Renders static content of one field (ground or wall), render target has to
+ * be set and the sprite batch flushed before it is changed again
  */
-static void init_game_board_content(void) {
-    /* Reset the game board array */
-    for (int y = 0; y < *g_game.current_board_h; y++) {
-        for (int x = 0; x < *g_game.current_board_w; x++) {
-            BoardField* field = get_board_field(x, y);
-            field->type = Empty;
-            field->pdx = 0;
-            field->pdy = 0;
-        }
+static void render_board_field(int x, int y, BoardField field) {
+    SDL_Rect DstR = { x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE };
+    if (field_type(field) == Wall) {
+        sprite_batch_copy(g_gfx.txt_atlas, &atlas_wall[field_kind(field)], &DstR);
+    }
+    else {
+        sprite_batch_copy(g_gfx.txt_atlas, ground_tile_at(x, y), &DstR);
     }
+}
 
+/*
+ * Pre-renders ground tiles and walls of the whole board to the game board texture
+ * and picks up the food
+ */
+static void init_game_board_content(void) {
     /* Redirect rendering to the game board texture */
+    sprite_batch_flush();
     SDL_SetRenderTarget(g_gfx.renderer, g_gfx.txt_game_board);
     /* Fill render target with black. Later status bar at the bottom of the screen
        will have that color. */
     SDL_SetRenderDrawColor(g_gfx.renderer, 0, 0, 0, 255);
     SDL_RenderClear(g_gfx.renderer);
 
-    /* Fill background with random pattern of ground tiles */
     int x, y;
-    SDL_Rect DstR = { 0, 0, TILE_SIZE, TILE_SIZE };
-    for (y=0; y<*g_game.current_board_h; y++)
-        for (x=0; x<*g_game.current_board_w; x++) {
-            DstR.x = x*TILE_SIZE; DstR.y = y*TILE_SIZE;
-            SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_env_tileset, &g_gfx.ground_tile[pcg32_boundedrand(8)], &DstR);
+    g_game.food_x = -1;
+    for (y=0; y<g_game.sim.h; y++)
+        for (x=0; x<g_game.sim.w; x++) {
+            BoardField field = sim_field(&g_game.sim, x, y);
+            render_board_field(x, y, field);
+            if (field_type(field) == Food) {
+                g_game.food_x = x;
+                g_game.food_y = y;
+                g_game.food_kind = field_kind(field);
+            }
         }
 
     /* Detach the game board texture from renderer */
+    sprite_batch_flush();
     SDL_SetRenderTarget(g_gfx.renderer, NULL);
 }
 
+/*
+ * Brings the game board texture and food up to date with the simulation,
+ * following the board journal. Only fields that changed are redrawn.
+ */
+void sync_game_board(void) {
+    SimChange change;
+    SimJournalStatus status;
+    bool target_set = false;
+    while ((status = sim_journal_next(&g_game.sim, &g_game.board_cursor, &change)) != SimJournalEnd) {
+        if (status == SimJournalResync) {
+            init_game_board_content();
+            target_set = false;
+            continue;
+        }
+        FieldType old_type = field_type(change.old), new_type = field_type(change.value);
+        if (new_type == Food) {
+            g_game.food_x = change.x;
+            g_game.food_y = change.y;
+            g_game.food_kind = field_kind(change.value);
+        }
+        else if (old_type == Food && change.x == g_game.food_x && change.y == g_game.food_y) {
+            g_game.food_x = -1;
+        }
+        if (old_type == Wall || new_type == Wall) {
+            if (!target_set) {
+                SDL_SetRenderTarget(g_gfx.renderer, g_gfx.txt_game_board);
+                target_set = true;
+            }
+            render_board_field(change.x, change.y, change.value);
+        }
+    }
+    if (target_set) {
+        sprite_batch_flush();
+        SDL_SetRenderTarget(g_gfx.renderer, NULL);
+    }
+}
+
 // (Re)initialize board-dependent resources
 void reinit_game_board_resources() {
     if (g_gfx.txt_game_board != NULL) {
         SDL_DestroyTexture(g_gfx.txt_game_board);
         g_gfx.txt_game_board = NULL;
     }
-    if (g_game.game_board != NULL) {
-        free(g_game.game_board);
-        g_game.game_board = NULL;
-    }
+    sim_free(&g_game.sim);
 
     g_gfx.txt_game_board = SDL_CreateTexture(g_gfx.renderer, SDL_PIXELFORMAT_RGBA8888,
                                      SDL_TEXTUREACCESS_TARGET, g_game.window_w, g_game.window_h);
@@ -61,15 +118,24 @@ void reinit_game_board_resources() {
         return;
     }
 
-    g_game.game_board = calloc((*g_game.current_board_w) * (*g_game.current_board_h), sizeof(BoardField));
-    if (g_game.game_board == NULL) {
+    if (!sim_init(&g_game.sim, *g_game.current_board_w, *g_game.current_board_h)) {
         SDL_DestroyTexture(g_gfx.txt_game_board);
         g_gfx.txt_game_board = NULL;
         set_error("Error: Error allocating memory for game board.");
         return;
     }
 
-    init_game_board_content();
+    g_game.board_cursor = 0;
+    sync_game_board();
+
+    if (g_game.autopilot_on) {
+        sim_autopilot_free(&g_game.autopilot);
+        if (!sim_autopilot_init(&g_game.autopilot, g_game.sim.w, g_game.sim.h)) {
+            set_error("Error: Error allocating memory for autopilot.");
+            return;
+        }
+        g_game.controller = sim_autopilot_controller(&g_game.autopilot);
+    }
 }
 
 /* Creates display area in windowed mode based on current game board dimensions */
@@ -99,35 +165,14 @@ void create_fullscreen_display(void) {
     g_game.current_board_h = &g_game.fullscreen_board_h;
 }
 
-/* Adds obstacle or food at random location in game board. */
-static bool seed_item(FieldType item_type, int *out_x, int *out_y)
-{
-    int x = 0, y = 0;
-    int attempts = 0;
-    BoardField *field = NULL;
-    while(attempts < (*g_game.current_board_w) * (*g_game.current_board_h)) {
-        x = pcg32_boundedrand(*g_game.current_board_w);
-        y = pcg32_boundedrand(*g_game.current_board_h);
-        field = get_board_field(x, y);
-        if (field->type == Empty) {
-            field->type = item_type;
-            if (item_type == Food) {
-                field->p = pcg32_boundedrand(6);
-            }
-            if (out_x) *out_x = x;
-            if (out_y) *out_y = y;
-            return true;
-        }
-        attempts++;
-    }
-    return false;
-}
-
 /* Set game state to GameOver and show cursor */
 void switch_to_game_over(void) {
-    if (hiscores_is_highscore(g_game.score)) {
+    if (g_game.replaying || g_game.controller.decide != NULL || g_game.remote_on || g_game.arena_snakes > 0) {
+        g_game.state = GameOver;
+        g_game.new_record = false;
+    } else if (hiscores_is_highscore(g_game.sim.score)) {
         g_game.state = EnteringHiscoreName;
-        g_game.new_record = g_game.score > hiscores_get_scores()[0].score;
+        g_game.new_record = g_game.sim.score > hiscores_get_scores()[0].score;
         g_game.player_name[0] = '\0';
         g_game.player_name_len = 0;
         SDL_StartTextInput();
@@ -136,6 +181,17 @@ void switch_to_game_over(void) {
         g_game.new_record = false;
     }
     g_game.animation_progress = 1.0f;
+    g_game.game_over_frame = g_game.frame;
+
+    /* autopilot plays game after game unattended, so only games of a player are kept */
+    if (!g_game.replaying && g_game.controller.decide == NULL && g_game.arena_snakes == 0) {
+        if (sim_replay_finish(&g_game.replay, g_game.sim.tick, g_game.sim.score)) {
+            replays_save(&g_game.replay);
+        } else {
+            set_error("Error: Error allocating memory for replay.");
+            return;
+        }
+    }
 
     if (g_game.sfx_on) {
         audio_play_die_sound();
@@ -144,108 +200,92 @@ void switch_to_game_over(void) {
     SDL_ShowCursor(SDL_ENABLE);
 }
 
-void update_play_state(void)
+/* Plays one tick with input (unless a controller or replay decides), without redrawing the board */
+void advance_play_state(SimInput input)
 {
-    BoardField* prev_field = NULL, *next_field = NULL;
-    int next_hx = g_game.hx + g_game.dhx;
-    int next_hy = g_game.hy + g_game.dhy;
-    int px = g_game.hx, py = g_game.hy;
-    int nx = next_hx, ny = next_hy;
-
-    if (next_hx < 0 || next_hy < 0 ||
-        next_hx >= *g_game.current_board_w || next_hy >= *g_game.current_board_h) {
-        switch_to_game_over();
+    SimEvents events;
+    if (g_game.controller.decide != NULL && !g_game.replaying) {
+        input = sim_controller_decide(&g_game.controller, &g_game.sim);
     }
-    else {
-        prev_field = get_board_field(px, py);
-        next_field = get_board_field(nx, ny);
-        if (next_field->type == Food) {
-            g_game.score++;
-            if (g_game.score > g_game.hi_score) {
-                g_game.hi_score = g_game.score;
-            }
-            g_game.expand_counter += g_game.score;
-            seed_item(Food, NULL, NULL);
-            if (get_first_error()) return;
-        }
-        else if (next_field->type != Empty) {
-            switch_to_game_over();
-        }
+    if (g_game.replaying) {
+        input = sim_replay_input(&g_game.replay, g_game.sim.tick);
+    } else if (!sim_replay_record(&g_game.replay, g_game.sim.tick, input)) {
+        set_error("Error: Error allocating memory for replay.");
+        return;
     }
-
-    if (g_game.state != Playing) return;
-
-    //obtain tail position
-    next_field->type = Snake;
-    //set the vector from new head position to (possibly) the next head position
-    next_field->pdx = -g_game.dhx;
-    next_field->pdy = -g_game.dhy;
-
-    px = nx; py=ny;
-    //traverse the snake from head(next_field) to tail(prev_field)
-    while(px!=g_game.tx || py!=g_game.ty) {
-        nx = px;
-        ny = py;
-        px = px + next_field->pdx;
-        py = py + next_field->pdy;
-        prev_field = get_board_field(px, py);
-        next_field->p = prev_field->p;
-        next_field = prev_field;
-    };
-
-    if (g_game.expand_counter==0) {
-        //if not expanding, reset the tail field content...
-        next_field->type = Empty;
-        next_field->p = 0;
-        next_field->pdx = 0;
-        next_field->pdy = 0;
-        //...and set tail coordinates to new position
-        g_game.tx = nx;
-        g_game.ty = ny;
+    if (g_game.rewind.buf != NULL && !g_game.replaying) {
+        sim_rewind_step(&g_game.rewind, &g_game.sim, input, &events);
+    } else {
+        sim_step(&g_game.sim, input, &events);
     }
-    else {
-        //if expanding, set the tail field content to a random character and seed a wall
-        next_field->p = pcg32_boundedrand(TOTAL_CHARS);
-        int wall_x, wall_y;
-        if (seed_item(Wall, &wall_x, &wall_y)) {
-            SDL_Rect DstR = { wall_x * TILE_SIZE, wall_y * TILE_SIZE, TILE_SIZE, TILE_SIZE };
-            SDL_SetRenderTarget(g_gfx.renderer, g_gfx.txt_game_board);
-            SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_env_tileset, &g_gfx.wall_tile[pcg32_boundedrand(4)], &DstR);
-            SDL_SetRenderTarget(g_gfx.renderer, NULL);
+
+    /* Apply side effects of the simulation tick */
+    for (int i = 0; i < events.count; i++) {
+        SimEvent *ev = &events.items[i];
+        switch (ev->type) {
+            case SimEventFoodEaten:
+                if (g_game.sim.score > g_game.hi_score) {
+                    g_game.hi_score = g_game.sim.score;
+                }
+                break;
+            case SimEventExpand:
+                if (g_game.sfx_on) {
+                    audio_play_exp_sound();
+                }
+                break;
+            case SimEventDied:
+                switch_to_game_over();
+                break;
+            default:
+                break;
         }
         if (get_first_error()) return;
-        g_game.expand_counter--;
-        if (g_game.sfx_on) {
-            audio_play_exp_sound();
-            if (get_first_error()) return;
-        }
     }
+    /* replay of a game that did not end with a crash */
+    if (g_game.replaying && g_game.state == Playing && g_game.sim.tick >= g_game.replay.ticks) {
+        switch_to_game_over();
+    }
+}
 
-    //calculate new head position
-    g_game.hx = next_hx;
-    g_game.hy = next_hy;
+void update_play_state(void)
+{
+    if (g_game.arena_snakes > 0) {
+        arena_update();
+        return;
+    }
+    SimInput input = sim_input_queue_take(&g_game.input_queue, g_game.sim.dhx, g_game.sim.dhy, SDL_GetTicks());
+    if (g_game.remote_on && input == SimInputNone) {
+        input = sim_remote_take_input(&g_game.remote);
+    }
+    advance_play_state(input);
+    sync_game_board();
+}
 
-    g_game.ck_press = 0;
+/* Takes one tick back while the rewind key is held, play goes on from there when it is released */
+void rewind_play_state(void)
+{
+    if (!sim_rewind_back(&g_game.rewind, &g_game.sim)) return;
+    sim_replay_truncate(&g_game.replay, g_game.sim.tick);
+    sim_input_queue_clear(&g_game.input_queue);
+    sync_game_board();
 }
 
-void start_play(void) {
-    init_game_board_content();
-    if (get_first_error()) return;
+/* Empties the ring of ticks for rewinding, allocating it on first use */
+static void reset_rewind(void) {
+    uint32_t ticks = (uint32_t)g_game.rewind_seconds * 1000 / (RENDER_INTERVAL * CHAR_ANIM_FRAMES);
+    g_game.rewinding = false;
+    if (g_game.rewind.buf == NULL && ticks > 0 &&
+        !sim_rewind_init(&g_game.rewind, (size_t)ticks * (SIM_REWIND_MAX_RECORD + 2), ticks)) {
+        set_error("Error: Error allocating memory for rewinding.");
+        return;
+    }
+    sim_rewind_clear(&g_game.rewind);
+}
 
-    g_game.dhx = 0;   g_game.dhy = -1;
-    g_game.score = g_game.expand_counter = 0;
+/* Switches to playing the game that was just set up */
+static void enter_play(void) {
     g_game.hi_score = hiscores_get_scores()[0].score;
-    g_game.hx = g_game.tx = (*g_game.current_board_w)/2;
-    g_game.hy = g_game.ty = (*g_game.current_board_h)/2;
-
-    BoardField* field = get_board_field(g_game.hx, g_game.hy);
-    field->type = Snake;
-    field->p = pcg32_boundedrand(TOTAL_CHARS);
-    field->pdx = -g_game.dhx;
-    field->pdy = -g_game.dhy;
-    seed_item(Food, NULL, NULL);
-    if (get_first_error()) return;
-    g_game.ck_press = 0;
+    sim_input_queue_clear(&g_game.input_queue);
     g_game.frame = 0;
     g_game.animation_progress = 0.0f;
     g_game.new_record = false;
@@ -254,6 +294,70 @@ void start_play(void) {
     audio_play_gameplay_music();
 }
 
+/* Starts game from seed, everything else is set up already */
+static void begin_play(uint64_t seed) {
+    if (!sim_reset(&g_game.sim, seed)) {
+        set_error("Error: No room for food on the game board.");
+        return;
+    }
+    sync_game_board();
+    if (get_first_error()) return;
+    enter_play();
+}
+
+/* Starts a new game from seed on the current board */
+void start_play_seed(uint64_t seed) {
+    g_game.ground_seed = pcg32_random();
+    g_game.replaying = false;
+    if (g_game.arena_snakes > 0) {
+        /* game board itself stays empty, only the ground is drawn from it */
+        init_game_board_content();
+        if (arena_start(seed)) enter_play();
+        return;
+    }
+    sim_replay_start(&g_game.replay, g_game.sim.w, g_game.sim.h, seed, g_game.ground_seed);
+    reset_rewind();
+    if (get_first_error()) return;
+    begin_play(seed);
+}
+
+/* Continues the game restored into g_game.sim and g_game.replay, paused until the player resumes it */
+void start_restored_play(uint32_t frame) {
+    g_game.ground_seed = g_game.replay.ground_seed;
+    g_game.replaying = false;
+    reset_rewind();
+    if (get_first_error()) return;
+    g_game.board_cursor = 0;
+    sync_game_board();
+    if (get_first_error()) return;
+    enter_play();
+    if (g_game.sim.score > g_game.hi_score) {
+        g_game.hi_score = g_game.sim.score;
+    }
+    /* animation goes on from the same phase */
+    g_game.frame = frame % CHAR_ANIM_FRAMES;
+    g_game.animation_progress = g_game.frame / (double)CHAR_ANIM_FRAMES;
+    audio_pause_music();
+    g_game.state = Paused;
+}
+
+void start_play(void) {
+    /* every game gets its own seed, the rest of the game is derived from it */
+    start_play_seed(((uint64_t)pcg32_random() << 32) | pcg32_random());
+}
+
+/* Plays back g_game.replay at normal speed, board has to be of the replay's size */
+void start_replay(void) {
+    if (g_game.sim.w != g_game.replay.w || g_game.sim.h != g_game.replay.h) {
+        set_error("Error: Replay was recorded on a %dx%d board.", g_game.replay.w, g_game.replay.h);
+        return;
+    }
+    g_game.ground_seed = g_game.replay.ground_seed;
+    g_game.replaying = true;
+    sim_replay_rewind(&g_game.replay);
+    begin_play(g_game.replay.seed);
+}
+
 void pause_play() {
     if (g_game.animation_progress == 0.0f) {
         update_play_state();
@@ -281,11 +385,24 @@ void handle_playing_events(SDL_Event *event) {
                 pause_play();
             }
         }
-        else if (g_game.ck_press == 0) {
-            if (sym == g_game.key_left) { if (g_game.dhx == 0) { g_game.dhx = -1; g_game.dhy = 0; g_game.ck_press = 1; } }
-            else if (sym == g_game.key_right) { if (g_game.dhx == 0) { g_game.dhx = 1; g_game.dhy = 0; g_game.ck_press = 1; } }
-            else if (sym == g_game.key_up) { if (g_game.dhy == 0) { g_game.dhx = 0; g_game.dhy = -1; g_game.ck_press = 1; } }
-            else if (sym == g_game.key_down) { if (g_game.dhy == 0) { g_game.dhx = 0; g_game.dhy = 1; g_game.ck_press = 1; } }
+        else if (sym == g_game.key_save) {
+            if (event->key.repeat == 0) {
+                snapshots_save();
+            }
+        }
+        else if (sym == g_game.key_rewind) {
+            g_game.rewinding = g_game.rewind.buf != NULL && !g_game.replaying && g_game.arena_snakes == 0;
+        }
+        else if (!g_game.replaying && g_game.controller.decide == NULL) {
+            SimInput input = SimInputNone;
+            if (sym == g_game.key_left) { input = SimInputLeft; }
+            else if (sym == g_game.key_right) { input = SimInputRight; }
+            else if (sym == g_game.key_up) { input = SimInputUp; }
+            else if (sym == g_game.key_down) { input = SimInputDown; }
+            /* the player's snake is snake 0 in the arena */
+            int dhx = g_game.arena_snakes > 0 ? g_game.arena.dhx[0] : g_game.sim.dhx;
+            int dhy = g_game.arena_snakes > 0 ? g_game.arena.dhy[0] : g_game.sim.dhy;
+            sim_input_queue_push(&g_game.input_queue, input, dhx, dhy, event->key.timestamp);
         }
     }
 }
@@ -297,5 +414,10 @@ void handle_paused_events(SDL_Event *event) {
                 resume_play();
             }
         }
+        else if ((SDL_KeyCode)event->key.keysym.sym == g_game.key_save) {
+            if (event->key.repeat == 0) {
+                snapshots_save();
+            }
+        }
     }
 }
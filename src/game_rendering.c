@@ -1,88 +1,150 @@
+#include <math.h>
 #include "types.h"
 #include "error_handling.h"
 #include "game_rendering.h"
 #include "text_renderer.h"
 #include "menu_rendering.h"
+#include "render_queue.h"
 
-// Helper function to get a pointer to a board field based on its coordinates
-static inline BoardField* get_board_field(int x, int y) {
-    return &g_game.game_board[(*g_game.current_board_w) * y + x];
-}
-
-void render_game_view(void) {
-    int x, y;
-    char txt_buf[40];
-
-    SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_game_board, NULL, NULL);
-
-    SDL_Rect DstR = { 0, 0, TILE_SIZE, TILE_SIZE };
-    SDL_Rect SrcR = { 0, 0, TILE_SIZE, TILE_SIZE };
+/*
+ * Draws character ch on its way to field (x,y), coming from the direction
+ * (pdx,pdy) of the previous piece of snake
+ */
+static void render_character(int x, int y, int pdx, int pdy, int ch) {
     static const int dir_to_col[3][3] = {
         {-1, 3, -1},
         {2, -1, 0},
         {-1, 1, -1},
     };
+    SDL_Rect DstR = { 0, 0, TILE_SIZE, TILE_SIZE };
+    SDL_Rect SrcR = { 0, 0, TILE_SIZE, TILE_SIZE };
+    int anim_frame = (int)(g_game.render_progress * CHAR_ANIM_FRAMES);
+    SrcR.x = atlas_chars.x + dir_to_col[-pdx+1][-pdy+1] * TILE_SIZE;
+    SrcR.y = atlas_chars.y + ch*(CHAR_ANIM_FRAMES-1)*(TILE_SIZE+1) + 1;
+    if (anim_frame == 1) {
+        SrcR.y += (TILE_SIZE+1);
+    }
+    else if (anim_frame == 3) {
+        SrcR.y += 2*(TILE_SIZE+1);
+    }
+    DstR.x = x*TILE_SIZE;
+    DstR.y = y*TILE_SIZE;
+    DstR.x += (1.0-g_game.render_progress) * pdx * TILE_SIZE;
+    DstR.y += (1.0-g_game.render_progress) * pdy * TILE_SIZE;
+    render_queue_copy(g_gfx.txt_atlas, &SrcR, &DstR);
+}
 
-    for (y=0; y<(*g_game.current_board_h); y++) {
-        for (x=0; x<(*g_game.current_board_w); x++) {
-            BoardField* field = get_board_field(x, y);
-            switch(field->type) {
-                case Empty:
-                case Wall:
-                    break;
-                case Snake:
-                    SrcR.x = dir_to_col[-field->pdx+1][-field->pdy+1] * TILE_SIZE;
-                    SrcR.y = field->p*(CHAR_ANIM_FRAMES-1)*(TILE_SIZE+1) + 1;
-                    int anim_frame = (int)(g_game.animation_progress * CHAR_ANIM_FRAMES);
-                    if (anim_frame == 1) {
-                        SrcR.y += (TILE_SIZE+1);
-                    }
-                    else if (anim_frame == 3) {
-                        SrcR.y += 2*(TILE_SIZE+1);
-                    }
-                    DstR.x = x*TILE_SIZE;
-                    DstR.y = y*TILE_SIZE;
-                    DstR.x += (1.0-g_game.animation_progress) * field->pdx * TILE_SIZE;
-                    DstR.y += (1.0-g_game.animation_progress) * field->pdy * TILE_SIZE;
-                    SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_char_tileset, &SrcR, &DstR);
-                    break;
-                case Food:
-                    DstR.x = x*TILE_SIZE;
-                    DstR.y = y*TILE_SIZE;
-                    if (g_game.state == Playing && g_game.frame % (FOOD_BLINK_FRAMES*3) < FOOD_BLINK_FRAMES) {
-                        if ((g_game.frame/3) % 3 == 0) {
-                            SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_food_marker, NULL, &DstR);
-                        }
-                        else if ((g_game.frame/3) % 3 == 1) {
-                            SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_food_tileset, &g_gfx.food_tile[field->p], &DstR);
-                        }
-                    }
-                    else {
-                        SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_food_tileset, &g_gfx.food_tile[field->p], &DstR);
-                    }
-                    break;
-                default:
-                    break;
+/*
+ * Draws all snakes of the arena by following the links of their fields from
+ * tail to head, and its food straight from the list of food fields
+ */
+static void render_arena(void) {
+    const SimArena *a = &g_game.arena;
+    for (int s = 0; s < a->n; s++) {
+        if (!a->alive[s]) continue;
+        int x = a->tx[s], y = a->ty[s];
+        int link = a->link[a->w * y + x];
+        /* the field the tail left is gone, assume it came straight */
+        int px = a->length[s] > 1 ? x - sim_arena_link_dx(link) : x - a->dhx[s];
+        int py = a->length[s] > 1 ? y - sim_arena_link_dy(link) : y - a->dhy[s];
+        for (int k = a->length[s] - 1; k >= 0; k--) {
+            link = a->link[a->w * y + x];
+            render_character(x, y, px - x, py - y, (s * 7 + k) % TOTAL_CHARS);
+            px = x;
+            py = y;
+            x += sim_arena_link_dx(link);
+            y += sim_arena_link_dy(link);
+        }
+    }
+    SDL_Rect DstR = { 0, 0, TILE_SIZE, TILE_SIZE };
+    for (int i = 0; i < a->food_count; i++) {
+        int c = a->food_cells[i];
+        DstR.x = (c % a->w)*TILE_SIZE;
+        DstR.y = (c / a->w)*TILE_SIZE;
+        render_queue_copy(g_gfx.txt_atlas, &atlas_food[c % FOOD_KINDS], &DstR);
+    }
+}
+
+/*
+ * Draws the snake straight from the body ring, tail first, and the food. Each
+ * piece comes from the piece drawn before it, only the tail's direction is
+ * read from the board.
+ */
+static void render_single_game(void) {
+    SDL_Rect DstR = { 0, 0, TILE_SIZE, TILE_SIZE };
+    const SimSegment *tail = sim_segment(&g_game.sim, g_game.sim.length - 1);
+    BoardField tail_field = sim_field(&g_game.sim, tail->x, tail->y);
+    int px = tail->x + field_pdx(tail_field), py = tail->y + field_pdy(tail_field);
+    for (int i = g_game.sim.length - 1; i >= 0; i--) {
+        const SimSegment *segment = sim_segment(&g_game.sim, i);
+        render_character(segment->x, segment->y, px - segment->x, py - segment->y, g_game.sim.chars[i]);
+        px = segment->x;
+        py = segment->y;
+    }
+
+    /* Food position is kept up to date from the board journal, no need to scan */
+    if (g_game.food_x >= 0) {
+        DstR.x = g_game.food_x*TILE_SIZE;
+        DstR.y = g_game.food_y*TILE_SIZE;
+        /* blinks on the clock time in between steps too, as the snake moves:
+           each flash is 3 steps of fading marker, 3 of food and 3 of nothing */
+        float time = g_game.frame + g_game.step_alpha;
+        float flash = fmodf(time / 3.0f, 3.0f);
+        if (g_game.state == Playing && fmodf(time, FOOD_BLINK_FRAMES*3) < FOOD_BLINK_FRAMES) {
+            if (flash < 1.0f) {
+                /* the marker lights up what is under it */
+                Uint8 light = (Uint8)(255.0f * (1.0f - flash));
+                render_queue_copy_blend(g_gfx.txt_atlas, &atlas_food_marker, &DstR, SDL_BLENDMODE_ADD,
+                                        (SDL_Color){ light, light, light, 255 });
+            }
+            else if (flash < 2.0f) {
+                render_queue_copy(g_gfx.txt_atlas, &atlas_food[g_game.food_kind], &DstR);
             }
         }
+        else {
+            render_queue_copy(g_gfx.txt_atlas, &atlas_food[g_game.food_kind], &DstR);
+        }
+    }
+}
+
+void render_game_view(void) {
+    char txt_buf[40];
+    SDL_Rect board_dst = { 0, 0, g_game.window_w, g_game.window_h };
+
+    render_queue_layer(RenderLayerBoard);
+    render_queue_copy(g_gfx.txt_game_board, NULL, &board_dst);
+    render_queue_layer(RenderLayerSprites);
+    if (g_game.arena_snakes > 0) {
+        render_arena();
+    }
+    else {
+        render_single_game();
     }
 
-    SDL_SetRenderDrawBlendMode(g_gfx.renderer, SDL_BLENDMODE_BLEND);
+    render_queue_layer(RenderLayerHud);
     switch (g_game.state) {
         case EnteringHiscoreName:
         case GameOver:
             render_game_over_overlay();
+            render_queue_layer(RenderLayerHud);
             break;
         case Paused:
-            render_text(g_gfx.renderer, g_gfx.txt_font, "PAUSED", g_game.window_w/2, g_game.window_h/2, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_WHITE);
+            render_text("PAUSED", g_game.window_w/2, g_game.window_h/2, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_WHITE);
             break;
         default:
             break;
     }
 
-    sprintf(txt_buf, "HIGH SCORE: %d", g_game.hi_score);
-    render_text(g_gfx.renderer, g_gfx.txt_font, txt_buf, TILE_SIZE, (*g_game.current_board_h)*TILE_SIZE, ALIGN_LEFT, ALIGN_TOP, TEXT_WHITE);
+    if (g_game.arena_snakes > 0) {
+        int alive = 0;
+        for (int s = 0; s < g_game.arena.n; s++) alive += g_game.arena.alive[s];
+        sprintf(txt_buf, "SNAKES: %d", alive);
+    }
+    else {
+        sprintf(txt_buf, "HIGH SCORE: %d", g_game.hi_score);
+    }
+    render_text(txt_buf, TILE_SIZE, (*g_game.current_board_h)*TILE_SIZE, ALIGN_LEFT, ALIGN_TOP, TEXT_WHITE);
     if (get_first_error()) return;
-    sprintf(txt_buf, "SCORE: %d", g_game.score);
-    render_text(g_gfx.renderer, g_gfx.txt_font, txt_buf, g_game.window_w-TILE_SIZE, (*g_game.current_board_h)*TILE_SIZE, ALIGN_RIGHT, ALIGN_TOP, TEXT_WHITE);
+    sprintf(txt_buf, "SCORE: %d", g_game.arena_snakes > 0 ? g_game.arena.score[0] : g_game.sim.score);
+    render_text(txt_buf, g_game.window_w-TILE_SIZE, (*g_game.current_board_h)*TILE_SIZE, ALIGN_RIGHT, ALIGN_TOP, TEXT_WHITE);
 }
@@ -1,13 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <errno.h>
 #include <cjson/cJSON.h>
 #include <wordexp.h>
 #include <time.h>
 #include "types.h"
 #include "hiscores.h"
+#include "file_io.h"
 
 static Hiscore hiscores[MAX_HISCORES];
 static char hiscore_path[256];
@@ -25,32 +24,6 @@ static void get_hiscore_path(void) {
     }
 }
 
-
-static void ensure_dir_exists(const char *dir_path) {
-    char *p = strdup(dir_path);
-    if (!p) return;
-
-    char *slash = p;
-    if (p[0] == '/') slash++;
-
-    while((slash = strchr(slash, '/'))) {
-        *slash = '\0';
-        if (mkdir(p, 0755) != 0 && errno != EEXIST) {
-            perror("mkdir");
-            free(p);
-            return;
-        }
-        *slash = '/';
-        slash++;
-    }
-
-    if (mkdir(p, 0755) != 0 && errno != EEXIST) {
-        perror("mkdir");
-    }
-
-    free(p);
-}
-
 static void set_default_scores(void) {
     struct tm tm_date = {0};
     tm_date.tm_year = 2000 - 1900;
@@ -9,6 +9,7 @@
 #include "config.h"
 #include "hiscores.h"
 #include "game_logic.h" // For start_play()
+#include "snapshots.h"
 
 // Menu operational variables
 static Menu *current_menu = NULL;
@@ -42,6 +43,7 @@ MenuItem options_menu_items[] = {
     { .type = MenuItemType_KeyConfig, .label = "Right:", .active = true, .action = menu_action_start_key_entry, .data.key_config_info = { .key_code = &g_game.key_right } },
     { .type = MenuItemType_KeyConfig, .label = "Up:", .active = true, .action = menu_action_start_key_entry, .data.key_config_info = { .key_code = &g_game.key_up } },
     { .type = MenuItemType_KeyConfig, .label = "Down:", .active = true, .action = menu_action_start_key_entry, .data.key_config_info = { .key_code = &g_game.key_down } },
+    { .type = MenuItemType_KeyConfig, .label = "Rewind:", .active = true, .action = menu_action_start_key_entry, .data.key_config_info = { .key_code = &g_game.key_rewind } },
     { .type = MenuItemType_IntConfig, .label = "Board Width:", .active = true, .action = menu_action_start_int_entry, .data.int_config_info = { .value = &g_game.current_board_w, .min_value = BOARD_MIN_WIDTH } },
     { .type = MenuItemType_IntConfig, .label = "Board Height:", .active = true, .action = menu_action_start_int_entry, .data.int_config_info = { .value = &g_game.current_board_h, .min_value = BOARD_MIN_HEIGHT } },
     { .type = MenuItemType_Label, .label = "Pause: SPACE", .active = false, .action = NULL, .data.label_info = { .color = TEXT_GREY } },
@@ -214,7 +216,7 @@ static void handle_key_configuring_events(SDL_Event *event) {
     MenuItem* item = &current_menu->items[active_entry_item_index];
     //we only allow to set the pressed key if it's not already used for some other setting
     //and if it's not Enter or Return key
-    if (!(pressed_key == g_game.key_left || pressed_key == g_game.key_right || pressed_key == g_game.key_up || pressed_key == g_game.key_down || pressed_key == g_game.key_pause || pressed_key == SDLK_RETURN || pressed_key == SDLK_KP_ENTER)) {
+    if (!(pressed_key == g_game.key_left || pressed_key == g_game.key_right || pressed_key == g_game.key_up || pressed_key == g_game.key_down || pressed_key == g_game.key_pause || pressed_key == g_game.key_rewind || pressed_key == g_game.key_save || pressed_key == SDLK_RETURN || pressed_key == SDLK_KP_ENTER)) {
         *(item->data.key_config_info.key_code) = pressed_key;
         save_user_config();
     }
@@ -240,6 +242,7 @@ static void handle_numeric_input_events(SDL_Event *event) {
             int new_value = atoi(entry_buffer);
             if (new_value >= item->data.int_config_info.min_value) {
                 if (!g_game.fullscreen) {
+                    g_game.config_board_w = 0; /* board size is the player's choice from now on */
                     **(item->data.int_config_info.value) = new_value;
                     g_game.window_w = (*g_game.current_board_w) * TILE_SIZE;
                     g_game.window_h = (*g_game.current_board_h + 1) * TILE_SIZE;
@@ -348,7 +351,7 @@ void handle_game_over_events(SDL_Event *event) {
 void handle_entering_hiscore_events(SDL_Event *event) {
     if (event->type == SDL_KEYDOWN) {
         if (event->key.keysym.sym == SDLK_RETURN || event->key.keysym.sym == SDLK_KP_ENTER) {
-            hiscores_add(g_game.player_name_len > 0 ? g_game.player_name : "Somebody", g_game.score, *g_game.current_board_w, *g_game.current_board_h);
+            hiscores_add(g_game.player_name_len > 0 ? g_game.player_name : "Somebody", g_game.sim.score, *g_game.current_board_w, *g_game.current_board_h);
             SDL_StopTextInput();
             main_menu_last_selected_index = 1;
             menu_action_go_to_main_menu(NULL);
@@ -372,6 +375,7 @@ void handle_escape_key(void) {
             main_menu_last_selected_index = 1;
             menu_action_go_to_main_menu(NULL);
         } else {
+            snapshots_save(); /* game being played is continued on the next start */
             menu_action_exit(NULL);
         }
     }
@@ -435,6 +439,11 @@ void menu_action_toggle_sfx(MenuItem* item) {
 void menu_action_toggle_fullscreen(MenuItem* item) {
     (void)item;
     g_game.fullscreen = !g_game.fullscreen;
+    if (g_game.config_board_w > 0) { /* leaving the board of a replay or snapshot, back to the configured one */
+        g_game.window_board_w = g_game.config_board_w;
+        g_game.window_board_h = g_game.config_board_h;
+        g_game.config_board_w = 0;
+    }
 
     if (g_game.fullscreen) {
         g_game.current_board_w = &g_game.fullscreen_board_w;
@@ -3,6 +3,7 @@
 #include "menu_rendering.h"
 #include "menu_logic.h"
 #include "text_renderer.h"
+#include "render_queue.h"
 #include <math.h>
 
 
@@ -79,7 +80,7 @@ static void render_menu_items() {
         if (item->type == MenuItemType_TableRow) {
             TableRow* row = item->data.table_row_info.row;
             for (int j = 0; j < row->num_cells; j++) {
-                render_text(g_gfx.renderer, g_gfx.txt_font, row->cells[j], col_x[j] + col_widths[j] / 2, current_y + MENU_ITEM_HEIGHT / 2, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, color);
+                render_text(row->cells[j], col_x[j] + col_widths[j] / 2, current_y + MENU_ITEM_HEIGHT / 2, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, color);
                 if (get_first_error()) return;
             }
         } else {
@@ -116,12 +117,11 @@ static void render_menu_items() {
             item->rect.h = MENU_ITEM_HEIGHT;
             item->rect.x = g_game.window_w/2 - MENU_ITEM_WIDTH/2;
             item->rect.y = current_y;
-            render_text(g_gfx.renderer, g_gfx.txt_font, text_buf, g_game.window_w/2, current_y + item->rect.h/2, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, color);
+            render_text(text_buf, g_game.window_w/2, current_y + item->rect.h/2, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, color);
             if (get_first_error()) return;
 
             if (i == selected_item_index) {
-                SDL_SetRenderDrawColor(g_gfx.renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-                SDL_RenderDrawRect(g_gfx.renderer, &item->rect);
+                render_queue_outline_rect(&item->rect, (SDL_Color){ 255, 255, 255, SDL_ALPHA_OPAQUE });
             }
         }
 
@@ -138,15 +138,16 @@ void render_menus(void) {
     Menu *menu = menu_logic_get_current_menu();
 
     SDL_Rect DstR_bg = { 0, 0, TILE_SIZE, TILE_SIZE };
-    float bg_time = g_game.frame / 80.0f;
+    render_queue_layer(RenderLayerBoard);
+    float bg_time = (g_game.frame + g_game.step_alpha) / 80.0f;
     for (y=0; y < g_game.window_h / TILE_SIZE +1; y++) {
         for (x=0; x < g_game.window_w / TILE_SIZE +1; x++) {
             DstR_bg.x = x*TILE_SIZE; DstR_bg.y = y*TILE_SIZE;
             float val = sinf(x * 0.0666f + bg_time + sinf(y * 0.3f + bg_time)) + sinf( y * 0.0666f + sinf(x * 0.35f + bg_time));
-            int tile_index = (int)((val + 2.0f) / 4.0f * (GROUND_TILES - 1) + 0.5f);
+            int tile_index = (int)((val + 2.0f) / 4.0f * (ATLAS_GROUND_COUNT - 1) + 0.5f);
             if (tile_index < 0) tile_index = 0;
-            if (tile_index >= GROUND_TILES) tile_index = GROUND_TILES - 1;
-            SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_env_tileset, &g_gfx.ground_tile[tile_index], &DstR_bg);
+            if (tile_index >= ATLAS_GROUND_COUNT) tile_index = ATLAS_GROUND_COUNT - 1;
+            render_queue_copy(g_gfx.txt_atlas, &atlas_ground[tile_index], &DstR_bg);
         }
     }
 
@@ -158,20 +159,18 @@ void render_menus(void) {
     }
     dark_rect.x = (g_game.window_w - dark_rect.w) / 2;
 
-    SDL_Rect logo_dst;
-    SDL_QueryTexture(g_gfx.txt_logo, NULL, NULL, &logo_dst.w, &logo_dst.h);
+    SDL_Rect logo_dst = atlas_logo;
     
     dark_rect.h = 2*MENU_BORDER + logo_dst.h + MENU_LOGO_SPACE + MENU_HEAD_SPACE + (menu->count-1) * MENU_ITEM_HEIGHT;
     dark_rect.y = (g_game.window_h - dark_rect.h) / 2;
     
-    SDL_SetRenderDrawBlendMode(g_gfx.renderer, SDL_BLENDMODE_BLEND);
-    SDL_SetRenderDrawColor(g_gfx.renderer, 0, 0, 0, 180);
-    SDL_RenderFillRect(g_gfx.renderer, &dark_rect);
-    SDL_SetRenderDrawBlendMode(g_gfx.renderer, SDL_BLENDMODE_NONE);
+    render_queue_layer(RenderLayerPanel);
+    render_queue_fill_rect(&dark_rect, (SDL_Color){ 0, 0, 0, 180 });
+    render_queue_layer(RenderLayerPanelContent);
 
     logo_dst.x = g_game.window_w/2 - logo_dst.w/2;
     logo_dst.y = dark_rect.y + MENU_BORDER;
-    SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_logo, NULL, &logo_dst);
+    render_queue_copy(g_gfx.txt_atlas, &atlas_logo, &logo_dst);
 
     render_menu_items();
 }
@@ -183,7 +182,7 @@ static int render_game_over_scores_table(int yc) {
     for (int i = 0; i < hall_of_fame_table.num_rows; i++) {
         TableRow* row = &hall_of_fame_table.rows[i];
         for (int j = 0; j < row->num_cells; j++) {
-            render_text(g_gfx.renderer, g_gfx.txt_font, row->cells[j], col_x[j] + col_widths[j] / 2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, row->color);
+            render_text(row->cells[j], col_x[j] + col_widths[j] / 2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, row->color);
             if (get_first_error()) return yc;
         }
         yc += MENU_ITEM_HEIGHT;
@@ -196,8 +195,7 @@ void render_game_over_overlay(void) {
     SDL_Rect DstR;
 
     int text_height = get_text_height("X");
-    SDL_SetRenderDrawColor(g_gfx.renderer, 0, 0, 0, 127);
-    SDL_QueryTexture(g_gfx.txt_trophy, NULL, NULL, &l, &l);
+    l = atlas_trophy.h;
     
     int items_count = 0;
     if (g_game.state == EnteringHiscoreName) {
@@ -227,20 +225,22 @@ void render_game_over_overlay(void) {
 
     int yc = (g_game.window_h-TILE_SIZE-DstR.h)/2;
     DstR.x = (g_game.window_w-DstR.w)/2; DstR.y = yc;
-    SDL_RenderFillRect(g_gfx.renderer, &DstR);
+    render_queue_layer(RenderLayerPanel);
+    render_queue_fill_rect(&DstR, (SDL_Color){ 0, 0, 0, 127 });
+    render_queue_layer(RenderLayerPanelContent);
     yc += GAME_OVER_BORDER + text_height/2;
-    render_text(g_gfx.renderer, g_gfx.txt_font, "Game Over", g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_WHITE);
+    render_text("Game Over", g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_WHITE);
     if (get_first_error()) return;
     yc += MENU_ITEM_HEIGHT;
 
     if (g_game.new_record) {
         DstR.w = l; DstR.h = l;
         DstR.x = (g_game.window_w-DstR.w)/2; DstR.y = yc - text_height/2;
-        SDL_RenderCopy(g_gfx.renderer, g_gfx.txt_trophy, NULL, &DstR);
+        render_queue_copy(g_gfx.txt_atlas, &atlas_trophy, &DstR);
         yc += l + MENU_ITEM_HEIGHT - text_height;
 
         if (g_game.frame % 15 < 10) {
-            render_text(g_gfx.renderer, g_gfx.txt_font, "NEW HIGH SCORE !", g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_YELLOW);
+            render_text("NEW HIGH SCORE !", g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_YELLOW);
             if (get_first_error()) return;
         }
         yc += MENU_ITEM_HEIGHT;
@@ -249,16 +249,16 @@ void render_game_over_overlay(void) {
     if (g_game.state == EnteringHiscoreName) {
         char text_buf[40];
         sprintf(text_buf, "Enter name:");
-        render_text(g_gfx.renderer, g_gfx.txt_font, text_buf, g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_YELLOW);
+        render_text(text_buf, g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_YELLOW);
         yc += MENU_ITEM_HEIGHT;
         sprintf(text_buf, "%s_", g_game.player_name);
-        render_text(g_gfx.renderer, g_gfx.txt_font, text_buf, g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_WHITE);
+        render_text(text_buf, g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_WHITE);
     } else {
         if (hall_of_fame_table.num_rows > 0) {
             yc = render_game_over_scores_table(yc);
             if (get_first_error()) return;
         }
-        render_text(g_gfx.renderer, g_gfx.txt_font, "Press any key", g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_YELLOW);
+        render_text("Press any key", g_game.window_w/2, yc, ALIGN_CENTER_HORIZONTAL, ALIGN_CENTER_VERTICAL, TEXT_YELLOW);
     }
     if (get_first_error()) return;
 }
@@ -30,6 +30,10 @@
 
 #include "pcg_basic.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 // state for global RNGs
 
 static pcg32_random_t pcg32_global = PCG32_INITIALIZER;
@@ -57,13 +61,20 @@ void pcg32_srandom(uint64_t seed, uint64_t seq)
 // pcg32_random_r(rng)
 //     Generate a uniformly distributed 32-bit random number
 
+#define PCG_DEFAULT_MULTIPLIER_64 6364136223846793005ULL
+
+static inline uint32_t pcg_output_xsh_rr_64_32(uint64_t state)
+{
+    uint32_t xorshifted = ((state >> 18u) ^ state) >> 27u;
+    uint32_t rot = state >> 59u;
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
 uint32_t pcg32_random_r(pcg32_random_t* rng)
 {
     uint64_t oldstate = rng->state;
-    rng->state = oldstate * 6364136223846793005ULL + rng->inc;
-    uint32_t xorshifted = ((oldstate >> 18u) ^ oldstate) >> 27u;
-    uint32_t rot = oldstate >> 59u;
-    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    rng->state = oldstate * PCG_DEFAULT_MULTIPLIER_64 + rng->inc;
+    return pcg_output_xsh_rr_64_32(oldstate);
 }
 
 uint32_t pcg32_random()
@@ -114,3 +125,172 @@ uint32_t pcg32_boundedrand(uint32_t bound)
     return pcg32_boundedrand_r(&pcg32_global, bound);
 }
 
+
+// pcg32_advance(delta)
+// pcg32_advance_r(rng, delta):
+//     Multi-step advance functions (jump-ahead, jump-back)
+//
+// The method used here is based on Brown, "Random Number Generation
+// with Arbitrary Stride,", Transactions of the American Nuclear
+// Society (Nov. 1994).  The algorithm is very similar to fast
+// exponentiation.
+
+static uint64_t pcg_advance_lcg_64(uint64_t state, uint64_t delta,
+                                   uint64_t cur_mult, uint64_t cur_plus)
+{
+    uint64_t acc_mult = 1u;
+    uint64_t acc_plus = 0u;
+    while (delta > 0) {
+        if (delta & 1) {
+            acc_mult *= cur_mult;
+            acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1) * cur_plus;
+        cur_mult *= cur_mult;
+        delta /= 2;
+    }
+    return acc_mult * state + acc_plus;
+}
+
+void pcg32_advance_r(pcg32_random_t* rng, uint64_t delta)
+{
+    rng->state = pcg_advance_lcg_64(rng->state, delta,
+                                    PCG_DEFAULT_MULTIPLIER_64, rng->inc);
+}
+
+void pcg32_advance(uint64_t delta)
+{
+    pcg32_advance_r(&pcg32_global, delta);
+}
+
+// pcg32_fill(buf, n)
+// pcg32_fill_r(rng, buf, n):
+//     Fill buf with n uniformly distributed 32-bit numbers
+//
+// A single generator is a chain of dependent multiplications. Here
+// PCG32_LANES copies of it run side by side, lane k being k steps ahead,
+// and every lane jumps PCG32_LANES steps at a time. Lanes are independent,
+// so the loop body pipelines well. The lane loop is unrolled so that the
+// lanes stay in registers; with AVX2 they run 4 to a vector, the 64-bit
+// multiplication made of three 32x32->64 ones.
+
+#ifdef __AVX2__
+static inline __m256i pcg_step_lanes(__m256i state, __m256i mult_lo,
+                                     __m256i mult_hi, __m256i plus)
+{
+    __m256i cross = _mm256_add_epi64(
+        _mm256_mul_epu32(_mm256_srli_epi64(state, 32), mult_lo),
+        _mm256_mul_epu32(state, mult_hi));
+    __m256i prod = _mm256_add_epi64(_mm256_mul_epu32(state, mult_lo),
+                                    _mm256_slli_epi64(cross, 32));
+    return _mm256_add_epi64(prod, plus);
+}
+
+// pcg_output_xsh_rr_64_32 of 4 lanes, in the low halves of the lanes
+static inline __m256i pcg_output_lanes(__m256i state)
+{
+    __m256i xorshifted = _mm256_and_si256(
+        _mm256_srli_epi64(_mm256_xor_si256(_mm256_srli_epi64(state, 18),
+                                           state), 27),
+        _mm256_set1_epi64x(0xffffffffu));
+    __m256i rot = _mm256_srli_epi64(state, 59);
+    return _mm256_or_si256(
+        _mm256_srlv_epi64(xorshifted, rot),
+        _mm256_sllv_epi64(xorshifted,
+                          _mm256_sub_epi64(_mm256_set1_epi64x(32), rot)));
+}
+#endif
+
+void pcg32_fill_r(pcg32_random_t* rng, uint32_t* buf, size_t n)
+{
+    size_t i = 0;
+    if (n >= 2 * PCG32_LANES) {
+        uint64_t lane[PCG32_LANES];
+        uint64_t jump_mult = 1u, jump_plus = 0u;
+        lane[0] = rng->state;
+        for (int k = 1; k < PCG32_LANES; k++)
+            lane[k] = lane[k - 1] * PCG_DEFAULT_MULTIPLIER_64 + rng->inc;
+        for (int k = 0; k < PCG32_LANES; k++) {
+            jump_plus = jump_plus * PCG_DEFAULT_MULTIPLIER_64 + rng->inc;
+            jump_mult *= PCG_DEFAULT_MULTIPLIER_64;
+        }
+#if defined(__AVX2__) && PCG32_LANES == 8
+        __m256i lo = _mm256_loadu_si256((const __m256i*)lane);
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(lane + 4));
+        const __m256i mult_lo = _mm256_set1_epi64x((uint32_t)jump_mult);
+        const __m256i mult_hi = _mm256_set1_epi64x(jump_mult >> 32);
+        const __m256i plus = _mm256_set1_epi64x((long long)jump_plus);
+        const __m256i gather = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        for (; i + PCG32_LANES <= n; i += PCG32_LANES) {
+            __m256i out_lo = _mm256_permutevar8x32_epi32(
+                pcg_output_lanes(lo), gather);
+            __m256i out_hi = _mm256_permutevar8x32_epi32(
+                pcg_output_lanes(hi), gather);
+            _mm256_storeu_si256((__m256i*)(buf + i),
+                                _mm256_permute2x128_si256(out_lo, out_hi,
+                                                          0x20));
+            lo = pcg_step_lanes(lo, mult_lo, mult_hi, plus);
+            hi = pcg_step_lanes(hi, mult_lo, mult_hi, plus);
+        }
+        rng->state = (uint64_t)_mm256_extract_epi64(lo, 0);
+#else
+        for (; i + PCG32_LANES <= n; i += PCG32_LANES) {
+#pragma GCC unroll 8
+            for (int k = 0; k < PCG32_LANES; k++) {
+                buf[i + k] = pcg_output_xsh_rr_64_32(lane[k]);
+                lane[k] = lane[k] * jump_mult + jump_plus;
+            }
+        }
+        rng->state = lane[0];
+#endif
+    }
+    for (; i < n; i++)
+        buf[i] = pcg32_random_r(rng);
+}
+
+void pcg32_fill(uint32_t* buf, size_t n)
+{
+    pcg32_fill_r(&pcg32_global, buf, n);
+}
+
+// pcg32_fill_bounded(buf, n, bound)
+// pcg32_fill_bounded_r(rng, buf, n, bound):
+//     Fill buf with n uniformly distributed numbers, r, where 0 <= r < bound
+//
+// Maps each number with a multiplication instead of a division (Lemire,
+// "Fast Random Integer Generation in an Interval", 2019). The low half of
+// the product tells if the number falls into the biased part of the range;
+// that is checked in a separate pass over the buffer, so both passes stay
+// branch free. Numbers that have to be dropped are very rare for small
+// bounds - the whole buffer is then mapped again, one by one.
+
+void pcg32_fill_bounded_r(pcg32_random_t* rng, uint32_t* buf, size_t n,
+                          uint32_t bound)
+{
+    if (bound == 0)
+        return;
+    uint32_t threshold = -bound % bound;
+    pcg32_fill_r(rng, buf, n);
+
+    uint32_t biased = 0;
+    if (threshold) {
+        for (size_t i = 0; i < n; i++)
+            biased |= (buf[i] * bound < threshold);
+    }
+    if (!biased) {
+        for (size_t i = 0; i < n; i++)
+            buf[i] = ((uint64_t)buf[i] * bound) >> 32;
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint64_t m = (uint64_t)buf[i] * bound;
+        while ((uint32_t)m < threshold)
+            m = (uint64_t)pcg32_random_r(rng) * bound;
+        buf[i] = m >> 32;
+    }
+}
+
+void pcg32_fill_bounded(uint32_t* buf, size_t n, uint32_t bound)
+{
+    pcg32_fill_bounded_r(&pcg32_global, buf, n, bound);
+}
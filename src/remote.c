@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include "types.h"
+#include "remote.h"
+#include "game_logic.h"
+#include "error_handling.h"
+
+#define HEADLESS_TICK_MS (RENDER_INTERVAL * CHAR_ANIM_FRAMES) /* same pace as the windowed game */
+
+/* One tick of the windowed game, as asked for by a step request */
+static void game_step(void *self, SimInput input) {
+    (void)self;
+    if (g_game.state != Playing) return;
+    advance_play_state(input);
+}
+
+static void game_reset(void *self, uint64_t seed) {
+    (void)self;
+    start_play_seed(seed);
+}
+
+/* Lets an external process control the game through socket file path */
+bool remote_start(const char *path) {
+    if (!sim_remote_listen(&g_game.remote, path)) {
+        perror("Could not listen for remote control");
+        return false;
+    }
+    g_game.remote_on = true;
+    return true;
+}
+
+/*
+ * Handles pending requests without waiting. In stepped mode the game board
+ * texture is brought up to date once per frame, not after every tick.
+ */
+void remote_poll(void) {
+    SimRemoteHost host = { game_step, game_reset, &g_game.sim, NULL };
+    if (sim_remote_poll(&g_game.remote, &host, 0) < 0) {
+        set_error("Error: Remote control socket failed.");
+        return;
+    }
+    if (g_game.remote.stepped) {
+        sync_game_board();
+    }
+}
+
+/*
+ * Serves remote control of a game without window, sound or rendering, on a
+ * board of minimal size, until a client shuts it down. Returns exit status.
+ */
+int remote_serve_headless(const char *path) {
+    SimContext ctx;
+    SimRemote r;
+    if (!sim_init(&ctx, BOARD_MIN_WIDTH, BOARD_MIN_HEIGHT)) {
+        fprintf(stderr, "Error allocating memory for game board\n");
+        return 1;
+    }
+    if (!sim_remote_listen(&r, path)) {
+        perror("Could not listen for remote control");
+        sim_free(&ctx);
+        return 1;
+    }
+    int status = sim_reset(&ctx, pcg32_random_r(&r.rng)) ? sim_remote_serve(&r, &ctx, HEADLESS_TICK_MS) : -1;
+    sim_remote_close(&r);
+    sim_free(&ctx);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "error_handling.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
+
+#define TEXTURES_MAX (255) /* textures told apart in keys per frame, more share the last id */
+#define BLEND_CHANGES_MAX (8) /* textures whose blend mode is set back after a frame */
+
+typedef struct {
+    uint64_t key; /* layer, texture id, blend mode, color from the highest bits down */
+    uint32_t seq; /* order given in, keeps draws of the same key in it */
+    bool outline; /* rectangle drawn as an outline, filled otherwise */
+    SDL_Texture *texture; /* NULL for rectangles */
+    SDL_Rect src, dst;
+    SDL_BlendMode blend;
+    SDL_Color color;
+} RenderCommand;
+
+static SDL_Renderer *queue_renderer = NULL;
+static bool sort_draws = true;
+static RenderCommand *commands = NULL;
+static uint32_t count = 0, cap = 0;
+static RenderLayer layer = RenderLayerBoard;
+static SDL_Texture *textures[TEXTURES_MAX]; /* of the frame, index + 1 is the id */
+static int texture_count = 0;
+static RenderQueueStats last_frame, totals;
+
+/* Draws are sorted by key if sorting, else drawn as given */
+void render_queue_init(SDL_Renderer *renderer, bool sorting) {
+    queue_renderer = renderer;
+    sort_draws = sorting;
+}
+
+void render_queue_free(void) {
+    free(commands);
+    commands = NULL;
+    count = cap = 0;
+}
+
+/* Layer of the draws given from now on, until the frame is flushed */
+void render_queue_layer(RenderLayer l) {
+    layer = l;
+}
+
+static uint64_t texture_id(SDL_Texture *texture) {
+    if (texture == NULL) return 0;
+    for (int i = 0; i < texture_count; i++) {
+        if (textures[i] == texture) return (uint64_t)i + 1;
+    }
+    if (texture_count == TEXTURES_MAX) return TEXTURES_MAX;
+    textures[texture_count++] = texture;
+    return (uint64_t)texture_count;
+}
+
+/* Makes room for n more commands */
+static bool reserve(uint32_t n) {
+    if (count + n <= cap) return true;
+    uint32_t new_cap = cap ? cap : 1024;
+    while (new_cap < count + n) new_cap *= 2;
+    RenderCommand *c = realloc(commands, new_cap * sizeof(RenderCommand));
+    if (c == NULL) {
+        set_error("Error: Error allocating memory for the render queue.");
+        return false;
+    }
+    commands = c;
+    cap = new_cap;
+    return true;
+}
+
+static uint64_t command_key(SDL_Texture *texture, SDL_BlendMode blend, SDL_Color color) {
+    return (uint64_t)layer << 56 | texture_id(texture) << 48 | (uint64_t)(blend & 0xFF) << 40 |
+           (uint64_t)color.r << 24 | (uint64_t)color.g << 16 | (uint64_t)color.b << 8 | color.a;
+}
+
+static void add_command(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst,
+                        SDL_BlendMode blend, SDL_Color color, bool outline) {
+    if (!reserve(1)) return;
+    RenderCommand *c = &commands[count];
+    c->key = command_key(texture, blend, color);
+    c->seq = count++;
+    c->outline = outline;
+    c->texture = texture;
+    if (src != NULL) {
+        c->src = *src;
+    }
+    else {
+        c->src = (SDL_Rect){ 0, 0, 0, 0 };
+        if (texture != NULL) SDL_QueryTexture(texture, NULL, NULL, &c->src.w, &c->src.h);
+    }
+    c->dst = *dst;
+    c->blend = blend;
+    c->color = color;
+}
+
+/* Queues the src part of texture (all of it if NULL) to dst, blended as the texture is set to */
+void render_queue_copy(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst) {
+    render_queue_copy_color(texture, src, dst, (SDL_Color){ 255, 255, 255, 255 });
+}
+
+/* Same as render_queue_copy(), with the texture's colors multiplied by color */
+void render_queue_copy_color(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, SDL_Color color) {
+    SDL_BlendMode blend = SDL_BLENDMODE_BLEND;
+    SDL_GetTextureBlendMode(texture, &blend);
+    add_command(texture, src, dst, blend, color, false);
+}
+
+/*
+ * Queues n parts of texture, src[i] to dst[i], as n render_queue_copy() calls
+ * would but looking the texture up once
+ */
+void render_queue_copy_n(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, int n) {
+    if (n <= 0 || !reserve((uint32_t)n)) return;
+    SDL_BlendMode blend = SDL_BLENDMODE_BLEND;
+    SDL_GetTextureBlendMode(texture, &blend);
+    const SDL_Color white = { 255, 255, 255, 255 };
+    uint64_t key = command_key(texture, blend, white);
+    for (int i = 0; i < n; i++) {
+        RenderCommand *c = &commands[count];
+        c->key = key;
+        c->seq = count++;
+        c->outline = false;
+        c->texture = texture;
+        c->src = src[i];
+        c->dst = dst[i];
+        c->blend = blend;
+        c->color = white;
+    }
+}
+
+/* Same as render_queue_copy_color(), blended with blend instead */
+void render_queue_copy_blend(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, SDL_BlendMode blend,
+                             SDL_Color color) {
+    add_command(texture, src, dst, blend, color, false);
+}
+
+/* Queues rect filled with color, blended by its alpha */
+void render_queue_fill_rect(const SDL_Rect *rect, SDL_Color color) {
+    add_command(NULL, NULL, rect, SDL_BLENDMODE_BLEND, color, false);
+}
+
+/* Queues the outline of rect in color, blended by its alpha */
+void render_queue_outline_rect(const SDL_Rect *rect, SDL_Color color) {
+    add_command(NULL, NULL, rect, SDL_BLENDMODE_BLEND, color, true);
+}
+
+static int cmp_commands(const void *a, const void *b) {
+    const RenderCommand *ca = a, *cb = b;
+    if (ca->key != cb->key) return ca->key < cb->key ? -1 : 1;
+    return ca->seq < cb->seq ? -1 : (ca->seq > cb->seq);
+}
+
+static bool same_color(SDL_Color a, SDL_Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+/*
+ * Draws the queued draws of the frame, sorted unless turned off, and counts
+ * the changes of state between them. Textures get their blend modes back.
+ */
+void render_queue_flush(void) {
+    if (sort_draws) {
+        bool sorted = true;
+        for (uint32_t i = 1; i < count && sorted; i++) sorted = commands[i - 1].key <= commands[i].key;
+        if (!sorted) qsort(commands, count, sizeof(RenderCommand), cmp_commands);
+    }
+
+    struct { SDL_Texture *texture; SDL_BlendMode blend; } restore[BLEND_CHANGES_MAX];
+    int restore_count = 0;
+    SDL_Texture *texture = NULL; /* of the last sprite */
+    SDL_BlendMode texture_blend = SDL_BLENDMODE_NONE, rect_blend = SDL_BLENDMODE_NONE;
+    SDL_Color color = { 255, 255, 255, 255 };
+    bool any_drawn = false;
+    uint64_t batch_calls = sprite_batch_stats()->draw_calls;
+    RenderQueueStats frame = { .draws = count };
+    SDL_GetRenderDrawBlendMode(queue_renderer, &rect_blend);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const RenderCommand *c = &commands[i];
+        if (any_drawn && !same_color(c->color, color)) frame.color_changes++;
+        color = c->color;
+        any_drawn = true;
+        if (c->texture == NULL) {
+            sprite_batch_flush();
+            if (c->blend != rect_blend) {
+                SDL_SetRenderDrawBlendMode(queue_renderer, c->blend);
+                rect_blend = c->blend;
+                frame.blend_changes++;
+            }
+            SDL_SetRenderDrawColor(queue_renderer, c->color.r, c->color.g, c->color.b, c->color.a);
+            if (c->outline) SDL_RenderDrawRect(queue_renderer, &c->dst);
+            else SDL_RenderFillRect(queue_renderer, &c->dst);
+            frame.draw_calls++;
+            continue;
+        }
+        if (c->texture != texture) {
+            if (texture != NULL) frame.texture_changes++;
+            texture = c->texture;
+            SDL_GetTextureBlendMode(texture, &texture_blend);
+        }
+        if (c->blend != texture_blend) {
+            sprite_batch_flush();
+            int k = 0;
+            while (k < restore_count && restore[k].texture != texture) k++;
+            if (k == restore_count && k < BLEND_CHANGES_MAX) {
+                restore[restore_count].texture = texture;
+                restore[restore_count++].blend = texture_blend;
+            }
+            SDL_SetTextureBlendMode(texture, c->blend);
+            texture_blend = c->blend;
+            frame.blend_changes++;
+        }
+        if (same_color(c->color, (SDL_Color){ 255, 255, 255, 255 })) {
+            sprite_batch_copy(texture, &c->src, &c->dst);
+        }
+        else {
+            sprite_batch_copy_color(texture, &c->src, &c->dst, c->color);
+        }
+    }
+    sprite_batch_flush();
+    for (int k = 0; k < restore_count; k++) {
+        SDL_BlendMode now;
+        if (SDL_GetTextureBlendMode(restore[k].texture, &now) == 0 && now != restore[k].blend) {
+            SDL_SetTextureBlendMode(restore[k].texture, restore[k].blend);
+        }
+    }
+
+    frame.draw_calls += sprite_batch_stats()->draw_calls - batch_calls;
+    last_frame = frame;
+    totals.draws += frame.draws;
+    totals.draw_calls += frame.draw_calls;
+    totals.texture_changes += frame.texture_changes;
+    totals.blend_changes += frame.blend_changes;
+    totals.color_changes += frame.color_changes;
+    count = 0;
+    texture_count = 0;
+    layer = RenderLayerBoard;
+}
+
+/* State changes of the frame flushed last */
+const RenderQueueStats *render_queue_last_frame(void) {
+    return &last_frame;
+}
+
+/* State changes of all frames so far */
+const RenderQueueStats *render_queue_totals(void) {
+    return &totals;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <wordexp.h>
+#include "types.h"
+#include "replays.h"
+#include "file_io.h"
+
+#define REPLAY_NAME_TRIES (100) // Numbered names tried when games end with the same name
+
+/*
+ * Saves finished game to USER_SHARE_DIR REPLAYS_DIR, file named after date,
+ * time, score and seed. The name is taken with O_EXCL, so a replay never
+ * overwrites another one; on a clash a number is appended.
+ */
+void replays_save(const SimReplay *replay) {
+    char dir_path[256] = "";
+    wordexp_t p;
+    if (wordexp(USER_SHARE_DIR REPLAYS_DIR, &p, 0) == 0) {
+        strncpy(dir_path, p.we_wordv[0], sizeof(dir_path) - 1);
+        dir_path[sizeof(dir_path) - 1] = '\0';
+        wordfree(&p);
+    }
+    if (dir_path[0] == '\0') {
+        return;
+    }
+    ensure_dir_exists(dir_path);
+
+    char stamp[32] = "0";
+    time_t now = time(NULL);
+    struct tm *tm_now = localtime(&now);
+    if (tm_now) {
+        strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", tm_now);
+    }
+    char path[PATH_MAX];
+    int fd = -1;
+    for (int n = 1; n <= REPLAY_NAME_TRIES && fd < 0; n++) {
+        char number[16] = "";
+        if (n > 1) {
+            snprintf(number, sizeof(number), "_%d", n);
+        }
+        int len = snprintf(path, sizeof(path), "%sreplay_%s_%d_%016" PRIx64 "%s.vrp", dir_path, stamp,
+                           replay->score, replay->seed, number);
+        if (len < 0 || (size_t)len >= sizeof(path)) {
+            break;
+        }
+        fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && errno != EEXIST) {
+            break;
+        }
+    }
+    if (fd < 0) {
+        perror("Could not create replay file");
+        return;
+    }
+    close(fd);
+    if (!sim_replay_save(replay, path)) {
+        perror("Could not write replay file");
+        remove(path);
+    }
+}
+
+/*
+ * Plays replay file back without rendering, as fast as possible, and reports
+ * the speed. Returns exit status: 0 if the game went exactly as recorded.
+ */
+int replays_play_fast(const char *path) {
+    SimReplay replay = {0};
+    SimContext ctx;
+    if (!sim_replay_load(&replay, path)) {
+        fprintf(stderr, "Could not read replay file '%s'\n", path);
+        return 1;
+    }
+    if (!sim_init(&ctx, replay.w, replay.h)) {
+        fprintf(stderr, "Error allocating memory for %dx%d game board\n", replay.w, replay.h);
+        sim_replay_free(&replay);
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool ok = sim_replay_run(&replay, &ctx);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("%s: %dx%d board, %u ticks, score %d, %.3f ms, %.0f ticks/s\n", path, replay.w, replay.h,
+           ctx.tick, ctx.score, elapsed * 1e3, elapsed > 0 ? ctx.tick / elapsed : 0.0);
+    if (!ok) {
+        fprintf(stderr, "Replay diverged: recorded %u ticks with score %d\n", replay.ticks, replay.score);
+    }
+    sim_free(&ctx);
+    sim_replay_free(&replay);
+    return ok ? 0 : 1;
+}
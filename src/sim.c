@@ -0,0 +1,584 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "sim_reach.h"
+
+#define SIM_RNG_STREAM (0x12345678) /* PCG stream id used for game simulations */
+#define SIM_SEED_ATTEMPTS (8) /* random picks of food location before searching for one */
+#define SIM_WALL_ATTEMPTS (4) /* wall locations tried before the wall is skipped */
+
+static void push_event(SimEvents *events, SimEventType type, int x, int y, int p) {
+    if (events && events->count < SIM_MAX_EVENTS) {
+        SimEvent *ev = &events->items[events->count++];
+        ev->type = type;
+        ev->x = x;
+        ev->y = y;
+        ev->p = p;
+    }
+}
+
+/* Empties the whole board, all fields become free */
+static void clear_board(SimContext *ctx) {
+    int n = ctx->w * ctx->h;
+    memset(ctx->board, 0, (size_t)ctx->board_cells * sizeof(BoardField)); /* Empty is all zeros */
+    for (int i = 0; i < n; i++) {
+        ctx->free_cells[i] = i;
+        ctx->free_pos[i] = i;
+    }
+    ctx->free_count = n;
+    ctx->fx = ctx->fy = -1;
+    sim_reach_clear(ctx);
+    /* skip one change so that every reader has to rescan */
+    ctx->journal_floor = ++ctx->journal_seq;
+}
+
+/* Number of fields to allocate for the board, including padding of the layout */
+static int64_t layout_cells(int64_t w, int64_t h) {
+    const int64_t tile = 1 << SIM_TILE_BITS;
+    switch (SIM_BOARD_LAYOUT) {
+        case SIM_LAYOUT_TILED:
+            return ((w + tile - 1) / tile) * ((h + tile - 1) / tile) * tile * tile;
+        case SIM_LAYOUT_MORTON: {
+            int64_t side = 1;
+            while (side < w || side < h) side *= 2;
+            return side * side;
+        }
+        default:
+            return w * h;
+    }
+}
+
+/*
+ * Tells if a board of w x h fields can be set up: no side longer than
+ * SIM_MAX_SIDE and at most SIM_MAX_FIELDS fields in the build's layout.
+ * Sizes read from files are checked with it before sim_init().
+ */
+bool sim_board_size_is_valid(int64_t w, int64_t h) {
+    return w > 0 && h > 0 && w <= SIM_MAX_SIDE && h <= SIM_MAX_SIDE && layout_cells(w, h) <= SIM_MAX_FIELDS;
+}
+
+/* Allocates board of given dimensions. Returns false when out of memory or the size is not valid. */
+bool sim_init(SimContext *ctx, int w, int h) {
+    memset(ctx, 0, sizeof(*ctx));
+    if (!sim_board_size_is_valid(w, h)) return false;
+    ctx->tiles_w = (w + (1 << SIM_TILE_BITS) - 1) >> SIM_TILE_BITS;
+    ctx->board_cells = (int)layout_cells(w, h);
+    ctx->board = calloc((size_t)ctx->board_cells, sizeof(BoardField));
+    /* snake can never be longer than the board */
+    ctx->body = malloc((size_t)w * h * sizeof(SimSegment));
+    ctx->chars = malloc((size_t)w * h);
+    ctx->free_cells = malloc((size_t)w * h * sizeof(int));
+    ctx->free_pos = malloc((size_t)w * h * sizeof(int));
+    ctx->journal = malloc(SIM_JOURNAL_SIZE * sizeof(SimChange));
+    if (ctx->board == NULL || ctx->body == NULL || ctx->chars == NULL ||
+        ctx->free_cells == NULL || ctx->free_pos == NULL || ctx->journal == NULL) {
+        sim_free(ctx);
+        return false;
+    }
+    ctx->w = w;
+    ctx->h = h;
+    if (!sim_reach_init(ctx)) {
+        sim_free(ctx);
+        return false;
+    }
+    ctx->body_cap = w * h;
+    clear_board(ctx);
+    return true;
+}
+
+void sim_free(SimContext *ctx) {
+    free(ctx->board);
+    free(ctx->body);
+    free(ctx->chars);
+    free(ctx->free_cells);
+    free(ctx->free_pos);
+    free(ctx->journal);
+    sim_reach_free(ctx);
+    ctx->board = NULL;
+    ctx->body = NULL;
+    ctx->chars = NULL;
+    ctx->free_cells = NULL;
+    ctx->free_pos = NULL;
+    ctx->journal = NULL;
+    ctx->w = ctx->h = 0;
+    ctx->body_cap = ctx->length = ctx->free_count = ctx->board_cells = 0;
+}
+
+/*
+ * Makes dst an exact copy of src, including the random generator state, so
+ * both continue the same way given the same inputs. dst has to be set up by
+ * sim_init() before - it is reallocated only if board dimensions differ.
+ * Returns false when out of memory.
+ */
+bool sim_clone(SimContext *dst, const SimContext *src) {
+    if (dst->w != src->w || dst->h != src->h) {
+        sim_free(dst);
+        if (!sim_init(dst, src->w, src->h)) return false;
+    }
+    int n = src->w * src->h;
+    memcpy(dst->board, src->board, (size_t)src->board_cells * sizeof(BoardField));
+    memcpy(dst->free_cells, src->free_cells, (size_t)src->free_count * sizeof(int));
+    memcpy(dst->free_pos, src->free_pos, (size_t)n * sizeof(int));
+    memcpy(dst->blocked, src->blocked, (size_t)src->bb_stride * src->h * sizeof(uint64_t));
+    memcpy(dst->chars, src->chars, (size_t)src->length);
+    /* live part of the body ring, in at most two pieces */
+    int tail = src->body_head - src->length + 1;
+    if (tail >= 0) {
+        memcpy(dst->body + tail, src->body + tail, (size_t)src->length * sizeof(SimSegment));
+    }
+    else {
+        memcpy(dst->body, src->body, (size_t)(src->body_head + 1) * sizeof(SimSegment));
+        tail += src->body_cap;
+        memcpy(dst->body + tail, src->body + tail, (size_t)(src->body_cap - tail) * sizeof(SimSegment));
+    }
+    dst->dhx = src->dhx;
+    dst->dhy = src->dhy;
+    dst->hx = src->hx;
+    dst->hy = src->hy;
+    dst->body_head = src->body_head;
+    dst->length = src->length;
+    dst->free_count = src->free_count;
+    dst->flood_kernel = src->flood_kernel;
+    dst->fx = src->fx;
+    dst->fy = src->fy;
+    dst->score = src->score;
+    dst->expand_counter = src->expand_counter;
+    dst->growth = src->growth;
+    dst->alive = src->alive;
+    dst->tick = src->tick;
+    dst->rng = src->rng;
+    dst->undo = NULL;
+    dst->journal_floor = ++dst->journal_seq; /* whole board changed */
+    return true;
+}
+
+static void journal_push(SimContext *ctx, int x, int y, BoardField old, BoardField value) {
+    SimChange *change = &ctx->journal[ctx->journal_seq++ & (SIM_JOURNAL_SIZE - 1)];
+    change->tick = ctx->tick;
+    change->x = (uint16_t)x;
+    change->y = (uint16_t)y;
+    change->old = old;
+    change->value = value;
+}
+
+/*
+ * Reads the change following *cursor into change and advances the cursor.
+ * Start reading with cursor 0 - first read tells to resync.
+ */
+SimJournalStatus sim_journal_next(const SimContext *ctx, uint32_t *cursor, SimChange *change) {
+    /* unsigned differences stay correct when the counters wrap around */
+    if (ctx->journal_seq - *cursor > SIM_JOURNAL_SIZE ||
+        *cursor - ctx->journal_floor > ctx->journal_seq - ctx->journal_floor) {
+        *cursor = ctx->journal_seq;
+        return SimJournalResync;
+    }
+    if (*cursor == ctx->journal_seq) {
+        return SimJournalEnd;
+    }
+    *change = ctx->journal[(*cursor)++ & (SIM_JOURNAL_SIZE - 1)];
+    return SimJournalChange;
+}
+
+/*
+ * Keeps the set of empty fields up to date for field i changing from
+ * old_type to new_type. Part of sim_set_field(), made separately by
+ * sim_set_board_field() callers - in the order of their changes.
+ */
+void sim_update_free(SimContext *ctx, int i, FieldType old_type, FieldType new_type) {
+    if (old_type == Empty && new_type != Empty) {
+        /* swap-remove from the dense array */
+        int last = ctx->free_cells[--ctx->free_count];
+        ctx->free_cells[ctx->free_pos[i]] = last;
+        ctx->free_pos[last] = ctx->free_pos[i];
+        ctx->free_pos[i] = -1;
+    }
+    else if (old_type != Empty && new_type == Empty) {
+        ctx->free_cells[ctx->free_count] = i;
+        ctx->free_pos[i] = ctx->free_count++;
+    }
+}
+
+/*
+ * Stores new content of a field as sim_set_field() does, except for the set
+ * of empty fields, which is left to sim_update_free(). Does not record undo.
+ */
+void sim_set_board_field(SimContext *ctx, int x, int y, BoardField value) {
+    BoardField *field = &ctx->board[sim_field_index(ctx, x, y)];
+    FieldType new_type = field_type(value);
+    sim_reach_set_blocked(ctx, x, y, new_type == Snake || new_type == Wall);
+    if (new_type == Food) {
+        ctx->fx = x;
+        ctx->fy = y;
+    }
+    else if (x == ctx->fx && y == ctx->fy) {
+        ctx->fx = ctx->fy = -1;
+    }
+    journal_push(ctx, x, y, *field, value);
+    *field = value;
+}
+
+/*
+ * Stores new content of a field keeping the set of empty fields, occupancy
+ * bitboard, food position and journal up to date.
+ * Every change of the board has to go through here (or sim_set_board_field()).
+ */
+void sim_set_field(SimContext *ctx, int x, int y, BoardField value) {
+    int i = ctx->w * y + x;
+    BoardField old = sim_field(ctx, x, y);
+    if (ctx->undo && ctx->undo->count < SIM_MAX_CHANGES) {
+        SimFieldChange *change = &ctx->undo->changes[ctx->undo->count++];
+        change->cell = i;
+        change->old = old;
+        change->free_slot = ctx->free_pos[i];
+        change->free_moved = ctx->free_count ? ctx->free_cells[ctx->free_count - 1] : -1;
+    }
+    sim_update_free(ctx, i, field_type(old), field_type(value));
+    sim_set_board_field(ctx, x, y, value);
+}
+
+/* Makes (x,y) the new head of the snake. Constant time. */
+static void push_head(SimContext *ctx, int x, int y) {
+    if (++ctx->body_head == ctx->body_cap) ctx->body_head = 0;
+    ctx->body[ctx->body_head].x = x;
+    ctx->body[ctx->body_head].y = y;
+    ctx->length++;
+    ctx->hx = x;
+    ctx->hy = y;
+}
+
+/* Removes the tail segment from the snake and the board. Constant time. */
+static void pop_tail(SimContext *ctx) {
+    SimSegment *tail = sim_segment(ctx, ctx->length - 1);
+    sim_set_field(ctx, tail->x, tail->y, make_field(Empty, 0, 0, 0));
+    ctx->length--;
+}
+
+static int pick_free(SimContext *ctx) {
+    return ctx->free_cells[pcg32_boundedrand_r(&ctx->rng, ctx->free_count)];
+}
+
+/*
+ * Picks empty field reachable from (ox,oy). Falls back to any empty field
+ * when there is none, e.g. when the snake has boxed itself in.
+ */
+static int pick_reachable(SimContext *ctx, int ox, int oy) {
+    sim_flood_fill(ctx, ox, oy);
+    for (int a = 0; a < SIM_SEED_ATTEMPTS; a++) {
+        int i = pick_free(ctx);
+        if (sim_reached(ctx, i % ctx->w, i / ctx->w)) return i;
+    }
+    /* reachable region is small compared to the rest, search for it */
+    int start = pcg32_boundedrand_r(&ctx->rng, ctx->free_count);
+    for (int k = 0; k < ctx->free_count; k++) {
+        int i = ctx->free_cells[(start + k) % ctx->free_count];
+        if (sim_reached(ctx, i % ctx->w, i / ctx->w)) return i;
+    }
+    return ctx->free_cells[start];
+}
+
+/* Tells if the snake can move from (ox,oy) to (x,y) - origin is passable */
+static bool passable(const SimContext *ctx, int x, int y, int ox, int oy) {
+    if (x < 0 || y < 0 || x >= ctx->w || y >= ctx->h) return false;
+    return !sim_reach_is_blocked(ctx, x, y) || (x == ox && y == oy);
+}
+
+/*
+ * Tells if wall can go to (x,y) without cutting the food off (ox,oy).
+ * If the food is out of reach already, the wall cannot make it worse.
+ * *fills tells what the locations tried for one wall have filled so far:
+ * 0 nothing, 1 ctx->reach holds the fields reachable from (ox,oy), 2 it
+ * was filled again with a location blocked. To keep within the tick a wall
+ * gets no more fills than that, a location needing a third is refused.
+ */
+static bool wall_allowed(SimContext *ctx, int x, int y, int ox, int oy, int *fills) {
+    if (ctx->fx < 0) return true;
+    /* If the passable neighbours are connected around the field through
+       its 8-neighbourhood, blocking it cannot split a region. That is the
+       case on most of the board, and saves the flood fill. */
+    static const int ring[8][2] = { {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1} };
+    bool open[8];
+    for (int k = 0; k < 8; k++) open[k] = passable(ctx, x + ring[k][0], y + ring[k][1], ox, oy);
+    int ways = 0, links = 0;
+    for (int k = 0; k < 8; k += 2) {
+        ways += open[k];
+        links += open[k] && open[k + 1] && open[(k + 2) % 8];
+    }
+    if (ways - links <= 1) return true;
+
+    if (*fills == 0) {
+        sim_flood_fill(ctx, ox, oy);
+        *fills = 1;
+    }
+    if (*fills == 1) {
+        /* a field out of the head's region, or a region without the food,
+           cannot cut the food off */
+        if (!sim_reached(ctx, ctx->fx, ctx->fy) || !sim_reached(ctx, x, y)) return true;
+        *fills = 2;
+        sim_reach_set_blocked(ctx, x, y, true);
+        bool allowed = sim_reaches(ctx, ox, oy, ctx->fx, ctx->fy);
+        sim_reach_set_blocked(ctx, x, y, false);
+        return allowed;
+    }
+    return false;
+}
+
+/*
+ * Adds obstacle or food at random empty location in game board, keeping the
+ * food reachable from (ox,oy) - the field the head is about to occupy.
+ * Food goes to the head's region whenever there is room in it. Wall is only
+ * placed where it does not cut the food off, if no such place is found in a
+ * few attempts the wall is skipped. filled tells that ctx->reach holds the
+ * fields reachable from (ox,oy) already, a wall then reuses them.
+ * Fails if there is no empty field left or the wall was skipped.
+ */
+static bool seed_item(SimContext *ctx, FieldType item_type, int ox, int oy, bool filled, SimEvents *events)
+{
+    if (ctx->free_count == 0) {
+        return false;
+    }
+    int i = -1;
+    if (item_type == Food) {
+        i = pick_reachable(ctx, ox, oy);
+    }
+    else {
+        int fills = filled ? 1 : 0;
+        for (int a = 0; a < SIM_WALL_ATTEMPTS && i < 0; a++) {
+            int c = pick_free(ctx);
+            if (wall_allowed(ctx, c % ctx->w, c / ctx->w, ox, oy, &fills)) i = c;
+        }
+        if (i < 0) return false;
+    }
+    int x = i % ctx->w, y = i / ctx->w;
+    int kind = pcg32_boundedrand_r(&ctx->rng, item_type == Food ? FOOD_KINDS : WALL_KINDS);
+    sim_set_field(ctx, x, y, make_field(item_type, kind, 0, 0));
+    push_event(events, item_type == Food ? SimEventFoodSeeded : SimEventWallSeeded, x, y, kind);
+    return true;
+}
+
+/*
+ * Clears the board and starts a new game: single segment snake in the middle
+ * of the board heading up, and one piece of food.
+ * Whole game is determined by the seed and the subsequent inputs.
+ */
+bool sim_reset(SimContext *ctx, uint64_t seed) {
+    clear_board(ctx);
+    pcg32_srandom_r(&ctx->rng, seed, SIM_RNG_STREAM);
+
+    ctx->dhx = 0;   ctx->dhy = -1;
+    ctx->score = ctx->expand_counter = 0;
+    ctx->tick = 0;
+    ctx->body_head = ctx->length = 0;
+    push_head(ctx, ctx->w/2, ctx->h/2);
+    ctx->alive = true;
+
+    sim_set_field(ctx, ctx->hx, ctx->hy, make_field(Snake, 0, -ctx->dhx, -ctx->dhy));
+    ctx->chars[0] = pcg32_boundedrand_r(&ctx->rng, TOTAL_CHARS);
+    return seed_item(ctx, Food, ctx->hx, ctx->hy, false, NULL);
+}
+
+/* Snake can only turn left or right, never reverse into itself */
+bool sim_input_is_valid(const SimContext *ctx, SimInput input) {
+    switch (input) {
+        case SimInputLeft:
+        case SimInputRight:
+            return ctx->dhx == 0;
+        case SimInputUp:
+        case SimInputDown:
+            return ctx->dhy == 0;
+        default:
+            return false;
+    }
+}
+
+static void apply_input(SimContext *ctx, SimInput input) {
+    if (!sim_input_is_valid(ctx, input)) return;
+    switch (input) {
+        case SimInputLeft: ctx->dhx = -1; ctx->dhy = 0; break;
+        case SimInputRight: ctx->dhx = 1; ctx->dhy = 0; break;
+        case SimInputUp: ctx->dhx = 0; ctx->dhy = -1; break;
+        case SimInputDown: ctx->dhx = 0; ctx->dhy = 1; break;
+        default: break;
+    }
+}
+
+/*
+ * Advances the simulation by one tick.
+ * Invalid inputs (reversing direction) are ignored.
+ * Stepping a dead snake does nothing.
+ */
+void sim_step(SimContext *ctx, SimInput input, SimEvents *events)
+{
+    if (events) events->count = 0;
+    if (!ctx->alive) return;
+    ctx->tick++;
+
+    apply_input(ctx, input);
+
+    BoardField next_field = 0;
+    bool filled = false; /* ctx->reach holds the fields reachable from the new head */
+    int next_hx = ctx->hx + ctx->dhx;
+    int next_hy = ctx->hy + ctx->dhy;
+
+    if (next_hx < 0 || next_hy < 0 ||
+        next_hx >= ctx->w || next_hy >= ctx->h) {
+        ctx->alive = false;
+    }
+    else {
+        next_field = sim_field(ctx, next_hx, next_hy);
+        if (field_type(next_field) == Food) {
+            push_event(events, SimEventFoodEaten, next_hx, next_hy, field_kind(next_field));
+            ctx->score++;
+            ctx->expand_counter += ctx->growth > 0 ? ctx->growth : ctx->score;
+            seed_item(ctx, Food, next_hx, next_hy, false, events);
+            filled = true;
+        }
+        else if (field_type(next_field) != Empty) {
+            ctx->alive = false;
+        }
+    }
+
+    if (!ctx->alive) {
+        push_event(events, SimEventDied, next_hx, next_hy, 0);
+        return;
+    }
+
+    //set the vector from new head position to (possibly) the next head position
+    sim_set_field(ctx, next_hx, next_hy, make_field(Snake, 0, -ctx->dhx, -ctx->dhy));
+    /* Characters keep their distance from the head, so nothing is shifted
+       along the body - only the head and the tail change. */
+    push_head(ctx, next_hx, next_hy);
+
+    if (ctx->expand_counter==0) {
+        //if not expanding, remove the tail
+        pop_tail(ctx);
+    }
+    else {
+        //if expanding, keep the tail, give it a random character and seed a wall
+        SimSegment *tail = sim_segment(ctx, ctx->length - 1);
+        ctx->chars[ctx->length - 1] = pcg32_boundedrand_r(&ctx->rng, TOTAL_CHARS);
+        push_event(events, SimEventExpand, tail->x, tail->y, ctx->chars[ctx->length - 1]);
+        /* the new head is all that changed on the board since the food
+           was seeded, and the fill starts from it anyway */
+        seed_item(ctx, Wall, ctx->hx, ctx->hy, filled, events);
+        ctx->expand_counter--;
+    }
+}
+
+/*
+ * Clears the board and lays a snake on it, body[0] being the head.
+ * Segments must be adjacent. Direction of movement continues from body[1]
+ * to body[0] (up for a single segment snake).
+ * Meant for setting up positions in tools and benchmarks.
+ */
+bool sim_place_snake(SimContext *ctx, const SimSegment *body, int len)
+{
+    if (len < 1 || len > ctx->body_cap) return false;
+    clear_board(ctx);
+    ctx->body_head = ctx->length = 0;
+    ctx->score = ctx->expand_counter = 0;
+    ctx->tick = 0;
+    ctx->alive = true;
+    if (len > 1) {
+        ctx->dhx = body[0].x - body[1].x;
+        ctx->dhy = body[0].y - body[1].y;
+    }
+    else {
+        ctx->dhx = 0;   ctx->dhy = -1;
+    }
+
+    /* push segments from tail to head */
+    for (int i = len - 1; i >= 0; i--) {
+        int pdx, pdy;
+        if (i < len - 1) {
+            pdx = body[i + 1].x - body[i].x;
+            pdy = body[i + 1].y - body[i].y;
+        }
+        else if (i > 0) {
+            pdx = body[i].x - body[i - 1].x;
+            pdy = body[i].y - body[i - 1].y;
+        }
+        else {
+            pdx = -ctx->dhx;
+            pdy = -ctx->dhy;
+        }
+        sim_set_field(ctx, body[i].x, body[i].y, make_field(Snake, 0, pdx, pdy));
+        push_head(ctx, body[i].x, body[i].y);
+        ctx->chars[i] = pcg32_boundedrand_r(&ctx->rng, TOTAL_CHARS);
+    }
+    return true;
+}
+
+/* Puts food or wall of given kind at (x,y). Meant for setting up positions. */
+void sim_place_item(SimContext *ctx, FieldType item_type, int x, int y, int p)
+{
+    sim_set_field(ctx, x, y, make_field(item_type, p, 0, 0));
+}
+
+/*
+ * Same as sim_step(), but records into undo what is needed to take the tick
+ * back with sim_undo().
+ */
+void sim_step_undoable(SimContext *ctx, SimInput input, SimEvents *events, SimUndo *undo)
+{
+    undo->dhx = ctx->dhx;
+    undo->dhy = ctx->dhy;
+    undo->hx = ctx->hx;
+    undo->hy = ctx->hy;
+    undo->body_head = ctx->body_head;
+    undo->length = ctx->length;
+    undo->fx = ctx->fx;
+    undo->fy = ctx->fy;
+    undo->score = ctx->score;
+    undo->expand_counter = ctx->expand_counter;
+    undo->alive = ctx->alive;
+    undo->rng = ctx->rng;
+    undo->tick = ctx->tick;
+    undo->count = 0;
+    ctx->undo = undo;
+    sim_step(ctx, input, events);
+    ctx->undo = NULL;
+}
+
+/*
+ * Takes back the tick recorded by sim_step_undoable(). Ticks have to be
+ * undone in reverse order. Constant time - the state, including the order of
+ * the set of empty fields, is exactly as it was before the tick.
+ */
+void sim_undo(SimContext *ctx, const SimUndo *undo)
+{
+    for (int k = undo->count - 1; k >= 0; k--) {
+        const SimFieldChange *change = &undo->changes[k];
+        int i = change->cell;
+        int x = i % ctx->w, y = i / ctx->w;
+        BoardField *field = &ctx->board[sim_field_index(ctx, x, y)];
+        FieldType old_type = field_type(change->old);
+        FieldType cur_type = field_type(*field);
+        if (old_type == Empty && cur_type != Empty) {
+            /* reverse the swap-remove: moved field goes back to the end */
+            ctx->free_cells[ctx->free_count] = change->free_moved;
+            ctx->free_pos[change->free_moved] = ctx->free_count++;
+            ctx->free_cells[change->free_slot] = i;
+            ctx->free_pos[i] = change->free_slot;
+        }
+        else if (old_type != Empty && cur_type == Empty) {
+            ctx->free_count--;
+            ctx->free_pos[i] = -1;
+        }
+        sim_reach_set_blocked(ctx, x, y, old_type == Snake || old_type == Wall);
+        journal_push(ctx, x, y, *field, change->old);
+        *field = change->old;
+    }
+    ctx->dhx = undo->dhx;
+    ctx->dhy = undo->dhy;
+    ctx->hx = undo->hx;
+    ctx->hy = undo->hy;
+    ctx->body_head = undo->body_head;
+    ctx->length = undo->length;
+    ctx->fx = undo->fx;
+    ctx->fy = undo->fy;
+    ctx->score = undo->score;
+    ctx->expand_counter = undo->expand_counter;
+    ctx->alive = undo->alive;
+    ctx->rng = undo->rng;
+    ctx->tick = undo->tick;
+}
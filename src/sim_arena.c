@@ -0,0 +1,302 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sim_arena.h"
+
+#define SPAWN_TRIES (64) /* random fields tried for a new snake */
+#define SPAWN_CLEAR (3) /* fields that have to be empty ahead of a new snake */
+
+/* Allocates an arena of n snakes on a w x h board. Returns false when out of memory. */
+bool sim_arena_init(SimArena *a, int n, int w, int h) {
+    memset(a, 0, sizeof(*a));
+    if (n < 1 || n > SIM_ARENA_MAX_SNAKES) return false;
+    size_t cells = (size_t)w * h;
+    a->w = w;
+    a->h = h;
+    a->n = n;
+    a->cell = calloc(cells, sizeof(uint16_t));
+    a->link = calloc(cells, 1);
+    a->free_cells = malloc(cells * sizeof(int));
+    a->food_cells = malloc(cells * sizeof(int));
+    a->slot = malloc(cells * sizeof(int));
+    a->claim_tick = calloc(cells, sizeof(uint32_t));
+    a->claim_by = malloc(cells * sizeof(int32_t));
+    a->hx = malloc((size_t)n * sizeof(int32_t));
+    a->hy = malloc((size_t)n * sizeof(int32_t));
+    a->tx = malloc((size_t)n * sizeof(int32_t));
+    a->ty = malloc((size_t)n * sizeof(int32_t));
+    a->dhx = malloc((size_t)n * sizeof(int32_t));
+    a->dhy = malloc((size_t)n * sizeof(int32_t));
+    a->length = calloc((size_t)n, sizeof(int32_t));
+    a->grow = calloc((size_t)n, sizeof(int32_t));
+    a->score = calloc((size_t)n, sizeof(int32_t));
+    a->alive = calloc((size_t)n, 1);
+    a->target = malloc((size_t)n * sizeof(int32_t));
+    a->dying = calloc((size_t)n, 1);
+    if (a->cell == NULL || a->link == NULL || a->free_cells == NULL || a->food_cells == NULL ||
+        a->slot == NULL || a->claim_tick == NULL || a->claim_by == NULL || a->hx == NULL ||
+        a->hy == NULL || a->tx == NULL || a->ty == NULL || a->dhx == NULL || a->dhy == NULL ||
+        a->length == NULL || a->grow == NULL || a->score == NULL || a->alive == NULL ||
+        a->target == NULL || a->dying == NULL) {
+        sim_arena_free(a);
+        return false;
+    }
+    a->food_target = (int)(cells / 50) + 1;
+    a->growth = 1;
+    sim_arena_reset(a, 0);
+    return true;
+}
+
+void sim_arena_free(SimArena *a) {
+    free(a->cell);
+    free(a->link);
+    free(a->free_cells);
+    free(a->food_cells);
+    free(a->slot);
+    free(a->claim_tick);
+    free(a->claim_by);
+    free(a->hx);
+    free(a->hy);
+    free(a->tx);
+    free(a->ty);
+    free(a->dhx);
+    free(a->dhy);
+    free(a->length);
+    free(a->grow);
+    free(a->score);
+    free(a->alive);
+    free(a->target);
+    free(a->dying);
+    memset(a, 0, sizeof(*a));
+}
+
+/* Changes content of field c, keeping the sets of empty fields and food up to date */
+static void set_cell(SimArena *a, int c, uint16_t value) {
+    uint16_t old = a->cell[c];
+    if (old == 0 || old == SIM_ARENA_FOOD) {
+        int *cells = old == 0 ? a->free_cells : a->food_cells;
+        int *count = old == 0 ? &a->free_count : &a->food_count;
+        int last = cells[--*count];
+        cells[a->slot[c]] = last;
+        a->slot[last] = a->slot[c];
+    }
+    if (value == 0 || value == SIM_ARENA_FOOD) {
+        int *cells = value == 0 ? a->free_cells : a->food_cells;
+        int *count = value == 0 ? &a->free_count : &a->food_count;
+        a->slot[c] = *count;
+        cells[(*count)++] = c;
+    }
+    a->cell[c] = value;
+}
+
+static void seed_food(SimArena *a) {
+    while (a->food_count < a->food_target && a->free_count > 0) {
+        set_cell(a, a->free_cells[pcg32_boundedrand_r(&a->rng, a->free_count)], SIM_ARENA_FOOD);
+    }
+}
+
+/* Empties the board, kills all snakes and seeds food. Snakes enter with sim_arena_spawn(). */
+void sim_arena_reset(SimArena *a, uint64_t seed) {
+    int cells = a->w * a->h;
+    memset(a->cell, 0, (size_t)cells * sizeof(uint16_t));
+    memset(a->claim_tick, 0, (size_t)cells * sizeof(uint32_t));
+    for (int c = 0; c < cells; c++) {
+        a->free_cells[c] = c;
+        a->slot[c] = c;
+    }
+    a->free_count = cells;
+    a->food_count = 0;
+    memset(a->alive, 0, (size_t)a->n);
+    a->tick = 0;
+    a->head_on = a->crashed = 0;
+    pcg32_srandom_r(&a->rng, seed, 0xa4e7a);
+    seed_food(a);
+}
+
+static bool is_clear(const SimArena *a, int x, int y) {
+    if (x < 0 || y < 0 || x >= a->w || y >= a->h) return false;
+    uint16_t v = a->cell[a->w * y + x];
+    return v == 0 || v == SIM_ARENA_FOOD;
+}
+
+/*
+ * Puts dead snake s on a random empty field with some room ahead. It starts
+ * as a single segment and grows to length. Returns false if no place was found.
+ */
+bool sim_arena_spawn(SimArena *a, int s, int length) {
+    static const int dirs[4][2] = { {1, 0}, {0, 1}, {-1, 0}, {0, -1} };
+    if (a->alive[s]) return false;
+    for (int t = 0; t < SPAWN_TRIES && a->free_count > 0; t++) {
+        int c = a->free_cells[pcg32_boundedrand_r(&a->rng, a->free_count)];
+        int x = c % a->w, y = c / a->w;
+        const int *d = dirs[pcg32_boundedrand_r(&a->rng, 4)];
+        bool clear = true;
+        for (int k = 1; k <= SPAWN_CLEAR && clear; k++) clear = is_clear(a, x + k * d[0], y + k * d[1]);
+        if (!clear) continue;
+        set_cell(a, c, (uint16_t)(s + 1));
+        a->hx[s] = a->tx[s] = x;
+        a->hy[s] = a->ty[s] = y;
+        a->dhx[s] = d[0];
+        a->dhy[s] = d[1];
+        a->length[s] = 1;
+        a->grow[s] = length > 1 ? length - 1 : 0;
+        a->score[s] = 0;
+        a->alive[s] = 1;
+        return true;
+    }
+    return false;
+}
+
+/* Removes the whole body of snake s from the board */
+static void remove_snake(SimArena *a, int s) {
+    int x = a->tx[s], y = a->ty[s];
+    for (int k = 0; k < a->length[s]; k++) {
+        int c = a->w * y + x;
+        int l = a->link[c];
+        set_cell(a, c, 0);
+        x += sim_arena_link_dx(l);
+        y += sim_arena_link_dy(l);
+    }
+    a->alive[s] = 0;
+}
+
+static void mark_dying(SimArena *a, int s, bool head_on) {
+    if (a->dying[s]) return;
+    a->dying[s] = 1;
+    if (head_on) a->head_on++;
+    else a->crashed++;
+}
+
+/*
+ * Advances all snakes by one tick, snake s turning by inputs[s] (inputs may be
+ * NULL, reversing is ignored as in the game). Returns the number of snakes
+ * that died in this tick.
+ */
+int sim_arena_step(SimArena *a, const SimInput *inputs) {
+    uint32_t stamp = ++a->tick;
+    int died = 0;
+
+    /* new direction and target field of every snake, the checks need all of them */
+    for (int s = 0; s < a->n; s++) {
+        if (!a->alive[s]) continue;
+        a->dying[s] = 0;
+        int dx = 0, dy = 0;
+        switch (inputs != NULL ? inputs[s] : SimInputNone) {
+            case SimInputLeft: dx = -1; break;
+            case SimInputRight: dx = 1; break;
+            case SimInputUp: dy = -1; break;
+            case SimInputDown: dy = 1; break;
+            default: break;
+        }
+        if ((dx || dy) && !(dx == -a->dhx[s] && dy == -a->dhy[s])) {
+            a->dhx[s] = dx;
+            a->dhy[s] = dy;
+        }
+        int nx = a->hx[s] + a->dhx[s], ny = a->hy[s] + a->dhy[s];
+        if (nx < 0 || ny < 0 || nx >= a->w || ny >= a->h) {
+            a->target[s] = -1;
+            mark_dying(a, s, false);
+            continue;
+        }
+        a->target[s] = a->w * ny + nx;
+    }
+
+    /* decide every move against the board as it was */
+    for (int s = 0; s < a->n; s++) {
+        if (!a->alive[s] || a->target[s] < 0) continue;
+        int c = a->target[s];
+        if (a->claim_tick[c] == stamp) { /* heads meet */
+            mark_dying(a, s, true);
+            mark_dying(a, a->claim_by[c], true);
+        }
+        else {
+            a->claim_tick[c] = stamp;
+            a->claim_by[c] = s;
+        }
+        uint16_t v = a->cell[c];
+        if (v != 0 && v != SIM_ARENA_FOOD) {
+            int o = v - 1;
+            if (a->w * a->hy[o] + a->hx[o] == c && a->target[o] == a->w * a->hy[s] + a->hx[s]) {
+                /* heads swap places */
+                mark_dying(a, s, true);
+                mark_dying(a, o, true);
+            }
+            /* only a tail that moves away can be entered */
+            else if (a->w * a->ty[o] + a->tx[o] != c || a->grow[o] > 0) mark_dying(a, s, false);
+        }
+    }
+
+    /* apply: dead snakes leave, then tails and heads of the living move */
+    for (int s = 0; s < a->n; s++) {
+        if (a->alive[s] && a->dying[s]) {
+            remove_snake(a, s);
+            died++;
+        }
+    }
+    for (int s = 0; s < a->n; s++) {
+        if (!a->alive[s]) continue;
+        int dx = a->dhx[s], dy = a->dhy[s];
+        a->link[a->w * a->hy[s] + a->hx[s]] = (uint8_t)(dx ? 1 - dx : 2 - dy);
+        if (a->grow[s] > 0) {
+            a->grow[s]--;
+            a->length[s]++;
+        }
+        else {
+            int c = a->w * a->ty[s] + a->tx[s];
+            int l = a->link[c];
+            set_cell(a, c, 0);
+            a->tx[s] += sim_arena_link_dx(l);
+            a->ty[s] += sim_arena_link_dy(l);
+        }
+    }
+    for (int s = 0; s < a->n; s++) {
+        if (!a->alive[s]) continue;
+        int c = a->target[s];
+        if (a->cell[c] == SIM_ARENA_FOOD) {
+            a->score[s]++;
+            a->grow[s] += a->growth;
+        }
+        set_cell(a, c, (uint16_t)(s + 1));
+        a->hx[s] = c % a->w;
+        a->hy[s] = c / a->w;
+    }
+    seed_food(a);
+    return died;
+}
+
+/*
+ * Input of a simple bot for snake s: heads for a piece of food picked by its
+ * number, keeps off bodies and fields next to other heads.
+ */
+SimInput sim_arena_bot_input(SimArena *a, int s) {
+    static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+    static const SimInput inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+    int fx = a->hx[s], fy = a->hy[s];
+    if (a->food_count > 0) {
+        int f = a->food_cells[s % a->food_count];
+        fx = f % a->w;
+        fy = f / a->w;
+    }
+    int best = -1, best_score = 0;
+    uint32_t r = pcg32_random_r(&a->rng);
+    for (int k = 0; k < 4; k++) {
+        int d = (k + r) % 4;
+        if (dirs[d][0] == -a->dhx[s] && dirs[d][1] == -a->dhy[s]) continue;
+        int nx = a->hx[s] + dirs[d][0], ny = a->hy[s] + dirs[d][1];
+        if (!is_clear(a, nx, ny)) continue;
+        int score = -abs(fx - nx) - abs(fy - ny);
+        for (int e = 0; e < 4; e++) { /* another head could enter the same field */
+            int ex = nx + dirs[e][0], ey = ny + dirs[e][1];
+            if (ex < 0 || ey < 0 || ex >= a->w || ey >= a->h) continue;
+            uint16_t v = a->cell[a->w * ey + ex];
+            if (v != 0 && v != SIM_ARENA_FOOD && v != s + 1 && a->hx[v - 1] == ex && a->hy[v - 1] == ey) {
+                score -= 2 * (a->w + a->h);
+            }
+        }
+        if (best == -1 || score > best_score) {
+            best = d;
+            best_score = score;
+        }
+    }
+    if (best == -1 || (dirs[best][0] == a->dhx[s] && dirs[best][1] == a->dhy[s])) return SimInputNone;
+    return inputs[best];
+}
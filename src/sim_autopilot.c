@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sim_controller.h"
+#include "sim_reach.h"
+
+/*
+ * Fields are numbered row by row over the board surrounded by a border of
+ * blocked fields, so that neighbours are simply +-1 and +-stride away and
+ * never off the board.
+ */
+
+static const int dirs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+static const SimInput dir_inputs[4] = { SimInputLeft, SimInputRight, SimInputUp, SimInputDown };
+
+#define REGION_SHARE (16) /* more work than 1/16 of the board is cheaper to recompute fully */
+#define TICK_FIELDS (1 << 16) /* fields visited in a tick before the rest is left to the next ones */
+
+enum { Kept, Queued, Lost }; /* state of a field while a blocked field is handled */
+
+/* Field number of neighbour d of field i */
+static inline int neighbour(const SimAutopilot *a, int i, int d) {
+    return i + dirs[d][0] + dirs[d][1] * a->stride;
+}
+
+/* Most fields close_field() visits, or distances its seeds span, before it gives up */
+static inline int region_max(const SimAutopilot *a) {
+    int share = a->w * a->h / REGION_SHARE;
+    return (share < TICK_FIELDS ? share : TICK_FIELDS) + 4;
+}
+
+/* Allocates distance field for a board of w x h fields. Returns false when out of memory. */
+bool sim_autopilot_init(SimAutopilot *a, int w, int h) {
+    memset(a, 0, sizeof(*a));
+    a->w = w;
+    a->h = h;
+    a->stride = w + 2;
+    a->dist = malloc((size_t)a->stride * (h + 2) * sizeof(int32_t));
+    a->next = malloc((size_t)a->stride * (h + 2) * sizeof(int32_t));
+    a->queue = malloc((size_t)w * h * sizeof(int));
+    a->region = malloc((size_t)region_max(a) * sizeof(int));
+    a->seeds = malloc((size_t)region_max(a) * sizeof(int));
+    a->buckets = malloc(((size_t)region_max(a) + 1) * sizeof(int));
+    a->lost = calloc((size_t)a->stride * (h + 2), 1);
+    if (a->dist == NULL || a->next == NULL || a->queue == NULL || a->region == NULL || a->seeds == NULL ||
+        a->buckets == NULL || a->lost == NULL) {
+        sim_autopilot_free(a);
+        return false;
+    }
+    a->incremental = true;
+    a->food = -2;
+    return true;
+}
+
+void sim_autopilot_free(SimAutopilot *a) {
+    free(a->dist);
+    free(a->next);
+    free(a->queue);
+    free(a->region);
+    free(a->seeds);
+    free(a->buckets);
+    free(a->lost);
+    memset(a, 0, sizeof(*a));
+}
+
+/* Spreads distances shorter than before from fields in queue[0..tail) */
+static void spread(SimAutopilot *a, int tail) {
+    int head = 0;
+    const int offsets[4] = { -1, 1, -a->stride, a->stride };
+    while (head < tail) {
+        int i = a->queue[head++];
+        int32_t next = a->dist[i] + 1;
+        for (int d = 0; d < 4; d++) {
+            int n = i + offsets[d];
+            if (a->dist[n] > next) { /* blocked fields are negative */
+                a->dist[n] = next;
+                a->queue[tail++] = n;
+            }
+        }
+    }
+    a->fields_visited += tail;
+}
+
+/* Field number of the food, -1 if there is none */
+static int food_field(const SimAutopilot *a, const SimContext *ctx) {
+    return ctx->fx < 0 ? -1 : sim_autopilot_field(a, ctx->fx, ctx->fy);
+}
+
+/* Row y of the board (with the border around it) in field dist, before any distance is known */
+static void init_row(const SimAutopilot *a, const SimContext *ctx, int32_t *dist, int y) {
+    int32_t *row = dist + (size_t)a->stride * (y + 1);
+    row[0] = row[a->w + 1] = SIM_DIST_BLOCKED;
+    for (int x = 0; x < a->w; x++) {
+        row[x + 1] = sim_reach_is_blocked(ctx, x, y) ? SIM_DIST_BLOCKED : SIM_DIST_UNREACHED;
+    }
+}
+
+/* Top and bottom border of field dist */
+static void init_border(const SimAutopilot *a, int32_t *dist) {
+    int32_t *bottom = dist + (size_t)a->stride * (a->h + 1);
+    for (int x = 0; x < a->stride; x++) dist[x] = bottom[x] = SIM_DIST_BLOCKED;
+}
+
+/* Distance field from scratch: BFS from the food */
+static void compute_full(SimAutopilot *a, const SimContext *ctx) {
+    init_border(a, a->dist);
+    for (int y = 0; y < a->h; y++) init_row(a, ctx, a->dist, y);
+    a->full_updates++;
+    a->valid = true;
+    a->food = food_field(a, ctx);
+    if (a->food < 0) return;
+
+    a->dist[a->food] = 0;
+    a->queue[0] = a->food;
+    spread(a, 1);
+}
+
+/* Starts recomputing the field into next, on the board as it is now */
+static void start_rebuild(SimAutopilot *a, const SimContext *ctx) {
+    init_border(a, a->next);
+    a->rebuilding = true;
+    a->rebuild_food = food_field(a, ctx);
+    a->rebuild_rows = 0;
+    a->rebuild_head = a->rebuild_tail = 0;
+}
+
+/*
+ * Continues the recompute until fields_visited reaches end. Rows read in later
+ * ticks may already hold changes the journal has after the start; reading
+ * them again from there leaves the field right all the same, as blocking a
+ * blocked field or freeing a free one just confirms its distance.
+ * Returns true when the field is done and swapped in, up to date with the
+ * board up to cursor.
+ */
+static bool rebuild(SimAutopilot *a, const SimContext *ctx, long end) {
+    const int offsets[4] = { -1, 1, -a->stride, a->stride };
+    while (a->rebuild_rows < a->h) {
+        if (a->fields_visited >= end) return false;
+        init_row(a, ctx, a->next, a->rebuild_rows++);
+        a->fields_visited += a->w;
+        if (a->rebuild_rows == a->h && a->rebuild_food >= 0) {
+            a->next[a->rebuild_food] = 0;
+            a->queue[a->rebuild_tail++] = a->rebuild_food;
+        }
+    }
+    int head = a->rebuild_head, tail = a->rebuild_tail;
+    while (head < tail && a->fields_visited < end) {
+        int i = a->queue[head++];
+        int32_t next = a->next[i] + 1;
+        for (int d = 0; d < 4; d++) {
+            int n = i + offsets[d];
+            if (a->next[n] > next) {
+                a->next[n] = next;
+                a->queue[tail++] = n;
+            }
+        }
+        a->fields_visited++;
+    }
+    a->rebuild_head = head;
+    a->rebuild_tail = tail;
+    if (head < tail) return false;
+
+    int32_t *dist = a->dist;
+    a->dist = a->next;
+    a->next = dist;
+    a->food = a->rebuild_food;
+    a->rebuilding = false;
+    a->valid = true;
+    a->full_updates++;
+    return true;
+}
+
+/* Field i became passable: it may shorten paths of fields around it */
+static void open_field(SimAutopilot *a, int i) {
+    int32_t best = SIM_DIST_UNREACHED;
+    for (int d = 0; d < 4; d++) {
+        int n = neighbour(a, i, d);
+        if (a->dist[n] >= 0 && a->dist[n] < best) best = a->dist[n];
+    }
+    a->dist[i] = best == SIM_DIST_UNREACHED ? best : best + 1;
+    if (a->dist[i] != SIM_DIST_UNREACHED) {
+        a->queue[0] = i;
+        spread(a, 1);
+    }
+}
+
+/* Gives up on the region of close_field(), the field is recomputed fully then */
+static bool give_up(SimAutopilot *a, int count, int visited) {
+    for (int k = 0; k < count; k++) a->lost[a->region[k]] = Kept;
+    a->fields_visited += visited;
+    return false;
+}
+
+/*
+ * Field i became blocked. Fields whose every shortest path led through it
+ * (the region) are found level by level, then their distances are rebuilt
+ * by a BFS seeded from the fields bordering the region, bucketed by distance.
+ * Returns false as soon as the work grows past region_max(), so that it never
+ * costs much on top of the full recompute the field needs then.
+ */
+static bool close_field(SimAutopilot *a, int i) {
+    int32_t old = a->dist[i];
+    a->dist[i] = SIM_DIST_BLOCKED;
+    if (old == SIM_DIST_UNREACHED || old < 0) return true;
+    int max_count = region_max(a);
+
+    /* queue holds candidates in order of distance, every level is complete
+       before the next one is checked */
+    int head = 0, tail = 0, count = 0;
+    for (int d = 0; d < 4; d++) {
+        int n = neighbour(a, i, d);
+        if (a->dist[n] == old + 1) {
+            a->lost[n] = Queued;
+            a->queue[tail++] = n;
+        }
+    }
+    while (head < tail) {
+        int v = a->queue[head++];
+        bool supported = false;
+        for (int d = 0; d < 4 && !supported; d++) {
+            int n = neighbour(a, v, d);
+            supported = a->lost[n] != Lost && a->dist[n] == a->dist[v] - 1;
+        }
+        if (supported) {
+            a->lost[v] = Kept;
+            continue;
+        }
+        a->lost[v] = Lost;
+        a->region[count++] = v;
+        for (int d = 0; d < 4; d++) {
+            int n = neighbour(a, v, d);
+            if (a->dist[n] == a->dist[v] + 1 && a->lost[n] == Kept) {
+                a->lost[n] = Queued;
+                a->queue[tail++] = n;
+            }
+        }
+        if (tail > max_count) {
+            /* candidates still queued are marked too */
+            for (int k = head; k < tail; k++) a->lost[a->queue[k]] = Kept;
+            return give_up(a, count, tail);
+        }
+    }
+    a->fields_visited += tail;
+
+    /* best distance of each region field through fields outside of it */
+    int32_t low = SIM_DIST_UNREACHED, high = 0;
+    for (int k = 0; k < count; k++) {
+        int v = a->region[k];
+        int32_t best = SIM_DIST_UNREACHED;
+        for (int d = 0; d < 4; d++) {
+            int n = neighbour(a, v, d);
+            if (a->lost[n] != Lost && a->dist[n] >= 0 && a->dist[n] < best) best = a->dist[n];
+        }
+        a->dist[v] = best == SIM_DIST_UNREACHED ? best : best + 1;
+        if (a->dist[v] == SIM_DIST_UNREACHED) continue;
+        if (a->dist[v] < low) low = a->dist[v];
+        if (a->dist[v] > high) high = a->dist[v];
+    }
+
+    /* seeds in order of distance, counted into a bucket per distance */
+    int seeds = 0;
+    if (low != SIM_DIST_UNREACHED) {
+        int span = high - low + 1;
+        if (span > max_count) return give_up(a, count, 0);
+        memset(a->buckets, 0, ((size_t)span + 1) * sizeof(int));
+        for (int k = 0; k < count; k++) {
+            int32_t dv = a->dist[a->region[k]];
+            if (dv != SIM_DIST_UNREACHED) a->buckets[dv - low + 1]++;
+        }
+        for (int b = 1; b <= span; b++) a->buckets[b] += a->buckets[b - 1];
+        for (int k = 0; k < count; k++) {
+            int v = a->region[k];
+            if (a->dist[v] != SIM_DIST_UNREACHED) a->seeds[a->buckets[a->dist[v] - low]++] = v;
+        }
+        seeds = a->buckets[span - 1];
+    }
+
+    /* BFS merging the sorted seeds with its own queue, which is sorted too */
+    int seed = 0;
+    head = tail = 0;
+    while (seed < seeds || head < tail) {
+        int v;
+        if (head < tail && (seed == seeds || a->dist[a->queue[head]] <= a->dist[a->seeds[seed]])) {
+            v = a->queue[head++];
+        }
+        else {
+            v = a->seeds[seed++];
+        }
+        int32_t next = a->dist[v] + 1;
+        for (int d = 0; d < 4; d++) {
+            int n = neighbour(a, v, d);
+            if (a->lost[n] == Lost && a->dist[n] > next) {
+                a->dist[n] = next;
+                a->queue[tail++] = n;
+            }
+        }
+    }
+    a->fields_visited += count + tail;
+    for (int k = 0; k < count; k++) a->lost[a->region[k]] = Kept;
+    return true;
+}
+
+static bool passable(BoardField f) {
+    return field_type(f) == Empty || field_type(f) == Food;
+}
+
+/*
+ * Brings the distance field up to date with the board, following its journal.
+ * In incremental mode a tick visits about TICK_FIELDS fields at most (plus
+ * one change in progress): a recompute is spread over ticks, and the journal
+ * is read on in the next tick once the work is used up.
+ */
+void sim_autopilot_update(SimAutopilot *a, const SimContext *ctx) {
+    SimChange change;
+    SimJournalStatus status;
+    long end = a->fields_visited + TICK_FIELDS;
+    if (a->rebuilding && !rebuild(a, ctx, end)) return;
+    while (!(a->incremental && a->valid && a->fields_visited >= end) &&
+           (status = sim_journal_next(ctx, &a->cursor, &change)) != SimJournalEnd) {
+        if (!a->valid) continue; /* recomputed at the end anyway */
+        if (status == SimJournalResync || !a->incremental ||
+            field_type(change.old) == Food || field_type(change.value) == Food) {
+            a->valid = false; /* board reset or food moved */
+            continue;
+        }
+        bool was = passable(change.old), is = passable(change.value);
+        if (was != is) {
+            int i = sim_autopilot_field(a, change.x, change.y);
+            if (is) open_field(a, i);
+            else if (!close_field(a, i)) a->valid = false;
+            a->incremental_updates++;
+        }
+    }
+    if (a->valid) return;
+    if (!a->incremental) {
+        compute_full(a, ctx);
+        return;
+    }
+    start_rebuild(a, ctx);
+    rebuild(a, ctx, end);
+}
+
+/* Tells if the snake can enter field (x,y) */
+static bool free_at(const SimContext *ctx, int x, int y) {
+    return x >= 0 && y >= 0 && x < ctx->w && y < ctx->h && !sim_reach_is_blocked(ctx, x, y);
+}
+
+/*
+ * Picks the move towards the food along a shortest path, keeping current
+ * direction on ties. While the distance field leads to where the food was
+ * before, heads for the food by straight distance instead. When the food
+ * cannot be reached, moves to the free neighbour with most free fields around.
+ */
+SimInput sim_autopilot_decide(SimAutopilot *a, const SimContext *ctx) {
+    if (ctx->w != a->w || ctx->h != a->h) return SimInputNone;
+    sim_autopilot_update(a, ctx);
+
+    bool greedy = a->food != food_field(a, ctx);
+    int best = -1, best_room = -1;
+    int32_t best_dist = SIM_DIST_UNREACHED;
+    for (int d = 0; d < 4; d++) {
+        if (dirs[d][0] == -ctx->dhx && dirs[d][1] == -ctx->dhy) continue;
+        int x = ctx->hx + dirs[d][0], y = ctx->hy + dirs[d][1];
+        if (!free_at(ctx, x, y)) continue; /* the field may be behind the board */
+        int32_t dist = a->dist[sim_autopilot_field(a, x, y)];
+        if (greedy) dist = ctx->fx < 0 ? SIM_DIST_UNREACHED : abs(x - ctx->fx) + abs(y - ctx->fy);
+        else if (dist < 0) dist = SIM_DIST_UNREACHED;
+        bool ahead = dirs[d][0] == ctx->dhx && dirs[d][1] == ctx->dhy;
+        if (dist < best_dist || (dist == best_dist && ahead && best_dist != SIM_DIST_UNREACHED)) {
+            best = d;
+            best_dist = dist;
+        }
+        if (best_dist == SIM_DIST_UNREACHED) {
+            int room = 0;
+            for (int k = 0; k < 4; k++) room += free_at(ctx, x + dirs[k][0], y + dirs[k][1]);
+            if (room > best_room || (room == best_room && ahead)) {
+                best = d;
+                best_room = room;
+            }
+        }
+    }
+    if (best < 0 || !sim_input_is_valid(ctx, dir_inputs[best])) return SimInputNone;
+    return dir_inputs[best];
+}
+
+static SimInput autopilot_decide(void *self, const SimContext *ctx) {
+    return sim_autopilot_decide(self, ctx);
+}
+
+SimController sim_autopilot_controller(SimAutopilot *a) {
+    SimController c = { "autopilot", autopilot_decide, a };
+    return c;
+}
@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sim_batch.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+enum { PlanNone, PlanMove, PlanStep }; /* dead, plain move, needs sim_step() */
+
+/* Allocates n games on boards of w x h fields. Returns false when out of memory. */
+bool sim_batch_init(SimBatch *b, int n, int w, int h) {
+    memset(b, 0, sizeof(*b));
+    b->w = w;
+    b->h = h;
+    b->games = calloc((size_t)n, sizeof(SimContext));
+    b->hx = malloc((size_t)n * sizeof(int32_t));
+    b->hy = malloc((size_t)n * sizeof(int32_t));
+    b->dhx = malloc((size_t)n * sizeof(int32_t));
+    b->dhy = malloc((size_t)n * sizeof(int32_t));
+    b->fx = malloc((size_t)n * sizeof(int32_t));
+    b->fy = malloc((size_t)n * sizeof(int32_t));
+    b->expand_counter = malloc((size_t)n * sizeof(int32_t));
+    b->tick = malloc((size_t)n * sizeof(uint32_t));
+    b->alive = calloc((size_t)n, 1);
+    b->plan_dx = malloc((size_t)n * sizeof(int32_t));
+    b->plan_dy = malloc((size_t)n * sizeof(int32_t));
+    b->plan = malloc((size_t)n);
+    b->pending = malloc((size_t)n * SIM_BATCH_PENDING * 2 * sizeof(int32_t));
+    b->pending_moves = calloc((size_t)n, 1);
+    b->bb_words = (w + 63) / 64 * h;
+    b->blocked = malloc((size_t)n * b->bb_words * sizeof(uint64_t));
+    b->grid_words = (w * h + 63) / 64;
+    b->grid = calloc((size_t)n * b->grid_words, sizeof(uint64_t));
+    if (b->games == NULL || b->hx == NULL || b->hy == NULL || b->dhx == NULL || b->dhy == NULL ||
+        b->fx == NULL || b->fy == NULL || b->expand_counter == NULL || b->tick == NULL ||
+        b->alive == NULL || b->plan_dx == NULL || b->plan_dy == NULL || b->plan == NULL ||
+        b->pending == NULL || b->pending_moves == NULL || b->blocked == NULL || b->grid == NULL) {
+        sim_batch_free(b);
+        return false;
+    }
+    for (int g = 0; g < n; g++) {
+        SimContext *ctx = &b->games[g];
+        if (!sim_init(ctx, w, h)) {
+            sim_batch_free(b);
+            return false;
+        }
+        b->n = g + 1;
+        /* move the bitboard into the shared block, so one gather reaches any game */
+        uint64_t *blocked = b->blocked + (size_t)b->bb_words * g;
+        memcpy(blocked, ctx->blocked, (size_t)b->bb_words * sizeof(uint64_t));
+        free(ctx->blocked);
+        ctx->blocked = blocked;
+        b->hx[g] = b->hy[g] = b->fx[g] = b->fy[g] = -1;
+        b->dhx[g] = b->dhy[g] = b->expand_counter[g] = 0;
+        b->tick[g] = 0;
+    }
+    return true;
+}
+
+void sim_batch_free(SimBatch *b) {
+    for (int g = 0; g < b->n; g++) {
+        b->games[g].blocked = NULL; /* part of b->blocked */
+        sim_free(&b->games[g]);
+    }
+    free(b->games);
+    free(b->hx);
+    free(b->hy);
+    free(b->dhx);
+    free(b->dhy);
+    free(b->fx);
+    free(b->fy);
+    free(b->expand_counter);
+    free(b->tick);
+    free(b->alive);
+    free(b->plan_dx);
+    free(b->plan_dy);
+    free(b->plan);
+    free(b->pending);
+    free(b->pending_moves);
+    free(b->blocked);
+    free(b->grid);
+    memset(b, 0, sizeof(*b));
+}
+
+/* Packs the occupancy bitboard of game g into its observation grid */
+static void pack_grid(SimBatch *b, int g) {
+    const SimContext *ctx = &b->games[g];
+    uint64_t *grid = b->grid + (size_t)b->grid_words * g;
+    memset(grid, 0, (size_t)b->grid_words * sizeof(uint64_t));
+    for (int y = 0; y < b->h; y++) {
+        for (int x = 0; x < b->w; x += 64) {
+            int bits = b->w - x < 64 ? b->w - x : 64;
+            uint64_t word = ctx->blocked[ctx->bb_stride * y + x / 64];
+            if (bits < 64) word &= ((uint64_t)1 << bits) - 1;
+            int p = b->w * y + x;
+            grid[p / 64] |= word << (p % 64);
+            if (p % 64 + bits > 64) grid[p / 64 + 1] |= word >> (64 - p % 64);
+        }
+    }
+}
+
+/*
+ * Applies the pending moves of game g to its set of empty fields, in the
+ * order sim_step() would have: the head's field taken, then the tail's freed.
+ * A game's fields are updated in one go instead of one move per tick, so the
+ * parts of its set a tick needs are still in cache from the previous one.
+ */
+static void apply_pending(SimBatch *b, int g) {
+    SimContext *ctx = &b->games[g];
+    const int32_t *pending = b->pending + (size_t)SIM_BATCH_PENDING * 2 * g;
+    for (int k = 0; k < b->pending_moves[g]; k++) {
+        sim_update_free(ctx, pending[2 * k], Empty, Snake);
+        sim_update_free(ctx, pending[2 * k + 1], Snake, Empty);
+    }
+    b->pending_moves[g] = 0;
+}
+
+/* Copies per game arrays of game g into its context */
+static void store_game(SimBatch *b, int g) {
+    SimContext *ctx = &b->games[g];
+    apply_pending(b, g);
+    ctx->hx = b->hx[g];
+    ctx->hy = b->hy[g];
+    ctx->dhx = b->dhx[g];
+    ctx->dhy = b->dhy[g];
+    ctx->fx = b->fx[g];
+    ctx->fy = b->fy[g];
+    ctx->expand_counter = b->expand_counter[g];
+    ctx->tick = b->tick[g];
+    ctx->alive = b->alive[g];
+}
+
+/* Takes state of game g back from its context after it was changed there */
+static void load_game(SimBatch *b, int g) {
+    const SimContext *ctx = &b->games[g];
+    b->hx[g] = ctx->hx;
+    b->hy[g] = ctx->hy;
+    b->dhx[g] = ctx->dhx;
+    b->dhy[g] = ctx->dhy;
+    b->fx[g] = ctx->fx;
+    b->fy[g] = ctx->fy;
+    b->expand_counter[g] = ctx->expand_counter;
+    b->tick[g] = ctx->tick;
+    b->alive[g] = ctx->alive;
+    pack_grid(b, g);
+}
+
+/* Starts a new game g, as sim_reset() */
+bool sim_batch_reset(SimBatch *b, int g, uint64_t seed) {
+    b->pending_moves[g] = 0; /* the whole board is cleared */
+    bool ok = sim_reset(&b->games[g], seed);
+    load_game(b, g);
+    return ok;
+}
+
+/*
+ * Brings the context of game g up to date, e.g. to render or check it.
+ * Every tick keeps board, bitboard, body and journal of games[g] as
+ * sim_step() does, and its tick. Head and direction (the per game arrays of the
+ * batch) are copied only here, and the pending moves applied to the empty
+ * fields, so in between these are stale there.
+ * Undo is never recorded for batched games.
+ */
+const SimContext* sim_batch_sync(SimBatch *b, int g) {
+    store_game(b, g);
+    return &b->games[g];
+}
+
+/*
+ * Planning: new direction after the input (as apply_input()), and whether the
+ * head just moves into an empty field without growing. Everything else - out
+ * of the board, into snake or wall, into food, growing - is left to sim_step().
+ * The bitboard is looked at afterwards, for PlanMove only. Plans games from g0 on.
+ */
+static void plan_scalar(SimBatch *b, const SimInput *inputs, int g0) {
+    for (int g = g0; g < b->n; g++) {
+        int in = inputs[g];
+        int dx = (in == SimInputRight) - (in == SimInputLeft);
+        int dy = (in == SimInputDown) - (in == SimInputUp);
+        bool valid = (dx && b->dhx[g] == 0) || (dy && b->dhy[g] == 0);
+        dx = valid ? dx : b->dhx[g];
+        dy = valid ? dy : b->dhy[g];
+        int nx = b->hx[g] + dx, ny = b->hy[g] + dy;
+        bool inside = (unsigned)nx < (unsigned)b->w && (unsigned)ny < (unsigned)b->h;
+        bool food = nx == b->fx[g] && ny == b->fy[g];
+        b->plan_dx[g] = dx;
+        b->plan_dy[g] = dy;
+        b->plan[g] = !b->alive[g] ? PlanNone :
+                     inside && !food && b->expand_counter[g] == 0 ? PlanMove : PlanStep;
+    }
+}
+
+#ifdef __SSE2__
+/* plan_scalar() for 4 games at a time, returns the first game left over */
+static int plan_sse2(SimBatch *b, const SimInput *inputs) {
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    const __m128i w = _mm_set1_epi32(b->w), h = _mm_set1_epi32(b->h), below = _mm_set1_epi32(-1);
+    int g = 0;
+    for (; g + 4 <= b->n; g += 4) {
+        int32_t in32[4];
+        uint32_t alive4;
+        for (int k = 0; k < 4; k++) in32[k] = inputs[g + k];
+        memcpy(&alive4, b->alive + g, 4);
+        __m128i in = _mm_loadu_si128((const __m128i *)in32);
+        __m128i left = _mm_cmpeq_epi32(in, _mm_set1_epi32(SimInputLeft));
+        __m128i right = _mm_cmpeq_epi32(in, _mm_set1_epi32(SimInputRight));
+        __m128i up = _mm_cmpeq_epi32(in, _mm_set1_epi32(SimInputUp));
+        __m128i down = _mm_cmpeq_epi32(in, _mm_set1_epi32(SimInputDown));
+        __m128i dhx = _mm_loadu_si128((const __m128i *)(b->dhx + g));
+        __m128i dhy = _mm_loadu_si128((const __m128i *)(b->dhy + g));
+        /* a turn is valid across the current direction only */
+        __m128i valid = _mm_or_si128(_mm_and_si128(_mm_or_si128(left, right), _mm_cmpeq_epi32(dhx, zero)),
+                                     _mm_and_si128(_mm_or_si128(up, down), _mm_cmpeq_epi32(dhy, zero)));
+        __m128i dx = _mm_or_si128(_mm_and_si128(valid, _mm_sub_epi32(left, right)), _mm_andnot_si128(valid, dhx));
+        __m128i dy = _mm_or_si128(_mm_and_si128(valid, _mm_sub_epi32(up, down)), _mm_andnot_si128(valid, dhy));
+        __m128i nx = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(b->hx + g)), dx);
+        __m128i ny = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(b->hy + g)), dy);
+        __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(nx, below), _mm_cmplt_epi32(nx, w)),
+                                       _mm_and_si128(_mm_cmpgt_epi32(ny, below), _mm_cmplt_epi32(ny, h)));
+        __m128i food = _mm_and_si128(_mm_cmpeq_epi32(nx, _mm_loadu_si128((const __m128i *)(b->fx + g))),
+                                     _mm_cmpeq_epi32(ny, _mm_loadu_si128((const __m128i *)(b->fy + g))));
+        __m128i still = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(b->expand_counter + g)), zero);
+        __m128i move = _mm_andnot_si128(food, _mm_and_si128(inside, still));
+        /* alive bytes widened to lanes, then PlanMove or PlanStep where alive */
+        __m128i alive = _mm_cvtsi32_si128((int)alive4);
+        alive = _mm_unpacklo_epi16(_mm_unpacklo_epi8(alive, zero), zero);
+        __m128i dead = _mm_cmpeq_epi32(alive, zero);
+        __m128i plan = _mm_andnot_si128(dead, _mm_sub_epi32(two, _mm_and_si128(move, one)));
+        _mm_storeu_si128((__m128i *)(b->plan_dx + g), dx);
+        _mm_storeu_si128((__m128i *)(b->plan_dy + g), dy);
+        uint32_t plan4 = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(plan, zero), zero));
+        memcpy(b->plan + g, &plan4, 4);
+    }
+    return g;
+}
+#endif
+
+/*
+ * Plans all games, 4 at a time where SSE2 is there, then checks the field
+ * every PlanMove goes to in the shared bitboard block. The loads of all
+ * games are independent, so they overlap instead of waiting for each other.
+ */
+static void plan_moves(SimBatch *b, const SimInput *inputs) {
+    int g = 0;
+#ifdef __SSE2__
+    g = plan_sse2(b, inputs);
+#endif
+    plan_scalar(b, inputs, g);
+
+    const int stride = (b->w + 63) / 64;
+    for (g = 0; g < b->n; g++) {
+        if (b->plan[g] != PlanMove) continue;
+        int nx = b->hx[g] + b->plan_dx[g], ny = b->hy[g] + b->plan_dy[g];
+        if ((b->blocked[(size_t)b->bb_words * g + stride * ny + nx / 64] >> (nx % 64)) & 1) b->plan[g] = PlanStep;
+    }
+}
+
+/*
+ * Head of game g moves one field to an empty one, the tail follows - as in
+ * sim_step(). The set of empty fields is updated later, see apply_pending().
+ */
+static void move_snake(SimBatch *b, int g) {
+    SimContext *ctx = &b->games[g];
+    int dx = b->plan_dx[g], dy = b->plan_dy[g];
+    int x = b->hx[g] + dx, y = b->hy[g] + dy;
+    int i = b->w * y + x;
+    uint64_t *grid = b->grid + (size_t)b->grid_words * g;
+
+    /* the same two changes as in sim_step(), the food is not touched;
+       the tick goes first, the journal records it with both */
+    ctx->tick = ++b->tick[g];
+    sim_set_board_field(ctx, x, y, make_field(Snake, 0, -dx, -dy));
+    grid[i / 64] |= (uint64_t)1 << (i % 64);
+    if (++ctx->body_head == ctx->body_cap) ctx->body_head = 0;
+    ctx->body[ctx->body_head].x = x;
+    ctx->body[ctx->body_head].y = y;
+
+    SimSegment *tail = sim_segment(ctx, ctx->length);
+    int t = ctx->w * tail->y + tail->x;
+    sim_set_board_field(ctx, tail->x, tail->y, make_field(Empty, 0, 0, 0));
+    grid[t / 64] &= ~((uint64_t)1 << (t % 64));
+
+    int32_t *pending = b->pending + (size_t)SIM_BATCH_PENDING * 2 * g + 2 * b->pending_moves[g];
+    pending[0] = i;
+    pending[1] = t;
+    if (++b->pending_moves[g] == SIM_BATCH_PENDING) apply_pending(b, g);
+
+    b->hx[g] = x;
+    b->hy[g] = y;
+    b->dhx[g] = dx;
+    b->dhy[g] = dy;
+}
+
+/*
+ * Advances every game by one tick, game g getting inputs[g]. Dead games stay
+ * as they are until sim_batch_reset(). Returns number of games that died.
+ */
+int sim_batch_step(SimBatch *b, const SimInput *inputs) {
+    plan_moves(b, inputs);
+
+    int died = 0;
+    for (int g = 0; g < b->n; g++) {
+        if (b->plan[g] == PlanMove) {
+            move_snake(b, g);
+            b->moves++;
+        }
+        else if (b->plan[g] == PlanStep) {
+            store_game(b, g);
+            sim_step(&b->games[g], inputs[g], NULL);
+            load_game(b, g);
+            died += !b->alive[g];
+            b->slow_steps++;
+        }
+    }
+    return died;
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+#include <time.h>
+#include "sim_clock.h"
+
+void sim_clock_init(SimClock *c, double step_ms, double max_lag_ms) {
+    memset(c, 0, sizeof(*c));
+    c->step_ms = step_ms;
+    c->max_lag_ms = max_lag_ms < step_ms ? step_ms : max_lag_ms;
+}
+
+static int late_bucket(double late_ms) {
+    int b = 0;
+    for (double limit = 0.1; late_ms >= limit && b < SIM_CLOCK_LATE_BUCKETS - 1; limit *= 2.0) b++;
+    return b;
+}
+
+static void count_step(SimClock *c, double late_ms) {
+    if (c->steps > 0) {
+        double jitter = late_ms > c->last_late_ms ? late_ms - c->last_late_ms : c->last_late_ms - late_ms;
+        c->jitter_sum_ms += jitter;
+        if (jitter > c->jitter_max_ms) c->jitter_max_ms = jitter;
+    }
+    c->last_late_ms = late_ms;
+    c->late_sum_ms += late_ms;
+    if (late_ms > c->late_max_ms) c->late_max_ms = late_ms;
+    c->late_hist[late_bucket(late_ms)]++;
+    c->steps++;
+}
+
+/*
+ * Adds elapsed_ms of real time, returns the number of steps now due. All of
+ * them are handed out at once, so a late frame catches up in one go.
+ */
+int sim_clock_advance(SimClock *c, double elapsed_ms) {
+    if (elapsed_ms > 0.0) c->lag_ms += elapsed_ms;
+    if (c->lag_ms > c->max_lag_ms) {
+        c->skipped_ms += c->lag_ms - c->max_lag_ms;
+        c->lag_ms = c->max_lag_ms;
+    }
+    int steps = (int)(c->lag_ms / c->step_ms);
+    c->lag_ms -= steps * c->step_ms;
+    if (c->lag_ms >= c->step_ms) { /* rounding */
+        c->lag_ms -= c->step_ms;
+        steps++;
+    }
+    /* the last step was due lag_ms ago, each one before a step earlier */
+    for (int i = steps - 1; i >= 0; i--) count_step(c, c->lag_ms + i * c->step_ms);
+    if (steps > 1) c->bursts++;
+    return steps;
+}
+
+/* Part of the current step gone by, 0 to below 1 */
+double sim_clock_alpha(const SimClock *c) {
+    return c->lag_ms / c->step_ms;
+}
+
+/*
+ * Phase of the tick to be drawn (0 - the snake left its previous fields,
+ * 1 - it reached its fields) with ticks at every steps_per_tick steps, the
+ * step counter at step and alpha of the current step gone by. A tick comes
+ * with each step leaving a multiple of steps_per_tick, so the snake reaches
+ * its fields exactly when the next tick moves it on.
+ */
+float sim_clock_tick_phase(uint32_t step, int steps_per_tick, double alpha) {
+    int since_tick = (int)((step + (uint32_t)steps_per_tick - 1) % (uint32_t)steps_per_tick);
+    return (float)((since_tick + alpha) / steps_per_tick);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/*
+ * Waits ms. Sleeping wakes up late by up to some tenths of a millisecond
+ * (more under load), so the last spin_ms are spent spinning instead.
+ */
+void sim_sleep_precise(double ms, double spin_ms) {
+    double end = now_ms() + ms;
+    double left = ms;
+    while (left > spin_ms) {
+        long long ns = (long long)((left - spin_ms) * 1e6);
+        struct timespec ts = { (time_t)(ns / 1000000000), (long)(ns % 1000000000) };
+        nanosleep(&ts, NULL);
+        left = end - now_ms();
+    }
+    while (now_ms() < end) {
+    }
+}
@@ -0,0 +1,82 @@
+#include <string.h>
+#include "sim_input_queue.h"
+
+/* Turn is a right angle to direction (dhx, dhy) */
+static bool is_turn(SimInput input, int dhx, int dhy) {
+    switch (input) {
+        case SimInputLeft:
+        case SimInputRight:
+            return dhx == 0;
+        case SimInputUp:
+        case SimInputDown:
+            return dhy == 0;
+        default:
+            return false;
+    }
+}
+
+static void turn(SimInput input, int *dhx, int *dhy) {
+    *dhx = (input == SimInputRight) - (input == SimInputLeft);
+    *dhy = (input == SimInputDown) - (input == SimInputUp);
+}
+
+/* Empty queue holding up to depth turns, clamped to 1..SIM_INPUT_QUEUE_MAX */
+void sim_input_queue_init(SimInputQueue *q, int depth) {
+    memset(q, 0, sizeof(*q));
+    q->depth = depth < 1 ? 1 : (depth > SIM_INPUT_QUEUE_MAX ? SIM_INPUT_QUEUE_MAX : depth);
+}
+
+/* Forgets queued turns, e.g. when a new game starts, statistics stay */
+void sim_input_queue_clear(SimInputQueue *q) {
+    q->first = q->count = 0;
+}
+
+/*
+ * Queues input given at stamp, the snake moving in direction (dhx, dhy) now.
+ * Returns false if it is not a turn after the queued ones or the queue is full.
+ */
+bool sim_input_queue_push(SimInputQueue *q, SimInput input, int dhx, int dhy, uint64_t stamp) {
+    if (q->count > 0) {
+        turn(q->input[(q->first + q->count - 1) % SIM_INPUT_QUEUE_MAX], &dhx, &dhy);
+    }
+    if (!is_turn(input, dhx, dhy)) return false;
+    if (q->count == q->depth) {
+        q->dropped++;
+        return false;
+    }
+    int i = (q->first + q->count++) % SIM_INPUT_QUEUE_MAX;
+    q->input[i] = input;
+    q->stamp[i] = stamp;
+    return true;
+}
+
+static int wait_bucket(uint64_t wait) {
+    int b = 0;
+    while (wait > 0 && b < SIM_INPUT_WAIT_BUCKETS - 1) {
+        wait >>= 1;
+        b++;
+    }
+    return b;
+}
+
+/*
+ * Takes the turn for the tick at now, the snake moving in direction (dhx, dhy).
+ * Turns that stopped being valid (the direction was changed otherwise) are
+ * skipped. Returns SimInputNone if there is none.
+ */
+SimInput sim_input_queue_take(SimInputQueue *q, int dhx, int dhy, uint64_t now) {
+    while (q->count > 0) {
+        SimInput input = q->input[q->first];
+        uint64_t stamp = q->stamp[q->first];
+        q->first = (q->first + 1) % SIM_INPUT_QUEUE_MAX;
+        q->count--;
+        if (!is_turn(input, dhx, dhy)) continue;
+        uint64_t wait = now > stamp ? now - stamp : 0;
+        q->taken++;
+        q->wait_sum += wait;
+        if (wait > q->wait_max) q->wait_max = wait;
+        q->wait_hist[wait_bucket(wait)]++;
+        return input;
+    }
+    return SimInputNone;
+}
@@ -0,0 +1,440 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim_reach.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+ * Flood fill works on whole 64-bit words of the bitboard. Each row step pulls
+ * reach from the neighbouring row, then spreads it along runs of passable
+ * fields with a Kogge-Stone occluded fill (6 shift rounds per direction).
+ * Runs crossing word boundaries are finished by a scalar carry pass. The
+ * board is swept top-down and bottom-up until nothing new is reached, or
+ * SIM_FLOOD_MAX_SWEEPS times; a serpentine of corridors would take a sweep
+ * for every two of them, so from there a scanline fill takes over.
+ */
+
+#define FLOOD_PROBE_ROWS (64) /* rows stepped by each kernel to time it */
+#define FLOOD_PROBE_REPS (5) /* timings of each kernel, the best one counts */
+
+typedef bool (*RowStep)(uint64_t *row, const uint64_t *adj, const uint64_t *blk, int n);
+
+/* Spreads reach r over passable fields within a single word, both directions */
+static inline uint64_t fill_word(uint64_t r, uint64_t pass) {
+    uint64_t gl = r, pl = pass, gr = r, pr = pass;
+    for (int s = 1; s < 64; s *= 2) {
+        gl |= pl & (gl << s);
+        gr |= pr & (gr >> s);
+        pl &= pl << s;
+        pr &= pr >> s;
+    }
+    return gl | gr;
+}
+
+/* Lets reach spread over word boundaries within a row */
+static bool carry_words(uint64_t *row, const uint64_t *blk, int n) {
+    uint64_t diff = 0;
+    for (int i = 1; i < n; i++) { /* towards higher x */
+        if ((row[i - 1] >> 63) & ~row[i] & ~blk[i] & 1) {
+            uint64_t r = fill_word(row[i] | 1, ~blk[i]);
+            diff |= r ^ row[i];
+            row[i] = r;
+        }
+    }
+    for (int i = n - 2; i >= 0; i--) { /* towards lower x */
+        if (row[i + 1] & (~row[i] >> 63) & (~blk[i] >> 63) & 1) {
+            uint64_t r = fill_word(row[i] | (uint64_t)1 << 63, ~blk[i]);
+            diff |= r ^ row[i];
+            row[i] = r;
+        }
+    }
+    return diff != 0;
+}
+
+static bool row_step_scalar(uint64_t *row, const uint64_t *adj, const uint64_t *blk, int n) {
+    uint64_t diff = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t pass = ~blk[i];
+        uint64_t r = fill_word(row[i] | (adj[i] & pass), pass);
+        diff |= r ^ row[i];
+        row[i] = r;
+    }
+    if (n > 1 && diff) diff |= carry_words(row, blk, n);
+    return diff != 0;
+}
+
+#ifdef __SSE2__
+static bool row_step_sse2(uint64_t *row, const uint64_t *adj, const uint64_t *blk, int n) {
+    __m128i diff = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi32(-1);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i old = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i pass = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(blk + i)), ones);
+        __m128i a = _mm_loadu_si128((const __m128i *)(adj + i));
+        __m128i gl = _mm_or_si128(old, _mm_and_si128(a, pass));
+        __m128i gr = gl, pl = pass, pr = pass;
+        for (int s = 1; s < 64; s *= 2) {
+            __m128i cnt = _mm_cvtsi32_si128(s);
+            gl = _mm_or_si128(gl, _mm_and_si128(pl, _mm_sll_epi64(gl, cnt)));
+            gr = _mm_or_si128(gr, _mm_and_si128(pr, _mm_srl_epi64(gr, cnt)));
+            pl = _mm_and_si128(pl, _mm_sll_epi64(pl, cnt));
+            pr = _mm_and_si128(pr, _mm_srl_epi64(pr, cnt));
+        }
+        __m128i r = _mm_or_si128(gl, gr);
+        diff = _mm_or_si128(diff, _mm_xor_si128(r, old));
+        _mm_storeu_si128((__m128i *)(row + i), r);
+    }
+    bool changed = _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF;
+    for (; i < n; i++) {
+        uint64_t pass = ~blk[i];
+        uint64_t r = fill_word(row[i] | (adj[i] & pass), pass);
+        changed |= r != row[i];
+        row[i] = r;
+    }
+    if (n > 1 && changed) carry_words(row, blk, n);
+    return changed;
+}
+#endif
+
+#ifdef __AVX2__
+static bool row_step_avx2(uint64_t *row, const uint64_t *adj, const uint64_t *blk, int n) {
+    __m256i diff = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi32(-1);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i old = _mm256_loadu_si256((const __m256i *)(row + i));
+        __m256i pass = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(blk + i)), ones);
+        __m256i a = _mm256_loadu_si256((const __m256i *)(adj + i));
+        __m256i gl = _mm256_or_si256(old, _mm256_and_si256(a, pass));
+        __m256i gr = gl, pl = pass, pr = pass;
+        for (int s = 1; s < 64; s *= 2) {
+            __m128i cnt = _mm_cvtsi32_si128(s);
+            gl = _mm256_or_si256(gl, _mm256_and_si256(pl, _mm256_sll_epi64(gl, cnt)));
+            gr = _mm256_or_si256(gr, _mm256_and_si256(pr, _mm256_srl_epi64(gr, cnt)));
+            pl = _mm256_and_si256(pl, _mm256_sll_epi64(pl, cnt));
+            pr = _mm256_and_si256(pr, _mm256_srl_epi64(pr, cnt));
+        }
+        __m256i r = _mm256_or_si256(gl, gr);
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(r, old));
+        _mm256_storeu_si256((__m256i *)(row + i), r);
+    }
+    bool changed = !_mm256_testz_si256(diff, diff);
+    for (; i < n; i++) {
+        uint64_t pass = ~blk[i];
+        uint64_t r = fill_word(row[i] | (adj[i] & pass), pass);
+        changed |= r != row[i];
+        row[i] = r;
+    }
+    if (n > 1 && changed) carry_words(row, blk, n);
+    return changed;
+}
+#endif
+
+static RowStep row_step(SimFloodKernel kernel) {
+    switch (kernel) {
+#ifdef __AVX2__
+        case SimFloodAvx2: return row_step_avx2;
+#endif
+#ifdef __SSE2__
+        case SimFloodSse2: return row_step_sse2;
+#endif
+        default: return row_step_scalar;
+    }
+}
+
+/* Tells if the kernel was compiled in (see SIM_ARCH_FLAGS in the Makefile) */
+bool sim_flood_kernel_available(SimFloodKernel kernel) {
+    switch (kernel) {
+        case SimFloodScalar: return true;
+#ifdef __SSE2__
+        case SimFloodSse2: return true;
+#endif
+#ifdef __AVX2__
+        case SimFloodAvx2: return true;
+#endif
+        default: return false;
+    }
+}
+
+const char* sim_flood_kernel_name(SimFloodKernel kernel) {
+    switch (kernel) {
+        case SimFloodSse2: return "sse2";
+        case SimFloodAvx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Picks the kernel that is fastest for the board width on this machine.
+ * Wider is not always faster: the shifts of the occluded fill cost more per
+ * word on some CPUs than in scalar registers. Each kernel steps the reach
+ * down a band of up to FLOOD_PROBE_ROWS rows of a quarter blocked fields a
+ * few times, the best time counts. Leaves the bitboards dirty.
+ */
+static SimFloodKernel fastest_kernel(SimContext *ctx) {
+    int n = ctx->bb_stride;
+    if (n == 1) return SimFloodScalar; /* a single word per row leaves nothing to vectorize */
+    int rows = ctx->h < FLOOD_PROBE_ROWS ? ctx->h : FLOOD_PROBE_ROWS;
+    uint64_t r = 0x9E3779B97F4A7C15ULL; /* xorshift, any fixed pattern will do */
+    for (int i = 0; i < n * rows; i++) {
+        uint64_t a, b;
+        r ^= r << 13; r ^= r >> 7; r ^= r << 17; a = r;
+        r ^= r << 13; r ^= r >> 7; r ^= r << 17; b = r;
+        ctx->blocked[i] = a & b;
+    }
+    SimFloodKernel best = SimFloodScalar;
+    long long best_ns = -1;
+    for (int rep = 0; rep < FLOOD_PROBE_REPS; rep++) { /* interleaved, so load hits all alike */
+        for (SimFloodKernel k = SimFloodScalar; k <= SimFloodAvx2; k++) {
+            if (!sim_flood_kernel_available(k)) continue;
+            RowStep step = row_step(k);
+            /* the guard row above the band is all reached */
+            memset(ctx->reach, 0xFF, (size_t)n * sizeof(uint64_t));
+            memset(ctx->reach + n, 0, (size_t)n * rows * sizeof(uint64_t));
+            long long start = now_ns();
+            for (int y = 0; y < rows; y++) {
+                step(ctx->reach + n * (y + 1), ctx->reach + n * y, ctx->blocked + n * y, n);
+            }
+            long long ns = now_ns() - start;
+            if (best_ns < 0 || ns < best_ns) {
+                best = k;
+                best_ns = ns;
+            }
+        }
+    }
+    memset(ctx->reach, 0, (size_t)n * (rows + 1) * sizeof(uint64_t));
+    return best;
+}
+
+/*
+ * Allocates the bitboards for a board of ctx->w x ctx->h fields and selects
+ * the fastest available kernel. Returns false when out of memory.
+ */
+bool sim_reach_init(SimContext *ctx) {
+    ctx->bb_stride = (ctx->w + 63) / 64;
+    ctx->blocked = malloc((size_t)ctx->bb_stride * ctx->h * sizeof(uint64_t));
+    /* reach has an empty guard row above and below the board */
+    ctx->reach = calloc((size_t)ctx->bb_stride * (ctx->h + 2), sizeof(uint64_t));
+    ctx->fill_queue = malloc((size_t)ctx->w * ctx->h * sizeof(uint32_t));
+    if (ctx->blocked == NULL || ctx->reach == NULL || ctx->fill_queue == NULL) {
+        sim_reach_free(ctx);
+        return false;
+    }
+    ctx->flood_kernel = fastest_kernel(ctx);
+    sim_reach_clear(ctx);
+    return true;
+}
+
+void sim_reach_free(SimContext *ctx) {
+    free(ctx->blocked);
+    free(ctx->reach);
+    free(ctx->fill_queue);
+    ctx->blocked = NULL;
+    ctx->reach = NULL;
+    ctx->fill_queue = NULL;
+    ctx->bb_stride = 0;
+}
+
+/* Marks all fields passable, padding bits past the board edge stay blocked */
+void sim_reach_clear(SimContext *ctx) {
+    int n = ctx->bb_stride;
+    uint64_t pad = ctx->w % 64 ? ~(uint64_t)0 << (ctx->w % 64) : 0;
+    memset(ctx->blocked, 0, (size_t)n * ctx->h * sizeof(uint64_t));
+    for (int y = 0; y < ctx->h; y++) {
+        ctx->blocked[n * y + n - 1] = pad;
+    }
+}
+
+/* Bits lo..hi of a word */
+static inline uint64_t bit_range(int lo, int hi) {
+    return (~(uint64_t)0 << lo) & (~(uint64_t)0 >> (63 - hi));
+}
+
+/* Marks reached and pushes the first field of every stretch of open fields of row y from x0 to x1 */
+static void seed_row(uint64_t *reach, const uint64_t *blk, int n, int y, int x0, int x1,
+                     uint32_t *stack, int *top) {
+    uint64_t *r = reach + n * y;
+    const uint64_t *b = blk + n * y;
+    uint64_t carry = 0; /* the field left of the word is open */
+    for (int i = x0 / 64; i <= x1 / 64; i++) {
+        int lo = i == x0 / 64 ? x0 % 64 : 0, hi = i == x1 / 64 ? x1 % 64 : 63;
+        uint64_t open = ~(b[i] | r[i]) & bit_range(lo, hi);
+        uint64_t first = open & ~(open << 1 | carry);
+        carry = open >> 63;
+        r[i] |= first;
+        for (; first; first &= first - 1) {
+            stack[(*top)++] = (uint32_t)y << 16 | (uint32_t)(64 * i + __builtin_ctzll(first));
+        }
+    }
+}
+
+/* Marks reached and pushes the first field of every stretch of open fields of column x from y0 to y1 */
+static void seed_column(uint64_t *reach, const uint64_t *blk, int n, int x, int y0, int y1,
+                        uint32_t *stack, int *top) {
+    uint64_t *r = reach + x / 64;
+    const uint64_t *b = blk + x / 64;
+    uint64_t m = (uint64_t)1 << (x % 64);
+    bool stretch = false;
+    for (int y = y0; y <= y1; y++) {
+        bool open = !((b[n * y] | r[n * y]) & m);
+        if (open && !stretch) {
+            r[n * y] |= m;
+            stack[(*top)++] = (uint32_t)y << 16 | (uint32_t)x;
+        }
+        stretch = open;
+    }
+}
+
+/*
+ * Finishes a fill the sweeps gave up on, with a scanline fill: a seed is
+ * extended along its column, or along its row where the column gives
+ * nothing, and the fields beside that run get a seed per stretch of open
+ * ones. Rows are handled a word at a time. Seeds are marked reached when
+ * pushed, so at most w*h of them are ever stacked. Stops early once
+ * (tx,ty) is reached, unless tx is negative.
+ */
+static void fill_rest(SimContext *ctx, int tx, int ty) {
+    int n = ctx->bb_stride, w = ctx->w, h = ctx->h;
+    uint64_t *reach = ctx->reach + n; /* guard rows are empty */
+    const uint64_t *blk = ctx->blocked;
+    uint32_t *stack = ctx->fill_queue;
+    int top = 0;
+
+    /* the sweeps leave rows spread along their runs, so the fill goes on
+       from reached fields with an open one above or below */
+    for (int y = 0; y < h; y++) {
+        for (int i = 0; i < n; i++) {
+            uint64_t open = 0;
+            if (y > 0) open |= ~blk[n * (y - 1) + i] & ~reach[n * (y - 1) + i];
+            if (y < h - 1) open |= ~blk[n * (y + 1) + i] & ~reach[n * (y + 1) + i];
+            for (uint64_t edge = reach[n * y + i] & open; edge; edge &= edge - 1) {
+                stack[top++] = (uint32_t)y << 16 | (uint32_t)(64 * i + __builtin_ctzll(edge));
+            }
+        }
+    }
+    while (top > 0) {
+        uint32_t c = stack[--top];
+        int x0 = c & 0xFFFF, y0 = c >> 16, x1 = x0, y1 = y0;
+        uint64_t *col = reach + x0 / 64;
+        const uint64_t *bcol = blk + x0 / 64;
+        uint64_t m = (uint64_t)1 << (x0 % 64);
+        while (y0 > 0 && !((bcol[n * (y0 - 1)] | col[n * (y0 - 1)]) & m)) col[n * --y0] |= m;
+        while (y1 < h - 1 && !((bcol[n * (y1 + 1)] | col[n * (y1 + 1)]) & m)) col[n * ++y1] |= m;
+        if (y0 < y1 && x0 % 64 != 0 && x0 % 64 != 63) {
+            /* both sides in the word of the run, bits 0 and 2 of side */
+            int sh = x0 % 64 - 1;
+            uint64_t prev = 0;
+            for (int y = y0; y <= y1; y++) {
+                uint64_t side = ~(bcol[n * y] | col[n * y]) >> sh & 5;
+                uint64_t first = side & ~prev;
+                prev = side;
+                if (first) {
+                    col[n * y] |= first << sh;
+                    if (first & 1) stack[top++] = (uint32_t)y << 16 | (uint32_t)(x0 - 1);
+                    if (first & 4) stack[top++] = (uint32_t)y << 16 | (uint32_t)(x0 + 1);
+                }
+            }
+        }
+        else if (y0 < y1) {
+            if (x0 > 0) seed_column(reach, blk, n, x0 - 1, y0, y1, stack, &top);
+            if (x0 < w - 1) seed_column(reach, blk, n, x0 + 1, y0, y1, stack, &top);
+        }
+        else {
+            /* along the row, a word at a time: the seed counts as open */
+            uint64_t *row = reach + n * y0;
+            const uint64_t *brow = blk + n * y0;
+            int i = x0 / 64;
+            uint64_t stop = (brow[i] | row[i]) & ~(uint64_t)1 << (x0 % 64);
+            while (stop == 0 && i < n - 1) {
+                i++;
+                stop = brow[i] | row[i];
+            }
+            x1 = stop ? 64 * i + __builtin_ctzll(stop) - 1 : w - 1;
+            i = x0 / 64;
+            stop = (brow[i] | row[i]) & (m - 1);
+            while (stop == 0 && i > 0) {
+                i--;
+                stop = brow[i] | row[i];
+            }
+            x0 = stop ? 64 * i + 64 - __builtin_clzll(stop) : 0;
+            for (i = x0 / 64; i <= x1 / 64; i++) {
+                row[i] |= bit_range(i == x0 / 64 ? x0 % 64 : 0, i == x1 / 64 ? x1 % 64 : 63);
+            }
+            if (y0 > 0) seed_row(reach, blk, n, y0 - 1, x0, x1, stack, &top);
+            if (y0 < h - 1) seed_row(reach, blk, n, y0 + 1, x0, x1, stack, &top);
+        }
+        if (tx >= 0 && sim_reached(ctx, tx, ty)) return;
+    }
+}
+
+/* Fills from (x,y) as sim_flood_fill() does, stopping once (tx,ty) is reached if tx is not negative */
+static int flood(SimContext *ctx, int x, int y, int tx, int ty) {
+    int n = ctx->bb_stride, h = ctx->h;
+    RowStep step = row_step(ctx->flood_kernel);
+    uint64_t *reach = ctx->reach + n; /* row 0, skipping the guard row */
+    const uint64_t *blk = ctx->blocked;
+
+    memset(ctx->reach, 0, (size_t)n * (h + 2) * sizeof(uint64_t));
+    reach[n * y + x / 64] = (uint64_t)1 << (x % 64);
+
+    /* rows outside lo..hi are still empty, a sweep stops at the first row
+       past them that got nothing */
+    int lo = y, hi = y, sweeps = 0;
+    bool changed;
+    do {
+        changed = false;
+        for (int r = lo; r < h; r++) {
+            bool ch = step(reach + n * r, reach + n * (r - 1), blk + n * r, n);
+            changed |= ch;
+            if (r > hi) {
+                if (!ch) break;
+                hi = r;
+            }
+        }
+        for (int r = hi; r >= 0; r--) {
+            bool ch = step(reach + n * r, reach + n * (r + 1), blk + n * r, n);
+            changed |= ch;
+            if (r < lo) {
+                if (!ch) break;
+                lo = r;
+            }
+        }
+        sweeps++;
+        if (tx >= 0 && sim_reached(ctx, tx, ty)) return sweeps;
+    } while (changed && sweeps < SIM_FLOOD_MAX_SWEEPS);
+    if (changed) {
+        fill_rest(ctx, tx, ty);
+        sweeps++;
+    }
+    return sweeps;
+}
+
+/*
+ * Computes set of fields reachable from (x,y) into ctx->reach, query it with
+ * sim_reached(). The start field itself counts as reached even if blocked,
+ * so the fill can start from the snake's head.
+ * Returns number of sweeps it took, for benchmarking, one more than
+ * SIM_FLOOD_MAX_SWEEPS if the rest was filled by scanlines.
+ */
+int sim_flood_fill(SimContext *ctx, int x, int y) {
+    return flood(ctx, x, y, -1, -1);
+}
+
+/* Tells if (tx,ty) can be reached from (x,y), filling no further than needed */
+bool sim_reaches(SimContext *ctx, int x, int y, int tx, int ty) {
+    flood(ctx, x, y, tx, ty);
+    return sim_reached(ctx, tx, ty);
+}
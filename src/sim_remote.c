@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sim_remote.h"
+
+#define READ_CHUNK (65536) /* bytes received at once */
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+static bool fill_address(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return false;
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+/*
+ * Starts listening on socket file path, a stale file of that name is
+ * replaced. Returns false on failure, errno tells why.
+ */
+bool sim_remote_listen(SimRemote *r, const char *path) {
+    struct sockaddr_un addr;
+    memset(r, 0, sizeof(*r));
+    r->client_fd = -1;
+    r->listen_fd = -1;
+    if (!fill_address(&addr, path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    r->in = malloc(SIM_REMOTE_LINE_MAX);
+    r->path = malloc(strlen(path) + 1);
+    if (r->in == NULL || r->path == NULL) {
+        sim_remote_close(r);
+        errno = ENOMEM;
+        return false;
+    }
+    strcpy(r->path, path);
+    pcg32_srandom_r(&r->rng, (uint64_t)time(NULL), (uint64_t)getpid());
+
+    unlink(path);
+    r->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (r->listen_fd == -1 || bind(r->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+        listen(r->listen_fd, 1) == -1 || !set_nonblocking(r->listen_fd)) {
+        int err = errno;
+        sim_remote_close(r);
+        errno = err;
+        return false;
+    }
+    return true;
+}
+
+static void drop_client(SimRemote *r) {
+    if (r->client_fd != -1) close(r->client_fd);
+    r->client_fd = -1;
+    r->in_len = r->out_len = 0;
+    /* nobody steps the game any more, let it run on its own */
+    r->stepped = false;
+    r->input = SimInputNone;
+}
+
+void sim_remote_close(SimRemote *r) {
+    drop_client(r);
+    if (r->listen_fd != -1) close(r->listen_fd);
+    if (r->path) unlink(r->path);
+    free(r->path);
+    free(r->in);
+    free(r->out);
+    memset(r, 0, sizeof(*r));
+    r->listen_fd = r->client_fd = -1;
+}
+
+/* Appends formatted text to the replies. Returns false when out of memory. */
+static bool reply(SimRemote *r, const char *fmt, ...) {
+    for (;;) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(r->out + r->out_len, r->out_cap - r->out_len, fmt, args);
+        va_end(args);
+        if (n < 0) return false;
+        if ((size_t)n < r->out_cap - r->out_len) {
+            r->out_len += n;
+            return true;
+        }
+        size_t cap = r->out_cap ? r->out_cap * 2 : 4096;
+        while (cap - r->out_len <= (size_t)n) cap *= 2;
+        char *out = realloc(r->out, cap);
+        if (out == NULL) return false;
+        r->out = out;
+        r->out_cap = cap;
+    }
+}
+
+static bool reply_state(SimRemote *r, const SimContext *ctx) {
+    return reply(r, "state %u %d %d %d %d %d %d %d %d %d\n", ctx->tick, ctx->score, ctx->alive,
+                 ctx->hx, ctx->hy, ctx->dhx, ctx->dhy, ctx->fx, ctx->fy, ctx->length);
+}
+
+static bool reply_board(SimRemote *r, const SimContext *ctx) {
+    static const char marks[4] = { '.', 'o', '*', '#' }; /* by FieldType */
+    if (!reply(r, "board %d %d\n", ctx->w, ctx->h)) return false;
+    for (int y = 0; y < ctx->h; y++) {
+        if (!reply(r, "%*s\n", ctx->w, "")) return false;
+        char *row = r->out + r->out_len - ctx->w - 1;
+        for (int x = 0; x < ctx->w; x++) row[x] = marks[field_type(sim_field(ctx, x, y))];
+        if (y == ctx->hy && ctx->length > 0) row[ctx->hx] = '@';
+    }
+    return true;
+}
+
+static SimInput parse_input(char c) {
+    switch (c) {
+        case 'L': return SimInputLeft;
+        case 'R': return SimInputRight;
+        case 'U': return SimInputUp;
+        case 'D': return SimInputDown;
+        default: return SimInputNone;
+    }
+}
+
+/* Handles a single request line (without the newline). Returns false when out of memory. */
+static bool handle_request(SimRemote *r, char *line, const SimRemoteHost *host) {
+    const SimContext *ctx = host->ctx;
+    char *args = line + strcspn(line, " ");
+    if (*args) *args++ = '\0';
+    r->requests++;
+
+    if (strcmp(line, "state") == 0) {
+        return reply_state(r, ctx);
+    }
+    if (strcmp(line, "input") == 0) {
+        SimInput input = parse_input(args[0]);
+        if (input == SimInputNone) return reply(r, "error input must be L, R, U or D\n");
+        r->input = input;
+        return reply(r, "ok\n");
+    }
+    if (strcmp(line, "mode") == 0) {
+        if (strcmp(args, "stepped") == 0) r->stepped = true;
+        else if (strcmp(args, "realtime") == 0) r->stepped = false;
+        else return reply(r, "error mode must be realtime or stepped\n");
+        return reply(r, "ok\n");
+    }
+    if (strcmp(line, "step") == 0) {
+        char *inputs;
+        long k = strtol(args, &inputs, 10);
+        if (!r->stepped) return reply(r, "error not in stepped mode\n");
+        if (k < 1 || k > SIM_REMOTE_MAX_STEP) return reply(r, "error step takes 1 to %d ticks\n", SIM_REMOTE_MAX_STEP);
+        if (*inputs == ' ') inputs++;
+        size_t n = strlen(inputs);
+        SimInput pending = sim_remote_take_input(r);
+        for (long i = 0; i < k && ctx->alive; i++) {
+            SimInput input = (size_t)i < n ? parse_input(inputs[i]) : SimInputNone;
+            if (i == 0 && input == SimInputNone) input = pending;
+            host->step(host->self, input);
+            r->ticks_stepped++;
+        }
+        return reply_state(r, ctx);
+    }
+    if (strcmp(line, "reset") == 0) {
+        char *end;
+        uint64_t seed = strtoull(args, &end, 10);
+        if (end == args) seed = (uint64_t)pcg32_random_r(&r->rng) << 32 | pcg32_random_r(&r->rng);
+        r->input = SimInputNone;
+        host->reset(host->self, seed);
+        return reply_state(r, ctx);
+    }
+    if (strcmp(line, "board") == 0) {
+        return reply_board(r, ctx);
+    }
+    if (strcmp(line, "shutdown") == 0) {
+        r->shutdown = true;
+        return reply(r, "ok\n");
+    }
+    return reply(r, "error unknown request '%s'\n", line);
+}
+
+/* Sends as much of the replies as the socket takes without blocking */
+static bool flush_replies(SimRemote *r) {
+    size_t sent = 0;
+    while (sent < r->out_len) {
+        ssize_t n = send(r->client_fd, r->out + sent, r->out_len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += n;
+    }
+    memmove(r->out, r->out + sent, r->out_len - sent);
+    r->out_len -= sent;
+    return true;
+}
+
+/* Receives what is there and handles every complete request. Returns false if the client is gone. */
+static bool receive_requests(SimRemote *r, const SimRemoteHost *host, int *handled) {
+    for (;;) {
+        size_t room = SIM_REMOTE_LINE_MAX - r->in_len;
+        ssize_t n = recv(r->client_fd, r->in + r->in_len, room < READ_CHUNK ? room : READ_CHUNK, 0);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        size_t start = 0, end = r->in_len + n;
+        for (size_t i = r->in_len; i < end; i++) {
+            if (r->in[i] != '\n') continue;
+            r->in[i] = '\0';
+            if (i > start && r->in[i - 1] == '\r') r->in[i - 1] = '\0';
+            if (strcmp(r->in + start, "quit") == 0) return false;
+            if (!handle_request(r, r->in + start, host)) return false;
+            (*handled)++;
+            start = i + 1;
+        }
+        memmove(r->in, r->in + start, end - start);
+        r->in_len = end - start;
+        if (r->in_len == SIM_REMOTE_LINE_MAX) return false; /* no newline in sight */
+        if (r->shutdown) return true;
+    }
+}
+
+/*
+ * Accepts a client, handles its requests and sends replies, waiting at most
+ * timeout_ms (-1 = no limit) for something to happen.
+ * Returns number of requests handled, -1 on failure of the socket.
+ */
+int sim_remote_poll(SimRemote *r, const SimRemoteHost *host, int timeout_ms) {
+    struct pollfd pfd;
+    if (r->client_fd == -1) {
+        pfd.fd = r->listen_fd;
+        pfd.events = POLLIN;
+    }
+    else {
+        pfd.fd = r->client_fd;
+        pfd.events = POLLIN | (r->out_len ? POLLOUT : 0);
+    }
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready < 0) return errno == EINTR ? 0 : -1;
+    if (ready == 0) return 0;
+
+    if (r->client_fd == -1) {
+        int fd = accept(r->listen_fd, NULL, NULL);
+        if (fd == -1) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+        if (!set_nonblocking(fd)) {
+            close(fd);
+            return 0;
+        }
+        r->client_fd = fd;
+        pfd.revents = POLLIN; /* requests may be there already */
+    }
+
+    int handled = 0;
+    if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (!receive_requests(r, host, &handled)) {
+            flush_replies(r);
+            drop_client(r);
+            return handled;
+        }
+    }
+    if (r->out_len && !flush_replies(r)) drop_client(r);
+    return handled;
+}
+
+/* Input the client asked for, once - for the next tick of the game's own clock */
+SimInput sim_remote_take_input(SimRemote *r) {
+    SimInput input = r->input;
+    r->input = SimInputNone;
+    return input;
+}
+
+static void plain_step(void *self, SimInput input) {
+    sim_step(self, input, NULL);
+}
+
+static void plain_reset(void *self, uint64_t seed) {
+    sim_reset(self, seed);
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Serves the game in ctx without any front end, until a client asks to shut
+ * down. In realtime mode the game advances every tick_ms.
+ * Returns 0, or -1 on failure of the socket.
+ */
+int sim_remote_serve(SimRemote *r, SimContext *ctx, int tick_ms) {
+    SimRemoteHost host = { plain_step, plain_reset, ctx, ctx };
+    long long next_tick = now_ms() + tick_ms;
+    while (!r->shutdown) {
+        int timeout = -1;
+        if (!r->stepped && ctx->alive) {
+            long long wait = next_tick - now_ms();
+            timeout = wait > 0 ? (int)wait : 0;
+        }
+        if (sim_remote_poll(r, &host, timeout) < 0) return -1;
+        if (r->stepped || !ctx->alive) {
+            next_tick = now_ms() + tick_ms;
+        }
+        else if (now_ms() >= next_tick) {
+            sim_step(ctx, sim_remote_take_input(r), NULL);
+            next_tick += tick_ms;
+        }
+    }
+    return 0;
+}
+
+/* Connects to a server at socket file path. Returns the socket, -1 on failure. */
+int sim_remote_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (!fill_address(&addr, path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
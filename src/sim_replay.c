@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_replay.h"
+
+#define REPLAY_MAGIC "VONSHRPL"
+#define REPLAY_MAGIC_LEN (8)
+#define REPLAY_INPUTS (5) /* SimInputNone (end mark) .. SimInputDown */
+#define REPLAY_HEADER_MAX (REPLAY_MAGIC_LEN + 1 + 4 * 10) /* magic, version, 4 varints */
+#define VARINT_MAX (10) /* bytes of the longest 64-bit varint */
+
+/* Appends v as LEB128 varint to buf, returns number of bytes written */
+static size_t put_varint(uint8_t *buf, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Reads varint from buf[*pos..size), returns false if it is cut off or too long */
+static bool get_varint(const uint8_t *buf, size_t size, size_t *pos, uint64_t *v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *pos < size; shift += 7) {
+        uint8_t b = buf[(*pos)++];
+        result |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool append_varint(SimReplay *r, uint64_t v) {
+    if (r->size + VARINT_MAX > r->cap) {
+        size_t cap = r->cap ? 2 * r->cap : 256;
+        uint8_t *data = realloc(r->data, cap);
+        if (data == NULL) return false;
+        r->data = data;
+        r->cap = cap;
+    }
+    r->size += put_varint(r->data + r->size, v);
+    return true;
+}
+
+/* Starts a new recording, keeps the buffer of a previous one */
+void sim_replay_start(SimReplay *r, int w, int h, uint64_t seed, uint32_t ground_seed) {
+    r->w = w;
+    r->h = h;
+    r->seed = seed;
+    r->ground_seed = ground_seed;
+    r->ticks = 0;
+    r->score = 0;
+    r->finished = false;
+    r->size = 0;
+    r->last_tick = 0;
+    sim_replay_rewind(r);
+}
+
+/*
+ * Records input given to sim_step() while ctx->tick was tick. Inputs have to
+ * be recorded in order of ticks. Returns false when out of memory.
+ */
+bool sim_replay_record(SimReplay *r, uint32_t tick, SimInput input) {
+    if (input == SimInputNone || r->finished) return true;
+    uint64_t gap = tick - r->last_tick;
+    r->last_tick = tick;
+    return append_varint(r, gap * REPLAY_INPUTS + input);
+}
+
+/* Drops recorded inputs of ticks from tick on, as after the game was rewound to tick */
+void sim_replay_truncate(SimReplay *r, uint32_t tick) {
+    if (r->finished || r->last_tick < tick) return;
+    size_t pos = 0, keep = 0;
+    uint64_t t = 0, kept_tick = 0, v;
+    while (get_varint(r->data, r->size, &pos, &v)) {
+        t += v / REPLAY_INPUTS;
+        if (t >= tick) break;
+        keep = pos;
+        kept_tick = t;
+    }
+    r->size = keep;
+    r->last_tick = (uint32_t)kept_tick;
+}
+
+/* Writes the end mark, ticks is the length of the game. Returns false when out of memory. */
+bool sim_replay_finish(SimReplay *r, uint32_t ticks, int score) {
+    if (r->finished) return true;
+    if (!append_varint(r, (uint64_t)(ticks - r->last_tick) * REPLAY_INPUTS) ||
+        !append_varint(r, (uint64_t)score)) {
+        return false;
+    }
+    r->ticks = ticks;
+    r->score = score;
+    r->finished = true;
+    sim_replay_rewind(r);
+    return true;
+}
+
+/* Writes finished replay to file. Returns false on failure, errno tells why. */
+bool sim_replay_save(const SimReplay *r, const char *path) {
+    uint8_t header[REPLAY_HEADER_MAX];
+    size_t n = REPLAY_MAGIC_LEN;
+    memcpy(header, REPLAY_MAGIC, REPLAY_MAGIC_LEN);
+    header[n++] = SIM_REPLAY_VERSION;
+    n += put_varint(header + n, (uint64_t)r->w);
+    n += put_varint(header + n, (uint64_t)r->h);
+    n += put_varint(header + n, r->seed);
+    n += put_varint(header + n, r->ground_seed);
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return false;
+    bool ok = fwrite(header, 1, n, f) == n && fwrite(r->data, 1, r->size, f) == r->size;
+    return fclose(f) == 0 && ok;
+}
+
+/* Reads next input and its tick, after the end mark there are no more inputs */
+static bool read_next(SimReplay *r) {
+    uint64_t v;
+    if (!get_varint(r->data, r->size, &r->pos, &v)) return false;
+    uint64_t tick = r->last_tick + v / REPLAY_INPUTS;
+    if (tick > UINT32_MAX) return false;
+    r->last_tick = r->next_tick = (uint32_t)tick;
+    r->next_input = (SimInput)(v % REPLAY_INPUTS);
+    return true;
+}
+
+/* Goes back to the first input for playback */
+void sim_replay_rewind(SimReplay *r) {
+    r->pos = 0;
+    r->last_tick = 0;
+    r->next_tick = 0;
+    r->next_input = SimInputNone;
+    if (r->finished) read_next(r);
+}
+
+/*
+ * Loads replay from file, replacing content of r (which has to be zeroed or
+ * used before). Returns false if the file cannot be read or is not a valid
+ * finished replay.
+ */
+bool sim_replay_load(SimReplay *r, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+    uint8_t *buf = NULL;
+    size_t size = 0, cap = 0, got;
+    bool ok = true;
+    do {
+        if (size == cap) {
+            cap = cap ? 2 * cap : 4096;
+            uint8_t *b = realloc(buf, cap);
+            if (b == NULL) {
+                ok = false;
+                break;
+            }
+            buf = b;
+        }
+        got = fread(buf + size, 1, cap - size, f);
+        size += got;
+    } while (got > 0);
+    ok = ok && !ferror(f);
+    fclose(f);
+
+    size_t pos = REPLAY_MAGIC_LEN + 1;
+    uint64_t w, h, seed, ground_seed;
+    ok = ok && size > pos && memcmp(buf, REPLAY_MAGIC, REPLAY_MAGIC_LEN) == 0 &&
+         buf[REPLAY_MAGIC_LEN] == SIM_REPLAY_VERSION &&
+         get_varint(buf, size, &pos, &w) && get_varint(buf, size, &pos, &h) &&
+         get_varint(buf, size, &pos, &seed) && get_varint(buf, size, &pos, &ground_seed) &&
+         w <= SIM_MAX_SIDE && h <= SIM_MAX_SIDE && sim_board_size_is_valid((int64_t)w, (int64_t)h) &&
+         ground_seed <= UINT32_MAX;
+    if (!ok) {
+        free(buf);
+        return false;
+    }
+
+    free(r->data);
+    r->w = (int)w;
+    r->h = (int)h;
+    r->seed = seed;
+    r->ground_seed = (uint32_t)ground_seed;
+    r->size = size - pos;
+    r->cap = size;
+    r->data = buf;
+    memmove(r->data, buf + pos, r->size);
+
+    /* walk the inputs up to the end mark, which has the game length and score */
+    uint64_t score = 0;
+    r->pos = 0;
+    r->last_tick = 0;
+    do {
+        ok = read_next(r);
+    } while (ok && r->next_input != SimInputNone);
+    ok = ok && get_varint(r->data, r->size, &r->pos, &score) && score <= INT32_MAX;
+    r->ticks = r->next_tick;
+    r->score = (int)score;
+    r->finished = ok;
+    sim_replay_rewind(r);
+    return ok;
+}
+
+/*
+ * Input to be given to sim_step() while ctx->tick is tick. Has to be asked for
+ * every tick in order, as the replay is read sequentially.
+ */
+SimInput sim_replay_input(SimReplay *r, uint32_t tick) {
+    if (r->next_input == SimInputNone || tick < r->next_tick) return SimInputNone;
+    SimInput input = r->next_input;
+    if (!read_next(r)) r->next_input = SimInputNone;
+    return input;
+}
+
+/*
+ * Plays the whole replay on ctx (sim_init'ed for r->w x r->h) as fast as
+ * possible. Returns true if the game went exactly as recorded: same length
+ * and same score.
+ */
+bool sim_replay_run(SimReplay *r, SimContext *ctx) {
+    if (!r->finished || ctx->w != r->w || ctx->h != r->h || !sim_reset(ctx, r->seed)) {
+        return false;
+    }
+    sim_replay_rewind(r);
+    while (ctx->alive && ctx->tick < r->ticks) {
+        sim_step(ctx, sim_replay_input(r, ctx->tick), NULL);
+    }
+    return ctx->tick == r->ticks && ctx->score == r->score;
+}
+
+void sim_replay_free(SimReplay *r) {
+    free(r->data);
+    memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sim_rewind.h"
+
+#define PCG_MULTIPLIER (6364136223846793005ULL) /* of pcg32_random_r() */
+
+/* State values kept in a record, the usual movers first so the mask fits one byte */
+enum { ValHx, ValHy, ValBodyHead, ValLength, ValFx, ValFy, ValDhx, ValDhy, ValScore, ValExpand, ValAlive,
+       ValTick, VALUES };
+
+static void get_values(const SimContext *ctx, int32_t *v) {
+    v[ValHx] = ctx->hx;
+    v[ValHy] = ctx->hy;
+    v[ValBodyHead] = ctx->body_head;
+    v[ValLength] = ctx->length;
+    v[ValFx] = ctx->fx;
+    v[ValFy] = ctx->fy;
+    v[ValDhx] = ctx->dhx;
+    v[ValDhy] = ctx->dhy;
+    v[ValScore] = ctx->score;
+    v[ValExpand] = ctx->expand_counter;
+    v[ValAlive] = ctx->alive;
+    v[ValTick] = (int32_t)(ctx->tick - 1); /* a tick usually counts one up */
+}
+
+static void get_undo_values(const SimUndo *u, int32_t *v) {
+    v[ValHx] = u->hx;
+    v[ValHy] = u->hy;
+    v[ValBodyHead] = u->body_head;
+    v[ValLength] = u->length;
+    v[ValFx] = u->fx;
+    v[ValFy] = u->fy;
+    v[ValDhx] = u->dhx;
+    v[ValDhy] = u->dhy;
+    v[ValScore] = u->score;
+    v[ValExpand] = u->expand_counter;
+    v[ValAlive] = u->alive;
+    v[ValTick] = (int32_t)u->tick;
+}
+
+static void set_undo_values(SimUndo *u, const int32_t *v) {
+    u->hx = v[ValHx];
+    u->hy = v[ValHy];
+    u->body_head = v[ValBodyHead];
+    u->length = v[ValLength];
+    u->fx = v[ValFx];
+    u->fy = v[ValFy];
+    u->dhx = v[ValDhx];
+    u->dhy = v[ValDhy];
+    u->score = v[ValScore];
+    u->expand_counter = v[ValExpand];
+    u->alive = v[ValAlive] != 0;
+    u->tick = (uint32_t)v[ValTick];
+}
+
+static size_t put_varint(uint8_t *buf, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Records are written by this module only, so they are trusted */
+static uint64_t get_varint(const uint8_t *buf, size_t *pos) {
+    uint64_t v = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t b = buf[(*pos)++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/* Number of steps the generator took from state from to state to (Brown, "Random Number Generation with Arbitrary Strides") */
+static uint64_t rng_distance(uint64_t from, uint64_t to, uint64_t inc) {
+    uint64_t mult = PCG_MULTIPLIER, bit = 1, distance = 0;
+    while (from != to) {
+        if ((from & bit) != (to & bit)) {
+            from = from * mult + inc;
+            distance |= bit;
+        }
+        inc = (mult + 1) * inc;
+        mult *= mult;
+        bit <<= 1;
+    }
+    return distance;
+}
+
+/* Encodes undo of the tick that brought ctx to its state into buf, returns its length */
+static size_t encode(uint8_t *buf, const SimUndo *u, const SimContext *ctx) {
+    int32_t before[VALUES], after[VALUES];
+    get_undo_values(u, before);
+    get_values(ctx, after);
+    uint64_t mask = 0;
+    for (int k = 0; k < VALUES; k++) {
+        if (before[k] != after[k]) mask |= (uint64_t)1 << k;
+    }
+    size_t n = put_varint(buf, mask);
+    for (int k = 0; k < VALUES; k++) {
+        if (mask >> k & 1) n += put_varint(buf + n, zigzag((int64_t)before[k] - after[k]));
+    }
+    n += put_varint(buf + n, rng_distance(u->rng.state, ctx->rng.state, ctx->rng.inc));
+    buf[n++] = (uint8_t)u->count;
+    for (int k = 0; k < u->count; k++) {
+        const SimFieldChange *c = &u->changes[k];
+        n += put_varint(buf + n, (uint64_t)c->cell);
+        n += put_varint(buf + n, c->old);
+        if (field_type(c->old) == Empty) {
+            n += put_varint(buf + n, (uint64_t)c->free_slot);
+            n += put_varint(buf + n, (uint64_t)(c->free_moved + 1));
+        }
+    }
+    return n;
+}
+
+static void decode(const uint8_t *buf, SimUndo *u, const SimContext *ctx) {
+    int32_t v[VALUES];
+    size_t pos = 0;
+    get_values(ctx, v);
+    uint64_t mask = get_varint(buf, &pos);
+    for (int k = 0; k < VALUES; k++) {
+        if (mask >> k & 1) v[k] += (int32_t)unzigzag(get_varint(buf, &pos));
+    }
+    set_undo_values(u, v);
+    u->rng = ctx->rng;
+    pcg32_advance_r(&u->rng, 0 - get_varint(buf, &pos)); /* jump back */
+    u->count = buf[pos++];
+    for (int k = 0; k < u->count; k++) {
+        SimFieldChange *c = &u->changes[k];
+        c->cell = (int)get_varint(buf, &pos);
+        c->old = (BoardField)get_varint(buf, &pos);
+        c->free_slot = c->free_moved = -1;
+        if (field_type(c->old) == Empty) {
+            c->free_slot = (int)get_varint(buf, &pos);
+            c->free_moved = (int)get_varint(buf, &pos) - 1;
+        }
+    }
+}
+
+/*
+ * Allocates a ring of cap bytes keeping at most max_ticks ticks. Returns false
+ * when out of memory or when cap cannot hold a single record.
+ */
+bool sim_rewind_init(SimRewind *rw, size_t cap, uint32_t max_ticks) {
+    memset(rw, 0, sizeof(*rw));
+    if (cap < SIM_REWIND_MAX_RECORD + 2) return false;
+    rw->buf = malloc(cap);
+    if (rw->buf == NULL) return false;
+    rw->cap = cap;
+    rw->max_ticks = max_ticks;
+    return true;
+}
+
+void sim_rewind_free(SimRewind *rw) {
+    free(rw->buf);
+    memset(rw, 0, sizeof(*rw));
+}
+
+/* Forgets all ticks, e.g. when a new game starts */
+void sim_rewind_clear(SimRewind *rw) {
+    rw->head = rw->used = 0;
+    rw->count = 0;
+}
+
+static void ring_write(SimRewind *rw, const uint8_t *src, size_t n) {
+    size_t first = n < rw->cap - rw->head ? n : rw->cap - rw->head;
+    memcpy(rw->buf + rw->head, src, first);
+    memcpy(rw->buf, src + first, n - first);
+    rw->head = (rw->head + n) % rw->cap;
+}
+
+static void ring_read(const SimRewind *rw, size_t pos, uint8_t *dst, size_t n) {
+    size_t first = n < rw->cap - pos ? n : rw->cap - pos;
+    memcpy(dst, rw->buf + pos, first);
+    memcpy(dst + first, rw->buf, n - first);
+}
+
+static void drop_oldest(SimRewind *rw) {
+    size_t tail = (rw->head + rw->cap - rw->used) % rw->cap;
+    rw->used -= (size_t)rw->buf[tail] + 2;
+    rw->count--;
+}
+
+/* Same as sim_step(), and keeps the tick in the ring */
+void sim_rewind_step(SimRewind *rw, SimContext *ctx, SimInput input, SimEvents *events) {
+    SimUndo undo;
+    uint8_t record[SIM_REWIND_MAX_RECORD + 2];
+    sim_step_undoable(ctx, input, events, &undo);
+    uint8_t len = (uint8_t)encode(record + 1, &undo, ctx);
+    record[0] = record[len + 1] = len;
+    while (rw->count > 0 && (rw->used + len + 2 > rw->cap || rw->count >= rw->max_ticks)) {
+        drop_oldest(rw);
+    }
+    if (rw->max_ticks == 0) return;
+    ring_write(rw, record, (size_t)len + 2);
+    rw->used += (size_t)len + 2;
+    rw->count++;
+    rw->bytes_written += (size_t)len + 2;
+    rw->records_written++;
+}
+
+/* Takes the newest tick in the ring back. Returns false if there is none. */
+bool sim_rewind_back(SimRewind *rw, SimContext *ctx) {
+    if (rw->count == 0) return false;
+    uint8_t record[SIM_REWIND_MAX_RECORD];
+    SimUndo undo;
+    size_t len = rw->buf[(rw->head + rw->cap - 1) % rw->cap];
+    size_t start = (rw->head + rw->cap - 1 - len) % rw->cap;
+    ring_read(rw, start, record, len);
+    decode(record, &undo, ctx);
+    sim_undo(ctx, &undo);
+    rw->head = (start + rw->cap - 1) % rw->cap;
+    rw->used -= len + 2;
+    rw->count--;
+    return true;
+}
@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_snapshot.h"
+#include "sim_reach.h"
+
+#define SNAPSHOT_MAGIC "VONSHSNP"
+#define SNAPSHOT_ORDER (0x01020304u) /* reads differently on a machine of other byte order */
+#define SNAPSHOT_MAX_REPLAY (1u << 30) /* bytes of replay inputs accepted */
+#define HASH_SEED (0x76736e7073686f74ULL)
+#define HASH_MULT (0x9E3779B97F4A7C15ULL)
+
+/*
+ * Hashes n bytes on top of h, a word at a time so that large boards stay
+ * cheap. Pieces of whole words hash the same as the bytes in one go.
+ */
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t n) {
+    const uint8_t *p = data;
+    uint64_t w;
+    for (; n >= 8; n -= 8, p += 8) {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * HASH_MULT;
+        h ^= h >> 32;
+    }
+    if (n > 0) {
+        w = 0;
+        memcpy(&w, p, n);
+        h = (h ^ w) * HASH_MULT;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+/* Live part of the body ring from tail to head, in at most two pieces */
+static int body_pieces(const SimContext *ctx, const SimSegment **piece, size_t *count) {
+    int tail = ctx->body_head - ctx->length + 1;
+    if (tail >= 0) {
+        piece[0] = ctx->body + tail;
+        count[0] = (size_t)ctx->length;
+        return 1;
+    }
+    tail += ctx->body_cap;
+    piece[0] = ctx->body + tail;
+    count[0] = (size_t)(ctx->body_cap - tail);
+    piece[1] = ctx->body;
+    count[1] = (size_t)ctx->body_head + 1;
+    return 2;
+}
+
+/*
+ * Writes the state of ctx and, if replay is not NULL, the replay recorded so
+ * far to path. frame is kept for the caller. The file is replaced only once it
+ * is written completely. Returns false on failure, errno tells why.
+ */
+bool sim_snapshot_save(const SimContext *ctx, const SimReplay *replay, uint32_t frame, const char *path) {
+    SimSnapshotHeader hd;
+    memset(&hd, 0, sizeof(hd));
+    memcpy(hd.magic, SNAPSHOT_MAGIC, sizeof(hd.magic));
+    hd.order = SNAPSHOT_ORDER;
+    hd.version = SIM_SNAPSHOT_VERSION;
+    hd.cell_bits = SIM_CELL_BITS;
+    hd.layout = SIM_BOARD_LAYOUT;
+    hd.w = (uint32_t)ctx->w;
+    hd.h = (uint32_t)ctx->h;
+    hd.board_cells = (uint32_t)ctx->board_cells;
+    hd.bb_stride = (uint32_t)ctx->bb_stride;
+    hd.dhx = ctx->dhx;
+    hd.dhy = ctx->dhy;
+    hd.hx = ctx->hx;
+    hd.hy = ctx->hy;
+    hd.length = ctx->length;
+    hd.free_count = ctx->free_count;
+    hd.fx = ctx->fx;
+    hd.fy = ctx->fy;
+    hd.score = ctx->score;
+    hd.expand_counter = ctx->expand_counter;
+    hd.growth = ctx->growth;
+    hd.alive = ctx->alive;
+    hd.tick = ctx->tick;
+    hd.frame = frame;
+    hd.rng_state = ctx->rng.state;
+    hd.rng_inc = ctx->rng.inc;
+    if (replay != NULL) {
+        hd.replay_seed = replay->seed;
+        hd.replay_ground_seed = replay->ground_seed;
+        hd.replay_last_tick = replay->last_tick;
+        hd.has_replay = 1;
+        hd.replay_size = (uint32_t)replay->size;
+    }
+
+    const SimSegment *piece[2];
+    size_t count[2];
+    int pieces = body_pieces(ctx, piece, count);
+    size_t board_bytes = (size_t)ctx->board_cells * sizeof(BoardField);
+    size_t free_bytes = (size_t)ctx->free_count * sizeof(int);
+    uint64_t h = HASH_SEED;
+    h = hash_bytes(h, ctx->board, board_bytes);
+    h = hash_bytes(h, ctx->free_cells, free_bytes);
+    for (int k = 0; k < pieces; k++) h = hash_bytes(h, piece[k], count[k] * sizeof(SimSegment));
+    h = hash_bytes(h, ctx->chars, (size_t)ctx->length);
+    if (hd.has_replay) h = hash_bytes(h, replay->data, hd.replay_size);
+    hd.hash = h;
+
+    char tmp_path[4096];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= sizeof(tmp_path)) return false;
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) return false;
+    bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1 &&
+              fwrite(ctx->board, 1, board_bytes, f) == board_bytes &&
+              fwrite(ctx->free_cells, 1, free_bytes, f) == free_bytes;
+    for (int k = 0; k < pieces && ok; k++) ok = fwrite(piece[k], sizeof(SimSegment), count[k], f) == count[k];
+    ok = ok && fwrite(ctx->chars, 1, (size_t)ctx->length, f) == (size_t)ctx->length;
+    if (hd.has_replay) ok = ok && fwrite(replay->data, 1, hd.replay_size, f) == hd.replay_size;
+    ok = fclose(f) == 0 && ok;
+    if (ok) ok = rename(tmp_path, path) == 0;
+    if (!ok) remove(tmp_path);
+    return ok;
+}
+
+static bool on_board(const SimSnapshotHeader *hd, int x, int y) {
+    return x >= 0 && y >= 0 && x < (int)hd->w && y < (int)hd->h;
+}
+
+/* Field holds something the game can make, kinds are used as indices when drawn */
+static bool field_is_valid(BoardField field) {
+    int kind = field_kind(field);
+    switch (field_type(field)) {
+    case Empty:
+        return field == make_field(Empty, 0, 0, 0);
+    case Snake:
+        return kind == 0;
+    case Food:
+        return kind < FOOD_KINDS && field == make_field(Food, kind, 0, 0);
+    case Wall:
+        return kind < WALL_KINDS && field == make_field(Wall, kind, 0, 0);
+    }
+    return false;
+}
+
+/* Header fits this build and describes a possible game */
+static bool header_is_valid(const SimSnapshotHeader *hd) {
+    int64_t cells = (int64_t)hd->w * hd->h;
+    return memcmp(hd->magic, SNAPSHOT_MAGIC, sizeof(hd->magic)) == 0 && hd->order == SNAPSHOT_ORDER &&
+           hd->version == SIM_SNAPSHOT_VERSION && hd->cell_bits == SIM_CELL_BITS &&
+           hd->layout == SIM_BOARD_LAYOUT && sim_board_size_is_valid(hd->w, hd->h) && hd->length >= 1 &&
+           hd->length <= cells && hd->free_count >= 0 && hd->free_count <= cells - hd->length &&
+           abs(hd->dhx) + abs(hd->dhy) == 1 &&
+           on_board(hd, hd->hx, hd->hy) && (on_board(hd, hd->fx, hd->fy) || (hd->fx == -1 && hd->fy == -1)) &&
+           hd->expand_counter >= 0 && hd->score >= 0 && hd->growth >= 0 && (hd->alive == 0 || hd->alive == 1) &&
+           hd->replay_size <= SNAPSHOT_MAX_REPLAY;
+}
+
+/*
+ * Checks the board read into ctx against itself and the header: fields and
+ * padding hold only what the game makes, the empty fields listed are exactly
+ * the Empty ones (in the order read, which decides where items are seeded),
+ * the body is a chain of distinct Snake fields covering every one of them,
+ * the food is the one Food field and characters are in range. Sets up
+ * free_pos and the bitboard from the board on the way.
+ */
+static bool restore_board(SimContext *ctx, const SimSnapshotHeader *hd) {
+    int w = ctx->w, h = ctx->h;
+    int empty = 0, snake = 0, food = 0, used = 0;
+    sim_reach_clear(ctx);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            BoardField field = sim_field(ctx, x, y);
+            if (!field_is_valid(field)) return false;
+            FieldType type = field_type(field);
+            empty += type == Empty;
+            snake += type == Snake;
+            food += type == Food;
+            if (type == Snake || type == Wall) sim_reach_set_blocked(ctx, x, y, true);
+        }
+    }
+    for (int i = 0; i < ctx->board_cells; i++) used += ctx->board[i] != make_field(Empty, 0, 0, 0);
+    if (used != w * h - empty || empty != hd->free_count || snake != hd->length) return false;
+    if (hd->fx >= 0 ? food != 1 || field_type(sim_field(ctx, hd->fx, hd->fy)) != Food : food != 0) return false;
+
+    /* body fields are marked -2 in free_pos while their distinctness is checked */
+    int n = w * h;
+    memset(ctx->free_pos, 0xFF, (size_t)n * sizeof(int)); /* all -1 */
+    for (int k = 0; k < hd->length; k++) {
+        const SimSegment *s = &ctx->body[k];
+        if (!on_board(hd, s->x, s->y) || ctx->chars[k] >= TOTAL_CHARS) return false;
+        BoardField field = sim_field(ctx, s->x, s->y);
+        int c = w * s->y + s->x;
+        if (field_type(field) != Snake || ctx->free_pos[c] != -1) return false;
+        /* every piece but the tail points to the one before it */
+        if (k > 0 && (s->x + field_pdx(field) != s[-1].x || s->y + field_pdy(field) != s[-1].y)) return false;
+        ctx->free_pos[c] = -2;
+    }
+    if (ctx->body[hd->length - 1].x != hd->hx || ctx->body[hd->length - 1].y != hd->hy) return false;
+    for (int k = 0; k < hd->length; k++) ctx->free_pos[w * ctx->body[k].y + ctx->body[k].x] = -1;
+
+    for (int i = 0; i < hd->free_count; i++) {
+        int c = ctx->free_cells[i];
+        if (c < 0 || c >= n || ctx->free_pos[c] != -1 || field_type(sim_field(ctx, c % w, c / w)) != Empty) {
+            return false;
+        }
+        ctx->free_pos[c] = i;
+    }
+    return true;
+}
+
+/*
+ * Restores the state written by sim_snapshot_save() into ctx (set up by
+ * sim_init() before, reallocated if board dimensions differ) and, if replay
+ * is not NULL, the replay recorded so far into replay (zeroed or used
+ * before). frame gets the value given on saving. Returns false if the file
+ * cannot be read, is of another machine or build, or is damaged; ctx then
+ * needs sim_reset() before it is played.
+ */
+bool sim_snapshot_load(SimContext *ctx, SimReplay *replay, uint32_t *frame, const char *path) {
+    SimSnapshotHeader hd;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return false;
+    if (fread(&hd, sizeof(hd), 1, f) != 1 || !header_is_valid(&hd)) {
+        fclose(f);
+        return false;
+    }
+    int w = (int)hd.w, h = (int)hd.h;
+    if (ctx->w != w || ctx->h != h) {
+        sim_free(ctx);
+        if (!sim_init(ctx, w, h)) {
+            fclose(f);
+            return false;
+        }
+    }
+    uint8_t *replay_data = NULL;
+    if (hd.has_replay && hd.replay_size > 0) {
+        replay_data = malloc(hd.replay_size);
+        if (replay_data == NULL) {
+            fclose(f);
+            return false;
+        }
+    }
+
+    /* bulk read straight into place, the body goes to the start of the ring */
+    size_t board_bytes = (size_t)ctx->board_cells * sizeof(BoardField);
+    size_t free_bytes = (size_t)hd.free_count * sizeof(int);
+    size_t length = (size_t)hd.length;
+    bool ok = hd.board_cells == (uint32_t)ctx->board_cells && hd.bb_stride == (uint32_t)ctx->bb_stride &&
+              fread(ctx->board, 1, board_bytes, f) == board_bytes &&
+              fread(ctx->free_cells, 1, free_bytes, f) == free_bytes &&
+              fread(ctx->body, sizeof(SimSegment), length, f) == length &&
+              fread(ctx->chars, 1, length, f) == length &&
+              (replay_data == NULL || fread(replay_data, 1, hd.replay_size, f) == hd.replay_size) &&
+              fgetc(f) == EOF;
+    fclose(f);
+
+    if (ok) {
+        uint64_t hash = HASH_SEED;
+        hash = hash_bytes(hash, ctx->board, board_bytes);
+        hash = hash_bytes(hash, ctx->free_cells, free_bytes);
+        hash = hash_bytes(hash, ctx->body, length * sizeof(SimSegment));
+        hash = hash_bytes(hash, ctx->chars, length);
+        if (hd.has_replay) hash = hash_bytes(hash, replay_data, hd.replay_size);
+        ok = hash == hd.hash;
+    }
+    /* the hash only catches accidents, so everything is checked against the board */
+    if (!ok || !restore_board(ctx, &hd)) {
+        free(replay_data);
+        return false;
+    }
+
+    ctx->dhx = hd.dhx;
+    ctx->dhy = hd.dhy;
+    ctx->hx = hd.hx;
+    ctx->hy = hd.hy;
+    ctx->body_head = hd.length - 1;
+    ctx->length = hd.length;
+    ctx->free_count = hd.free_count;
+    ctx->fx = hd.fx;
+    ctx->fy = hd.fy;
+    ctx->score = hd.score;
+    ctx->expand_counter = hd.expand_counter;
+    ctx->growth = hd.growth;
+    ctx->alive = hd.alive != 0;
+    ctx->tick = hd.tick;
+    ctx->rng.state = hd.rng_state;
+    ctx->rng.inc = hd.rng_inc;
+    ctx->undo = NULL;
+    ctx->journal_floor = ++ctx->journal_seq; /* whole board changed */
+    if (frame != NULL) *frame = hd.frame;
+
+    if (replay != NULL && hd.has_replay) {
+        sim_replay_start(replay, w, h, hd.replay_seed, hd.replay_ground_seed);
+        free(replay->data);
+        replay->data = replay_data;
+        replay->size = replay->cap = hd.replay_size;
+        replay->last_tick = hd.replay_last_tick;
+        replay_data = NULL;
+    }
+    free(replay_data);
+    return true;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <wordexp.h>
+#include "types.h"
+#include "snapshots.h"
+#include "sim_snapshot.h"
+#include "game_logic.h"
+#include "file_io.h"
+
+static SimContext loaded; /* game read by snapshots_load(), until it is resumed */
+static uint32_t loaded_frame;
+
+static bool snapshot_path(char *path, size_t size) {
+    wordexp_t p;
+    path[0] = '\0';
+    if (wordexp(USER_SHARE_DIR SNAPSHOT_FILE, &p, 0) == 0) {
+        strncpy(path, p.we_wordv[0], size - 1);
+        path[size - 1] = '\0';
+        wordfree(&p);
+    }
+    return path[0] != '\0';
+}
+
+/* Game of the player, which is worth continuing (not a replay, autopilot, remote or arena game) */
+static bool game_is_resumable(void) {
+    return (g_game.state == Playing || g_game.state == Paused) && !g_game.replaying &&
+           g_game.controller.decide == NULL && !g_game.remote_on && g_game.arena_snakes == 0;
+}
+
+/* Saves the game being played to USER_SHARE_DIR SNAPSHOT_FILE, it is continued on the next start */
+void snapshots_save(void) {
+    char dir_path[PATH_MAX], path[PATH_MAX];
+    if (!game_is_resumable() || !snapshot_path(path, sizeof(path))) {
+        return;
+    }
+    strcpy(dir_path, path);
+    *strrchr(dir_path, '/') = '\0';
+    strcat(dir_path, "/");
+    ensure_dir_exists(dir_path);
+    if (!sim_snapshot_save(&g_game.sim, &g_game.replay, g_game.frame % CHAR_ANIM_FRAMES, path)) {
+        perror("Could not write snapshot file");
+    }
+}
+
+/*
+ * Reads the game left by snapshots_save(), to be called before the game
+ * engine is initialized so that the window gets the board size of the game.
+ * Returns false if there is none (or it cannot be used).
+ */
+bool snapshots_load(void) {
+    char path[PATH_MAX];
+    if (!snapshot_path(path, sizeof(path))) {
+        return false;
+    }
+    if (!sim_snapshot_load(&loaded, &g_game.replay, &loaded_frame, path)) {
+        sim_free(&loaded);
+        return false;
+    }
+    return true;
+}
+
+/* Game read by snapshots_load() and not resumed yet, NULL if there is none */
+const SimContext *snapshots_pending(void) {
+    return loaded.w > 0 ? &loaded : NULL;
+}
+
+/*
+ * Continues the game read by snapshots_load(), paused, on the board set up by
+ * the game engine. The snapshot file is removed, a game is resumed only once.
+ */
+void snapshots_resume(void) {
+    char path[PATH_MAX];
+    if (snapshots_pending() == NULL) {
+        return;
+    }
+    sim_free(&g_game.sim);
+    g_game.sim = loaded; /* takes over the buffers */
+    memset(&loaded, 0, sizeof(loaded));
+    if (snapshot_path(path, sizeof(path))) {
+        remove(path);
+    }
+    start_restored_play(loaded_frame);
+}
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "error_handling.h"
+#include "sprite_batch.h"
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define HAVE_RENDER_GEOMETRY
+#endif
+
+static SDL_Renderer *batch_renderer = NULL;
+static bool geometry = false; /* sprites are held and drawn as geometry */
+static SDL_Vertex *vertices = NULL; /* 4 per sprite */
+static int *indices = NULL; /* 6 per sprite, the same for every batch */
+static int held = 0; /* sprites held */
+static SDL_Texture *held_texture = NULL;
+static int texture_w, texture_h;
+static SDL_Color texture_color; /* color and alpha modulation of held_texture */
+static SDL_Texture *tinted_texture = NULL; /* texture whose color modulation was last set by a copy */
+static SDL_Color tinted_color;
+static SpriteBatchStats stats;
+
+/*
+ * Sets up drawing through renderer. If batching is false, or SDL is too old,
+ * sprites are drawn one by one.
+ */
+void sprite_batch_init(SDL_Renderer *renderer, bool batching) {
+    batch_renderer = renderer;
+#ifdef HAVE_RENDER_GEOMETRY
+    geometry = batching;
+#else
+    (void)batching;
+#endif
+    if (!geometry) return;
+    vertices = malloc(SPRITE_BATCH_MAX * 4 * sizeof(SDL_Vertex));
+    indices = malloc(SPRITE_BATCH_MAX * 6 * sizeof(int));
+    if (vertices == NULL || indices == NULL) {
+        set_error("Error: Error allocating memory for sprite batches.");
+        return;
+    }
+    for (int i = 0; i < SPRITE_BATCH_MAX; i++) {
+        int *q = &indices[i * 6];
+        q[0] = i * 4;  q[1] = i * 4 + 1;  q[2] = i * 4 + 2;
+        q[3] = i * 4 + 2;  q[4] = i * 4 + 3;  q[5] = i * 4;
+    }
+}
+
+void sprite_batch_free(void) {
+    free(vertices);
+    free(indices);
+    vertices = NULL;
+    indices = NULL;
+    geometry = false;
+}
+
+#ifdef HAVE_RENDER_GEOMETRY
+/* Draws the sprites held as copies, used if the renderer refuses geometry */
+static void copy_held_sprites(void) {
+    for (int i = 0; i < held; i++) {
+        const SDL_Vertex *v = &vertices[i * 4];
+        SDL_Rect src = { (int)(v[0].tex_coord.x * texture_w + 0.5f), (int)(v[0].tex_coord.y * texture_h + 0.5f), 0, 0 };
+        src.w = (int)(v[2].tex_coord.x * texture_w + 0.5f) - src.x;
+        src.h = (int)(v[2].tex_coord.y * texture_h + 0.5f) - src.y;
+        SDL_Rect dst = { (int)v[0].position.x, (int)v[0].position.y, 0, 0 };
+        dst.w = (int)v[2].position.x - dst.x;
+        dst.h = (int)v[2].position.y - dst.y;
+        SDL_SetTextureColorMod(held_texture, v[0].color.r, v[0].color.g, v[0].color.b);
+        SDL_SetTextureAlphaMod(held_texture, v[0].color.a);
+        SDL_RenderCopy(batch_renderer, held_texture, &src, &dst);
+        stats.draw_calls++;
+    }
+    SDL_SetTextureColorMod(held_texture, texture_color.r, texture_color.g, texture_color.b);
+    SDL_SetTextureAlphaMod(held_texture, texture_color.a);
+}
+#endif
+
+/* Draws the sprites held so far */
+void sprite_batch_flush(void) {
+    if (held == 0) return;
+#ifdef HAVE_RENDER_GEOMETRY
+    if (SDL_RenderGeometry(batch_renderer, held_texture, vertices, held * 4, indices, held * 6) == 0) {
+        stats.draw_calls++;
+    }
+    else {
+        /* renderer can not do it, sprites are copied from now on */
+        copy_held_sprites();
+        geometry = false;
+    }
+#endif
+    held = 0;
+}
+
+/* Starts holding sprites of texture */
+static bool hold_texture(SDL_Texture *texture) {
+    if (texture == held_texture && held > 0) return true;
+    sprite_batch_flush();
+    if (SDL_QueryTexture(texture, NULL, NULL, &texture_w, &texture_h) != 0 ||
+        SDL_GetTextureColorMod(texture, &texture_color.r, &texture_color.g, &texture_color.b) != 0 ||
+        SDL_GetTextureAlphaMod(texture, &texture_color.a) != 0) {
+        set_error("Failed to query texture: %s", SDL_GetError());
+        return false;
+    }
+    held_texture = texture;
+    return true;
+}
+
+static void add_sprite(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, const SDL_Color *color) {
+    if (!hold_texture(texture)) return;
+    SDL_Color c = color != NULL ? *color : texture_color;
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    if (src != NULL) {
+        u0 = (float)src->x / texture_w;
+        v0 = (float)src->y / texture_h;
+        u1 = (float)(src->x + src->w) / texture_w;
+        v1 = (float)(src->y + src->h) / texture_h;
+    }
+    float x0 = (float)dst->x, y0 = (float)dst->y, x1 = (float)(dst->x + dst->w), y1 = (float)(dst->y + dst->h);
+    SDL_Vertex *v = &vertices[held * 4];
+    v[0] = (SDL_Vertex){ { x0, y0 }, c, { u0, v0 } };
+    v[1] = (SDL_Vertex){ { x1, y0 }, c, { u1, v0 } };
+    v[2] = (SDL_Vertex){ { x1, y1 }, c, { u1, v1 } };
+    v[3] = (SDL_Vertex){ { x0, y1 }, c, { u0, v1 } };
+    if (++held == SPRITE_BATCH_MAX) {
+        sprite_batch_flush();
+    }
+}
+
+/* Draws the src part of texture (all of it if NULL) to dst, which has to be given */
+void sprite_batch_copy(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst) {
+    stats.sprites++;
+    if (geometry) {
+        add_sprite(texture, src, dst, NULL);
+        return;
+    }
+    if (texture == tinted_texture) {
+        /* text shares the atlas, its tint is taken off again */
+        SDL_SetTextureColorMod(texture, 255, 255, 255);
+        SDL_SetTextureAlphaMod(texture, 255);
+        tinted_texture = NULL;
+    }
+    SDL_RenderCopy(batch_renderer, texture, src, dst);
+    stats.draw_calls++;
+}
+
+/* Same as sprite_batch_copy(), with the texture's colors multiplied by color */
+void sprite_batch_copy_color(SDL_Texture *texture, const SDL_Rect *src, const SDL_Rect *dst, SDL_Color color) {
+    stats.sprites++;
+    if (geometry) {
+        add_sprite(texture, src, dst, &color);
+        return;
+    }
+    if (texture != tinted_texture || color.r != tinted_color.r || color.g != tinted_color.g ||
+        color.b != tinted_color.b || color.a != tinted_color.a) {
+        SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+        SDL_SetTextureAlphaMod(texture, color.a);
+        tinted_texture = texture;
+        tinted_color = color;
+    }
+    SDL_RenderCopy(batch_renderer, texture, src, dst);
+    stats.draw_calls++;
+}
+
+/* Sprites are drawn as geometry */
+bool sprite_batch_is_batching(void) {
+    return geometry;
+}
+
+const SpriteBatchStats *sprite_batch_stats(void) {
+    return &stats;
+}
@@ -4,17 +4,17 @@
 #include "error_handling.h"
 #include "text_renderer.h"
 #include "font_layout.h"
+#include "render_queue.h"
+
+#define TEXT_GLYPHS_MAX (512) /* glyphs of a single text, the rest is cut off */
 
-static SDL_Renderer* text_renderer = NULL;
 static SDL_Texture* font_texture = NULL;
-static int font_h = 0; /* font texture height */
+static int font_h = 0; /* font height */
 
-void init_text_renderer(SDL_Renderer* renderer, SDL_Texture* texture) {
-    text_renderer = renderer;
+/* texture is the atlas, glyphs are taken from its atlas_font_* parts */
+void init_text_renderer(SDL_Texture* texture) {
     font_texture = texture;
-    if (SDL_QueryTexture(font_texture, NULL, NULL, NULL, &font_h)) {
-        set_error("Failed to query texture: %s", SDL_GetError());
-    }
+    font_h = atlas_font_white.h;
 }
 
 int get_text_width(const char* text) {
@@ -63,137 +63,87 @@ int get_text_height(const char* text) {
     return line_count * font_h;
 }
 
-int render_text(SDL_Renderer* renderer, SDL_Texture* font, const char* text, int x, int y, TextHorizontalAlignment horizontal_align, TextVerticalAlignment vertical_align, TextColor color) {
-    int i; /* index of letter font layout table */
-    const char* text_p = text;
-    const char* line_start = text;
-    int text_h = get_text_height(text);
-    SDL_Rect SrcR, DstR;
-    int line_y = y;
-    int line_width = 0;
-    int max_width = 0;
+/* Moves dst.x of glyphs first..last-1, laid out from x = 0, to a line of given width aligned at x */
+static void align_line(SDL_Rect* dst, int first, int last, int width, int x, TextHorizontalAlignment horizontal_align) {
+    int shift = x;
+    if (horizontal_align == ALIGN_RIGHT) {
+        shift = x - width;
+    }
+    else if (horizontal_align == ALIGN_CENTER_HORIZONTAL) {
+        shift = x - width/2;
+    }
+    for (int g = first; g < last; g++) {
+        dst[g].x += shift;
+    }
+}
 
-    SrcR.y = 0;
-    SrcR.h = DstR.h = font_h;
+/*
+ * Lays the text out in a single pass and queues all its glyphs in one go.
+ * Glyphs are placed from x = 0 and y = 0 and moved into place once the
+ * width of their line, and in the end the height of the text, is known.
+ * The font is taken from the atlas copy already in the color asked for, so
+ * text of all colors goes to the same batch without tinting.
+ * Returns the width of the longest line.
+ */
+int render_text(const char* text, int x, int y, TextHorizontalAlignment horizontal_align, TextVerticalAlignment vertical_align, TextColor color) {
+    static SDL_Rect src[TEXT_GLYPHS_MAX], dst[TEXT_GLYPHS_MAX];
+    int glyphs = 0;
+    int line_start = 0; /* first glyph of the current line */
+    int line_x = 0, line_y = 0;
+    int max_width = 0;
+    const SDL_Rect* glyph_font;
 
     switch (color) {
-        case TEXT_WHITE:
-            if (SDL_SetTextureColorMod(font_texture, 224, 224, 224)) {
-                set_error("Failed to set texture color: %s", SDL_GetError());
-            }
-            break;
         case TEXT_GREY:
-            if (SDL_SetTextureColorMod(font_texture, 128, 128, 128)) {
-                set_error("Failed to set texture color: %s", SDL_GetError());
-            }
+            glyph_font = &atlas_font_grey;
             break;
         case TEXT_YELLOW:
-            if (SDL_SetTextureColorMod(font_texture, 255, 192, 32)) {
-                set_error("Failed to set texture color: %s", SDL_GetError());
-            }
+            glyph_font = &atlas_font_yellow;
+            break;
+        case TEXT_WHITE:
+        default:
+            glyph_font = &atlas_font_white;
             break;
     }
 
-    /* start y position of text block */
-    if (vertical_align == ALIGN_TOP) {
-        line_y = y;
-    }
-    else if (vertical_align == ALIGN_CENTER_VERTICAL) {
-        line_y = y - text_h/2;
-    }
-    else if (vertical_align == ALIGN_BOTTOM) {
-        line_y = y - text_h;
-    }
-
-    /* Render text characters line by line */
-    while(*text_p) {
+    for (const char* text_p = text; ; text_p++) {
         if (*text_p == '\n' || *text_p == '\0') {
-            /* Calculate start x position for this line */
-            if (horizontal_align == ALIGN_RIGHT) {
-                DstR.x = x - line_width;
-            }
-            else if (horizontal_align == ALIGN_CENTER_HORIZONTAL) {
-                DstR.x = x - line_width/2;
-            }
-            else { /* ALIGN_LEFT */
-                DstR.x = x;
+            align_line(dst, line_start, glyphs, line_x, x, horizontal_align);
+            if (line_x > max_width) {
+                max_width = line_x;
             }
-            DstR.y = line_y;
-
-            /* Render the line */
-            while(line_start < text_p) {
-                if (*line_start != ' ') {
-                    i = *line_start - '!';
-                    SrcR.x = font_layout[i];
-                    SrcR.w = DstR.w = font_layout[i+1] - font_layout[i];
-                    if (SDL_RenderCopy(renderer, font, &SrcR, &DstR)) {
-                        set_error("Failed to render text: %s", SDL_GetError());
-                        return 0;
-                    }
-                    DstR.x += DstR.w;
-                }
-                else {
-                    DstR.x += font_h/3; /* substitute for space */
-                }
-                line_start++;
-            }
-
-            /* Move to next line */
+            if (*text_p == '\0') break;
+            line_start = glyphs;
+            line_x = 0;
             line_y += font_h;
-            line_start = text_p + 1;
-            if (line_width > max_width) {
-                max_width = line_width;
-            }
-            line_width = 0;
+        }
+        else if (*text_p == ' ') {
+            line_x += font_h/3; /* substitute for space */
         }
         else {
-            /* Calculate width of current line */
-            if (*text_p != ' ') {
-                i = *text_p - '!';
-                line_width += font_layout[i+1] - font_layout[i];
-            }
-            else {
-                line_width += font_h/3;
+            int i = *text_p - '!';
+            int w = font_layout[i+1] - font_layout[i];
+            if (glyphs < TEXT_GLYPHS_MAX) {
+                src[glyphs] = (SDL_Rect){ glyph_font->x + font_layout[i], glyph_font->y, w, font_h };
+                dst[glyphs] = (SDL_Rect){ line_x, line_y, w, font_h };
+                glyphs++;
             }
+            line_x += w;
         }
-        text_p++;
     }
 
-    /* Render final line if needed */
-    if (line_start < text_p) {
-        /* Calculate start x position for last line */
-        if (horizontal_align == ALIGN_RIGHT) {
-            DstR.x = x - line_width;
-        }
-        else if (horizontal_align == ALIGN_CENTER_HORIZONTAL) {
-            DstR.x = x - line_width/2;
-        }
-        else { /* ALIGN_LEFT */
-            DstR.x = x;
-        }
-        DstR.y = line_y;
-
-        /* Render the last line */
-        while(line_start < text_p) {
-            if (*line_start != ' ') {
-                i = *line_start - '!';
-                SrcR.x = font_layout[i];
-                SrcR.w = DstR.w = font_layout[i+1] - font_layout[i];
-                if (SDL_RenderCopy(renderer, font, &SrcR, &DstR)) {
-                    set_error("Failed to render text: %s", SDL_GetError());
-                    return 0;
-                }
-                DstR.x += DstR.w;
-            }
-            else {
-                DstR.x += font_h/3; /* substitute for space */
-            }
-            line_start++;
-        }
-        if (line_width > max_width) {
-            max_width = line_width;
-        }
+    /* start y position of text block, line_y is where the last line starts */
+    int text_h = line_y + font_h;
+    if (vertical_align == ALIGN_CENTER_VERTICAL) {
+        y -= text_h/2;
+    }
+    else if (vertical_align == ALIGN_BOTTOM) {
+        y -= text_h;
+    }
+    for (int g = 0; g < glyphs; g++) {
+        dst[g].y += y;
     }
+    render_queue_copy_n(font_texture, src, dst, glyphs);
 
     return max_width;
 }
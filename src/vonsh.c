@@ -15,10 +15,15 @@
 #include <SDL2/SDL_mixer.h>
 
 #include "types.h"
+#include "sim_clock.h"
 #include "error_handling.h"
 #include "text_renderer.h"
 #include "pcg_basic.h"
 #include "hiscores.h"
+#include "replays.h"
+#include "remote.h"
+#include "arena.h"
+#include "snapshots.h"
 #include "audio.h"
 #include "config.h"
 #include "file_io.h"
@@ -26,6 +31,8 @@
 #include "menu_rendering.h"
 #include "game_logic.h"
 #include "game_rendering.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
 
 #define CHECK_SDL_CALL(func_call, error_msg) \
     do { \
@@ -47,17 +54,32 @@
 Graphics g_gfx = {0};
 Game g_game = {0};
 
-/* Callback for animation frame timer.
-   Generates SDL_USEREVENT when main game loop shall render next frame. */
-uint32_t tick_callback(uint32_t interval, void *param) {
-    (void)param;
-    SDL_Event event;
-    SDL_UserEvent userevent;
-    userevent.type = SDL_USEREVENT;  userevent.code = 0;
-    userevent.data1 = NULL;  userevent.data2 = NULL;
-    event.type = SDL_USEREVENT;  event.user = userevent;
-    SDL_PushEvent(&event);
-    return interval;
+static struct {
+    uint64_t frames;
+    double draw_ms; /* spent drawing frames, until presenting */
+} frame_stats;
+
+/*
+ * Sets the display up for a board of w x h fields: fullscreen when so
+ * configured and the screen holds exactly that board (the mode the game was
+ * played in), a window of that size otherwise. The configured size and mode
+ * are kept for the config file.
+ */
+static void use_board_size(int w, int h) {
+    SDL_DisplayMode mode;
+    if (g_game.fullscreen && SDL_GetDesktopDisplayMode(0, &mode) == 0 &&
+        mode.w / TILE_SIZE == w && mode.h / TILE_SIZE - 1 == h) {
+        return;
+    }
+    if (!g_game.fullscreen && g_game.window_board_w == w && g_game.window_board_h == h) {
+        return;
+    }
+    g_game.config_board_w = g_game.window_board_w;
+    g_game.config_board_h = g_game.window_board_h;
+    g_game.config_fullscreen = g_game.fullscreen;
+    g_game.fullscreen = false;
+    g_game.window_board_w = w;
+    g_game.window_board_h = h;
 }
 
 /*
@@ -94,6 +116,14 @@ static void init_game_engine() {
     /* Ensure user config exists and load it before creating window (affects window/fullscreen, keys, etc.) */
     ensure_user_config_exists();
     load_user_config();
+    sim_input_queue_init(&g_game.input_queue, g_game.input_queue_depth);
+    if (g_game.replaying) {
+        /* replay is shown on a board of the size it was recorded on */
+        use_board_size(g_game.replay.w, g_game.replay.h);
+    } else if (snapshots_pending() != NULL) {
+        /* so is a game left on quitting */
+        use_board_size(snapshots_pending()->w, snapshots_pending()->h);
+    }
     audio_init();
     if (get_first_error()) {
         return;
@@ -119,75 +149,25 @@ static void init_game_engine() {
         if (get_first_error()) return;
     }
 
-    g_gfx.renderer = SDL_CreateRenderer(g_gfx.screen, -1,
-                    SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    g_gfx.renderer = SDL_CreateRenderer(g_gfx.screen, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE |
+                    (g_game.vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
     CHECK_SDL_PTR(g_gfx.renderer, "SDL renderer not created");
-
-    /* load textures */
-    load_texture(&g_gfx.txt_env_tileset, RES_DIR"board_tiles.png");
-    if (get_first_error()) return;
-    load_texture(&g_gfx.txt_food_tileset, RES_DIR"food_tiles.png");
-    if (get_first_error()) return;
-    load_texture(&g_gfx.txt_food_marker, RES_DIR"food_marker.png");
-    if (get_first_error()) return;
-    load_texture(&g_gfx.txt_char_tileset, RES_DIR"character_tiles.png");
-    if (get_first_error()) return;
-    load_texture(&g_gfx.txt_font, RES_DIR"good_neighbors.png");
-    if (get_first_error()) return;
-    load_texture(&g_gfx.txt_logo, RES_DIR"logo.png");
-    if (get_first_error()) return;
-    load_texture(&g_gfx.txt_trophy, RES_DIR"trophy-bronze.png");
+    /* some drivers present at once anyway, frames are then paced by the main loop */
+    SDL_RendererInfo renderer_info;
+    if (SDL_GetRendererInfo(g_gfx.renderer, &renderer_info) != 0 ||
+        !(renderer_info.flags & SDL_RENDERER_PRESENTVSYNC)) {
+        g_game.vsync = false;
+    }
+    sprite_batch_init(g_gfx.renderer, g_game.sprite_batching);
     if (get_first_error()) return;
+    render_queue_init(g_gfx.renderer, g_game.draw_sorting);
 
-    /* set blending mode for food marker*/
-    CHECK_SDL_CALL(SDL_SetTextureBlendMode(g_gfx.txt_food_marker, SDL_BLENDMODE_ADD), "Failed to set texture blend mode");
-
-    /* allocate tile info arrays */
-    if ((g_gfx.ground_tile = calloc(GROUND_TILES, sizeof(SDL_Rect))) == NULL ||
-        (g_gfx.wall_tile = calloc(WALL_TILES, sizeof(SDL_Rect))) == NULL ||
-        (g_gfx.food_tile = calloc(FOOD_TILES, sizeof(SDL_Rect))) == NULL) {
-        set_error("Error: Error allocating memory for tile data.");
-        return;
-    }
-    /* fill tile info arrays */
-    {
-        SDL_Rect ground_tile_temp[GROUND_TILES] = {
-            {0 * TILE_SIZE, 0 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {1 * TILE_SIZE, 0 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {2 * TILE_SIZE, 0 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {3 * TILE_SIZE, 0 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {4 * TILE_SIZE, 0 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {0 * TILE_SIZE, 1 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {0 * TILE_SIZE, 2 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {0 * TILE_SIZE, 3 * TILE_SIZE, TILE_SIZE, TILE_SIZE}
-        };
-        for (int i = 0; i < GROUND_TILES; i++) {
-            g_gfx.ground_tile[i] = ground_tile_temp[i];
-        }
-        SDL_Rect wall_tile_temp[WALL_TILES] = {
-            {0 * TILE_SIZE, 17 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {1 * TILE_SIZE, 17 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {2 * TILE_SIZE, 17 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {3 * TILE_SIZE, 17 * TILE_SIZE, TILE_SIZE, TILE_SIZE}
-        };
-        for (int i = 0; i < WALL_TILES; i++) {
-            g_gfx.wall_tile[i] = wall_tile_temp[i];
-        }
-        SDL_Rect food_tile_temp[FOOD_TILES] = {
-            {4 * TILE_SIZE, 1 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {0 * TILE_SIZE, 4 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {1 * TILE_SIZE, 4 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {2 * TILE_SIZE, 4 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {0 * TILE_SIZE, 6 * TILE_SIZE, TILE_SIZE, TILE_SIZE},
-            {3 * TILE_SIZE, 6 * TILE_SIZE, TILE_SIZE, TILE_SIZE}
-        };
-        for (int i = 0; i < FOOD_TILES; i++) {
-            g_gfx.food_tile[i] = food_tile_temp[i];
-        }
-    }
+    /* everything is drawn from one texture, packed from art/ when building */
+    load_texture(&g_gfx.txt_atlas, RES_DIR ATLAS_FILE);
+    if (get_first_error()) return;
 
     /* init text rendering functionality */
-    init_text_renderer(g_gfx.renderer, g_gfx.txt_font);
+    init_text_renderer(g_gfx.txt_atlas);
     /* Reset game board and generate new background texture. */
     reinit_game_board_resources();
     if (get_first_error()) return;
@@ -201,31 +181,91 @@ static void init_game_engine() {
 void cleanup_game(void) {
     audio_shutdown();
 
-    if (g_game.game_timer) SDL_RemoveTimer(g_game.game_timer);
-
-    if (g_gfx.txt_trophy) SDL_DestroyTexture(g_gfx.txt_trophy);
-    if (g_gfx.txt_logo) SDL_DestroyTexture(g_gfx.txt_logo);
-    if (g_gfx.txt_font) SDL_DestroyTexture(g_gfx.txt_font);
-    if (g_gfx.txt_char_tileset) SDL_DestroyTexture(g_gfx.txt_char_tileset);
-    if (g_gfx.txt_env_tileset) SDL_DestroyTexture(g_gfx.txt_env_tileset);
-    if (g_gfx.txt_food_tileset) SDL_DestroyTexture(g_gfx.txt_food_tileset);
-    if (g_gfx.txt_food_marker) SDL_DestroyTexture(g_gfx.txt_food_marker);
+    if (g_gfx.txt_atlas) SDL_DestroyTexture(g_gfx.txt_atlas);
     if (g_gfx.txt_game_board) SDL_DestroyTexture(g_gfx.txt_game_board);
 
+    render_queue_free();
+    sprite_batch_free();
     if (g_gfx.renderer) SDL_DestroyRenderer(g_gfx.renderer);
     if (g_gfx.screen) SDL_DestroyWindow(g_gfx.screen);
     IMG_Quit();
     SDL_Quit();
 
-    free(g_gfx.food_tile);
-    free(g_gfx.wall_tile);
-    free(g_gfx.ground_tile);
-    free(g_game.game_board);
+    sim_free(&g_game.sim);
+    sim_replay_free(&g_game.replay);
+    sim_rewind_free(&g_game.rewind);
+    sim_autopilot_free(&g_game.autopilot);
+    if (g_game.remote_on) sim_remote_close(&g_game.remote);
+    arena_free();
+}
+
+/* Prints how long turns waited for the tick taking them */
+static void print_input_stats(const SimInputQueue *q) {
+    printf("Turns: %llu taken, %llu dropped (queue of %d), wait %.1f ms on average, %llu ms at most\n",
+           (unsigned long long)q->taken, (unsigned long long)q->dropped, q->depth,
+           (double)q->wait_sum / q->taken, (unsigned long long)q->wait_max);
+    printf("Wait ms:");
+    for (int b = 0; b < SIM_INPUT_WAIT_BUCKETS; b++) {
+        if (b == 0) printf(" 0: %llu", (unsigned long long)q->wait_hist[b]);
+        else if (b < SIM_INPUT_WAIT_BUCKETS - 1) printf(", %d-%d: %llu", 1 << (b - 1), (1 << b) - 1, (unsigned long long)q->wait_hist[b]);
+        else printf(", %d+: %llu", 1 << (b - 1), (unsigned long long)q->wait_hist[b]);
+    }
+    printf("\n");
+}
+
+/* Prints how late the steps of the game clock came and how evenly */
+static void print_clock_stats(const SimClock *c) {
+    printf("Steps: %llu of %.0f ms, %.2f ms late on average, %.2f ms at most, interval off by %.2f ms on average, "
+           "%.2f ms at most, %llu frames caught up more than one, %.0f ms skipped\n",
+           (unsigned long long)c->steps, c->step_ms, c->late_sum_ms / c->steps, c->late_max_ms,
+           c->jitter_sum_ms / (c->steps - 1), c->jitter_max_ms, (unsigned long long)c->bursts, c->skipped_ms);
+    printf("Late ms:");
+    double limit = 0.1;
+    for (int b = 0; b < SIM_CLOCK_LATE_BUCKETS; b++, limit *= 2.0) {
+        if (b == 0) printf(" <%.1f: %llu", limit, (unsigned long long)c->late_hist[b]);
+        else if (b < SIM_CLOCK_LATE_BUCKETS - 1) printf(", %.1f-%.1f: %llu", limit / 2.0, limit, (unsigned long long)c->late_hist[b]);
+        else printf(", %.1f+: %llu", limit / 2.0, (unsigned long long)c->late_hist[b]);
+    }
+    printf("\n");
+}
+
+/* Draws what the render queue holds and shows the frame, drawing started at draw_start */
+static void present_frame(uint64_t draw_start) {
+    render_queue_flush();
+    frame_stats.frames++;
+    frame_stats.draw_ms += (double)(SDL_GetPerformanceCounter() - draw_start) * 1000.0 / SDL_GetPerformanceFrequency();
+    SDL_RenderPresent(g_gfx.renderer);
+}
+
+/* Prints how many sprites a frame had, in how many draw calls, and how long drawing took */
+static void print_frame_stats(void) {
+    const SpriteBatchStats *b = sprite_batch_stats();
+    const RenderQueueStats *q = render_queue_totals();
+    double frames = (double)frame_stats.frames;
+    printf("Frames: %llu, %.1f sprites in %.1f draw calls each (batching %s), %.3f ms to draw on average\n",
+           (unsigned long long)frame_stats.frames, b->sprites / frames,
+           b->draw_calls / frames, sprite_batch_is_batching() ? "on" : "off",
+           frame_stats.draw_ms / frames);
+    printf("State changes per frame (sorting %s): %.1f of texture, %.1f of blend mode, %.1f of color\n",
+           g_game.draw_sorting ? "on" : "off", q->texture_changes / frames, q->blend_changes / frames,
+           q->color_changes / frames);
+}
+
+/* Fps counter with text above it, counts of the last frame below */
+static void render_fps_counter(const char *text) {
+    const RenderQueueStats *q = render_queue_last_frame();
+    char fps_text[160];
+    snprintf(fps_text, sizeof(fps_text), "%s\nCALLS: %llu  CHANGES: %llu TEX %llu BLEND %llu COLOR", text,
+             (unsigned long long)q->draw_calls, (unsigned long long)q->texture_changes,
+             (unsigned long long)q->blend_changes, (unsigned long long)q->color_changes);
+    render_queue_layer(RenderLayerTop);
+    render_text(fps_text, g_game.window_w / 2, g_game.window_h - 1, ALIGN_CENTER_HORIZONTAL, ALIGN_BOTTOM, TEXT_WHITE);
 }
 
 /* renders whole game state and blits everything to screen */
 void display_screen(void)
 {
+    uint64_t draw_start = SDL_GetPerformanceCounter();
     if (g_game.state == MainMenu || g_game.state == OptionsMenu || g_game.state == HallOfFame) {
         /* clear screen with black */
         CHECK_SDL_CALL(SDL_SetRenderDrawColor(g_gfx.renderer, 0,0,0, SDL_ALPHA_OPAQUE), "Failed to set render draw color");
@@ -234,9 +274,9 @@ void display_screen(void)
         if (g_game.fps_counter_on) {
             char fps_text[16];
             snprintf(fps_text, sizeof(fps_text), "FPS: %d", g_game.fps);
-            render_text(g_gfx.renderer, g_gfx.txt_font, fps_text, g_game.window_w / 2, g_game.window_h - 1, ALIGN_CENTER_HORIZONTAL, ALIGN_BOTTOM, TEXT_WHITE);
+            render_fps_counter(fps_text);
         }
-        SDL_RenderPresent(g_gfx.renderer);
+        present_frame(draw_start);
     }
     else if (g_game.state == Playing || g_game.state == Paused || g_game.state == GameOver || g_game.state == EnteringHiscoreName) {
         /* clear screen with black */
@@ -244,11 +284,55 @@ void display_screen(void)
         CHECK_SDL_CALL(SDL_RenderClear(g_gfx.renderer), "Failed to clear renderer");
         render_game_view();
         if (g_game.fps_counter_on) {
-            char fps_text[16];
-            snprintf(fps_text, sizeof(fps_text), "FPS: %d", g_game.fps);
-            render_text(g_gfx.renderer, g_gfx.txt_font, fps_text, g_game.window_w / 2, g_game.window_h - 1, ALIGN_CENTER_HORIZONTAL, ALIGN_BOTTOM, TEXT_WHITE);
+            /* how long turns waited for the tick taking them, on average and at most */
+            const SimInputQueue *q = &g_game.input_queue;
+            char fps_text[64];
+            snprintf(fps_text, sizeof(fps_text), "FPS: %d  TURN WAIT: %d/%d MS", g_game.fps,
+                     q->taken ? (int)(q->wait_sum / q->taken) : 0, (int)q->wait_max);
+            render_fps_counter(fps_text);
         }
-        SDL_RenderPresent(g_gfx.renderer);
+        present_frame(draw_start);
+    }
+}
+
+/*
+ * Moves the game clock one step of RENDER_INTERVAL on: a tick of the game at
+ * the start of every CHAR_ANIM_FRAMES steps, animation phase in between
+ */
+static void step_game_clock(void) {
+    if (g_game.state == Playing && g_game.rewinding) {
+        rewind_play_state(); /* a tick back every step */
+    }
+    else if (g_game.state == Playing && g_game.animation_progress == 0.0f &&
+        !(g_game.remote_on && g_game.remote.stepped)) { /* stepped game waits for requests */
+        update_play_state();
+    }
+    else if (g_game.state == GameOver && g_game.autopilot_on && !g_game.replaying &&
+             g_game.frame - g_game.game_over_frame >= AUTOPILOT_RESTART_FRAMES) {
+        start_play(); /* unattended play, game after game */
+    }
+    if (get_first_error()) return;
+    g_game.frame++;
+    if (g_game.state == Playing && g_game.rewinding) {
+        g_game.frame -= g_game.frame % CHAR_ANIM_FRAMES; /* next tick comes right after rewinding */
+        g_game.animation_progress = 0.0f;
+    }
+    else if (g_game.state == Playing) {
+        g_game.animation_progress = (g_game.frame % CHAR_ANIM_FRAMES)/(double)CHAR_ANIM_FRAMES;
+    }
+}
+
+/* Sets the phase to be drawn, alpha of the current step gone by */
+static void set_render_progress(double alpha) {
+    g_game.step_alpha = (float)alpha;
+    if (g_game.state == Playing && (g_game.rewinding || (g_game.remote_on && g_game.remote.stepped))) {
+        g_game.render_progress = 1.0f; /* no ticks forward to move towards */
+    }
+    else if (g_game.state == Playing) {
+        g_game.render_progress = sim_clock_tick_phase((uint32_t)g_game.frame, CHAR_ANIM_FRAMES, alpha);
+    }
+    else {
+        g_game.render_progress = g_game.animation_progress;
     }
 }
 
@@ -258,11 +342,67 @@ int main(int argc, char ** argv)
     time_t t;
     SDL_Event event;
     g_game.state = NotInitialized;
+    g_game.sprite_batching = true;
+    g_game.draw_sorting = true;
     int frame_count = 0;
     uint32_t fps_timer_start = SDL_GetTicks();
  
-    if (argc > 1 && strcmp(argv[1], "fps") == 0) {
-        g_game.fps_counter_on = true; //enable optional FPS counter
+    const char *replay_path = NULL;
+    bool replay_fast = false;
+    const char *listen_path = NULL;
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "fps") == 0) {
+            g_game.fps_counter_on = true; //enable optional FPS counter
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            replay_fast = true;
+        } else if (strcmp(argv[i], "--no-batching") == 0) {
+            g_game.sprite_batching = false; /* every sprite drawn by itself, to compare */
+        } else if (strcmp(argv[i], "--no-sorting") == 0) {
+            g_game.draw_sorting = false; /* draws made in the order given, to compare */
+        } else if (strcmp(argv[i], "--autopilot") == 0) {
+            g_game.autopilot_on = true;
+        } else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc) {
+            g_game.arena_snakes = atoi(argv[++i]);
+            if (g_game.arena_snakes < 1 || g_game.arena_snakes > SIM_ARENA_MAX_SNAKES) {
+                fprintf(stderr, "Number of snakes in the arena must be 1 to %d\n", SIM_ARENA_MAX_SNAKES);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listen_path = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else {
+            fprintf(stderr, "Usage: %s [fps] [--no-batching] [--no-sorting] [--autopilot] [--arena SNAKES] [--replay FILE [--fast]] "
+                            "[--listen SOCKET [--headless]]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (g_game.arena_snakes > 0 && (replay_path != NULL || listen_path != NULL)) {
+        fprintf(stderr, "The arena can not be replayed or controlled remotely\n");
+        return 1;
+    }
+    if (listen_path != NULL && headless) {
+        return remote_serve_headless(listen_path); /* no window, no rendering */
+    }
+    /* listen before init_game_engine() changes working directory */
+    if (listen_path != NULL && !remote_start(listen_path)) {
+        return 1;
+    }
+    if (replay_path != NULL) {
+        if (replay_fast) {
+            return replays_play_fast(replay_path); /* no window, no rendering */
+        }
+        /* load before init_game_engine() changes working directory */
+        if (!sim_replay_load(&g_game.replay, replay_path)) {
+            fprintf(stderr, "Could not read replay file '%s'\n", replay_path);
+            return 1;
+        }
+        g_game.replaying = true;
+    } else if (!g_game.autopilot_on && !g_game.remote_on && g_game.arena_snakes == 0) {
+        snapshots_load(); /* game left on quitting, read before the window is created */
     }
     srand((unsigned) time(&t));
     init_game_engine();
@@ -270,20 +410,41 @@ int main(int argc, char ** argv)
     // Error is set by init_game_engine, which also sets state to NotInitialized
 
     if (get_first_error() == NULL) {
-        audio_play_idle_music();
-    }
-    /* Start timer for generating SDL_USEREVENT events for screen frame rendering */
-    if (get_first_error() == NULL) {
-        g_game.game_timer = SDL_AddTimer(RENDER_INTERVAL, tick_callback, 0);
-        if (g_game.game_timer == 0) {
-            set_error("Failed to create game timer: %s.", SDL_GetError());
+        if (g_game.replaying) {
+            start_replay();
+        } else if (snapshots_pending() != NULL) {
+            snapshots_resume();
+        } else if (g_game.autopilot_on || g_game.remote_on || g_game.arena_snakes > 0) {
+            start_play();
+        } else {
+            audio_play_idle_music();
         }
     }
+    SimClock game_clock;
+    sim_clock_init(&game_clock, RENDER_INTERVAL, MAX_CATCH_UP_MS);
+    uint64_t perf_freq = SDL_GetPerformanceFrequency();
+    uint64_t clock_last = SDL_GetPerformanceCounter();
+    int refresh_rate = DEFAULT_REFRESH_RATE;
+    SDL_DisplayMode display_mode;
+    if (g_gfx.screen != NULL && SDL_GetWindowDisplayMode(g_gfx.screen, &display_mode) == 0 &&
+        display_mode.refresh_rate > 0) {
+        refresh_rate = display_mode.refresh_rate;
+    }
+    uint64_t frame_period = perf_freq / refresh_rate;
+    uint64_t frame_deadline = clock_last + frame_period; /* when the next frame is due unless vsync paces them */
 
     while (g_game.state != NotInitialized && get_first_error() == NULL) { /* main game loop */
+        if (g_game.remote_on) {
+            remote_poll();
+            if (g_game.remote.shutdown) {
+                g_game.state = NotInitialized;
+                break;
+            }
+        }
         while (SDL_PollEvent(&event) && get_first_error() == NULL) { /* process pending events */
             switch (event.type) {
                 case SDL_QUIT: /* window closed */
+                    snapshots_save(); /* game being played is continued on the next start */
                     g_game.state = NotInitialized;
                     break;
                 case SDL_KEYDOWN:
@@ -291,6 +452,11 @@ int main(int argc, char ** argv)
                         handle_escape_key();
                     }
                     break;
+                case SDL_KEYUP: /* rewinding ends whatever the state is */
+                    if ((SDL_KeyCode)event.key.keysym.sym == g_game.key_rewind) {
+                        g_game.rewinding = false;
+                    }
+                    break;
                 default: /* handle state-specific events */
                     break;
             }
@@ -319,29 +485,43 @@ int main(int argc, char ** argv)
                 default:
                     break;
             }
-            if (event.type == SDL_USEREVENT) {
-                // Always render, regardless of state, to show menus or game
-                if (g_game.state == Playing && g_game.animation_progress == 0.0f) {
-                    update_play_state();
-                }
-                display_screen();
-                if (g_game.fps_counter_on) {
-                    frame_count++;
-                    uint32_t fps_timer_current = SDL_GetTicks();
-                    if (fps_timer_current > fps_timer_start + FPS_COUNT_INTERVAL) {
-                        g_game.fps = (int)((double)(frame_count*1000.)/(double)(fps_timer_current - fps_timer_start)+0.5);
-                        frame_count = 0;
-                        fps_timer_start = fps_timer_current;
-                    }
-                }
-                if (get_first_error()) break;
-                g_game.frame++;
-                if (g_game.state == Playing) {
-                    g_game.animation_progress = (g_game.frame % CHAR_ANIM_FRAMES)/(double)CHAR_ANIM_FRAMES;
-                }
+        }
+        if (g_game.state == NotInitialized || get_first_error()) {
+            break;
+        }
 
+        /* game clock catches up with real time in fixed steps, however long the frames take */
+        uint64_t now = SDL_GetPerformanceCounter();
+        int steps = sim_clock_advance(&game_clock, (double)(now - clock_last) * 1000.0 / perf_freq);
+        clock_last = now;
+        for (int i = 0; i < steps && g_game.state != NotInitialized && get_first_error() == NULL; i++) {
+            step_game_clock();
+        }
+        if (get_first_error()) break;
+        set_render_progress(sim_clock_alpha(&game_clock));
+
+        // Always render, regardless of state, to show menus or game
+        display_screen();
+        if (g_game.fps_counter_on) {
+            frame_count++;
+            uint32_t fps_timer_current = SDL_GetTicks();
+            if (fps_timer_current > fps_timer_start + FPS_COUNT_INTERVAL) {
+                g_game.fps = (int)((double)(frame_count*1000.)/(double)(fps_timer_current - fps_timer_start)+0.5);
+                frame_count = 0;
+                fps_timer_start = fps_timer_current;
             }
         }
+        /* without a refresh to wait for (also while the window is hidden) sleep to the next deadline */
+        now = SDL_GetPerformanceCounter();
+        if ((!g_game.vsync || (SDL_GetWindowFlags(g_gfx.screen) & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN))) &&
+            now < frame_deadline) {
+            sim_sleep_precise((double)(frame_deadline - now) * 1000.0 / perf_freq, SLEEP_SPIN_MS);
+            now = frame_deadline;
+        }
+        frame_deadline += frame_period;
+        if (frame_deadline <= now) {
+            frame_deadline = now + frame_period; /* missed frames are not made up for, the clock caught up already */
+        }
     }
 
     if (get_first_error() && g_gfx.screen == NULL) {
@@ -353,6 +533,15 @@ int main(int argc, char ** argv)
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Vonsh Error", get_first_error(), g_gfx.screen);
     }
 
+    if (g_game.fps_counter_on && g_game.input_queue.taken > 0) {
+        print_input_stats(&g_game.input_queue);
+    }
+    if (g_game.fps_counter_on && game_clock.steps > 1) {
+        print_clock_stats(&game_clock);
+    }
+    if (g_game.fps_counter_on && frame_stats.frames > 0) {
+        print_frame_stats();
+    }
     cleanup_game();
 
     return get_first_error() ? 1 : 0;
@@ -0,0 +1,335 @@
+/*
+ * atlas_pack: packs the sprites listed in a sprite list (art/sprites.txt)
+ * into one texture atlas, so that the game draws everything from a single
+ * texture. Writes the atlas PNG and, for the code, OUT.c and OUT.h with the
+ * rectangle of every sprite in the atlas. Run by the Makefile:
+ *
+ *   atlas_pack SPRITE_LIST ATLAS_PNG OUT
+ *
+ * Sprites are placed tallest first on a skyline (lowest free spot, leftmost
+ * of equal ones), a transparent pixel apart so that filtering never bleeds
+ * one into another. Of the widths tried the one giving the smallest atlas is
+ * kept. A sprite given a tint has its colors multiplied by it, as the color
+ * modulation of a texture would do when drawing.
+ */
+#define SDL_MAIN_HANDLED
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#define MAX_SPRITES (1024)
+#define MAX_IMAGES (64)
+#define NAME_LEN (32)
+#define PATH_LEN (1024)
+#define PADDING (1) /* transparent pixels between sprites */
+#define MAX_ATLAS_SIDE (4096) /* textures up to this size are supported by any renderer the game runs on */
+
+typedef struct {
+    char name[NAME_LEN];
+    int image; /* index in images */
+    SDL_Rect src; /* in the image */
+    SDL_Rect dst; /* in the atlas */
+    SDL_Color tint; /* colors are multiplied by, white keeps them */
+    int line; /* of the sprite list */
+} Sprite;
+
+typedef struct {
+    char file[PATH_LEN];
+    SDL_Surface *surface; /* RGBA32 */
+} Image;
+
+typedef struct {
+    int x, y, w; /* segment of the skyline: top y of the columns x to x + w - 1 */
+} Segment;
+
+static Sprite sprites[MAX_SPRITES];
+static int sprite_count = 0;
+static Image images[MAX_IMAGES];
+static int image_count = 0;
+
+static void fail(const char *fmt, const char *arg) {
+    fprintf(stderr, "atlas_pack: ");
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+/* Index of the image in file (relative to dir), loaded on first use */
+static int image_index(const char *dir, const char *file) {
+    for (int i = 0; i < image_count; i++) {
+        if (strcmp(images[i].file, file) == 0) return i;
+    }
+    if (image_count == MAX_IMAGES) fail("too many images, at most %s", "64");
+    char path[2 * PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    SDL_Surface *loaded = IMG_Load(path);
+    if (loaded == NULL) fail("cannot load %s", path);
+    SDL_Surface *rgba = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (rgba == NULL) fail("cannot convert %s", path);
+    snprintf(images[image_count].file, PATH_LEN, "%s", file);
+    images[image_count].surface = rgba;
+    return image_count++;
+}
+
+static bool is_name(const char *s) {
+    if (!islower((unsigned char)*s)) return false;
+    for (; *s; s++) {
+        if (!islower((unsigned char)*s) && !isdigit((unsigned char)*s) && *s != '_') return false;
+    }
+    return true;
+}
+
+/* Reads the sprite list at path, images are found next to it */
+static void read_sprite_list(const char *path) {
+    char dir[PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL) *slash = '\0';
+    else strcpy(dir, ".");
+
+    FILE *f = fopen(path, "r");
+    if (f == NULL) fail("cannot open %s", path);
+    char line[2 * PATH_LEN], name[NAME_LEN], file[PATH_LEN];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash != NULL) *hash = '\0';
+        int used = 0, more = 0;
+        int n = sscanf(line, "%31s %1023s%n", name, file, &used);
+        if (n <= 0) continue;
+        if (n != 2 || !is_name(name)) fail("bad line in the sprite list: %s", line);
+        /* optional rectangle and tint */
+        const char *rest = line + used;
+        SDL_Rect r;
+        bool whole = sscanf(rest, " %d %d %d %d%n", &r.x, &r.y, &r.w, &r.h, &more) != 4;
+        if (!whole) rest += more;
+        int tr = 255, tg = 255, tb = 255;
+        if (sscanf(rest, " tint %d %d %d%n", &tr, &tg, &tb, &more) == 3) rest += more;
+        while (isspace((unsigned char)*rest)) rest++;
+        if (*rest != '\0' || tr < 0 || tg < 0 || tb < 0 || tr > 255 || tg > 255 || tb > 255) {
+            fail("bad line in the sprite list: %s", line);
+        }
+        if (sprite_count == MAX_SPRITES) fail("too many sprites, at most %s", "1024");
+        Sprite *s = &sprites[sprite_count++];
+        snprintf(s->name, NAME_LEN, "%s", name);
+        s->image = image_index(dir, file);
+        s->line = line_no;
+        s->tint = (SDL_Color){ (Uint8)tr, (Uint8)tg, (Uint8)tb, 255 };
+        const SDL_Surface *img = images[s->image].surface;
+        if (whole) {
+            r = (SDL_Rect){ 0, 0, img->w, img->h };
+        }
+        if (r.x < 0 || r.y < 0 || r.w <= 0 || r.h <= 0 || r.x + r.w > img->w || r.y + r.h > img->h) {
+            fail("sprite outside of its image: %s", line);
+        }
+        s->src = r;
+    }
+    fclose(f);
+    if (sprite_count == 0) fail("no sprites in %s", path);
+}
+
+/* Tallest first, then widest, then in the order of the list */
+static int cmp_sprites(const void *a, const void *b) {
+    const Sprite *sa = *(Sprite *const *)a, *sb = *(Sprite *const *)b;
+    if (sa->src.h != sb->src.h) return sb->src.h - sa->src.h;
+    if (sa->src.w != sb->src.w) return sb->src.w - sa->src.w;
+    return (int)(sa - sb);
+}
+
+/*
+ * Places the sprites in order on a skyline width pixels wide. Returns the
+ * height of the atlas, or 0 if a sprite is wider.
+ */
+static int pack(Sprite **order, int width) {
+    static Segment sky[MAX_SPRITES + 2];
+    int n = 1, height = 0;
+    sky[0] = (Segment){ 0, 0, width };
+    for (int k = 0; k < sprite_count; k++) {
+        int w = order[k]->src.w + PADDING, h = order[k]->src.h + PADDING;
+        int best = -1, best_y = 0;
+        for (int i = 0; i < n; i++) {
+            if (sky[i].x + w > width) break;
+            /* top of the skyline under the sprite placed at segment i */
+            int y = 0;
+            for (int j = i, left = w; left > 0; left -= sky[j++].w) {
+                if (sky[j].y > y) y = sky[j].y;
+            }
+            if (best < 0 || y < best_y) {
+                best = i;
+                best_y = y;
+            }
+        }
+        if (best < 0) return 0;
+        int x = sky[best].x;
+        order[k]->dst = (SDL_Rect){ x, best_y, order[k]->src.w, order[k]->src.h };
+        if (best_y + h > height) height = best_y + h;
+
+        /* the segments under the sprite give way to one on top of it */
+        int end = best;
+        while (end < n && sky[end].x + sky[end].w <= x + w) end++;
+        Segment rest = { 0, 0, 0 };
+        if (end < n && sky[end].x < x + w) {
+            rest = (Segment){ x + w, sky[end].y, sky[end].x + sky[end].w - (x + w) };
+            end++;
+        }
+        int added = 1 + (rest.w > 0);
+        memmove(&sky[best + added], &sky[end], (size_t)(n - end) * sizeof(Segment));
+        n += added - (end - best);
+        sky[best] = (Segment){ x, best_y + h, w };
+        if (rest.w > 0) sky[best + 1] = rest;
+        /* neighbours of the same height join */
+        for (int i = (best > 0 ? best - 1 : 0); i + 1 < n && i <= best + 1; ) {
+            if (sky[i].y == sky[i + 1].y) {
+                sky[i].w += sky[i + 1].w;
+                memmove(&sky[i + 1], &sky[i + 2], (size_t)(n - i - 2) * sizeof(Segment));
+                n--;
+            } else {
+                i++;
+            }
+        }
+    }
+    return height - PADDING;
+}
+
+/*
+ * Packs the sprites at every power of two width from the widest sprite up,
+ * and at that width itself, keeping the smallest atlas. Returns its size.
+ */
+static void pack_smallest(int *atlas_w, int *atlas_h) {
+    Sprite *order[MAX_SPRITES];
+    int widest = 0;
+    for (int i = 0; i < sprite_count; i++) {
+        order[i] = &sprites[i];
+        if (sprites[i].src.w > widest) widest = sprites[i].src.w;
+    }
+    qsort(order, (size_t)sprite_count, sizeof(order[0]), cmp_sprites);
+
+    long best_area = 0;
+    int best_w = 0;
+    for (int width = widest + PADDING, pow2 = 1; width <= MAX_ATLAS_SIDE + PADDING; ) {
+        int height = pack(order, width);
+        int used_w = 0;
+        for (int i = 0; i < sprite_count; i++) {
+            if (sprites[i].dst.x + sprites[i].dst.w > used_w) used_w = sprites[i].dst.x + sprites[i].dst.w;
+        }
+        if (height > 0 && height <= MAX_ATLAS_SIDE && (best_w == 0 || (long)used_w * height < best_area)) {
+            best_area = (long)used_w * height;
+            best_w = width;
+        }
+        while (pow2 <= width) pow2 *= 2;
+        width = pow2;
+    }
+    if (best_w == 0) fail("sprites do not fit in a %s pixel square", "4096");
+    *atlas_h = pack(order, best_w);
+    *atlas_w = 0;
+    for (int i = 0; i < sprite_count; i++) {
+        if (sprites[i].dst.x + sprites[i].dst.w > *atlas_w) *atlas_w = sprites[i].dst.x + sprites[i].dst.w;
+    }
+}
+
+static void write_atlas(const char *path, int w, int h) {
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+    if (atlas == NULL) fail("cannot create the atlas: %s", SDL_GetError());
+    for (int y = 0; y < h; y++) memset((Uint8 *)atlas->pixels + y * atlas->pitch, 0, (size_t)w * 4);
+    for (int i = 0; i < sprite_count; i++) {
+        const Sprite *s = &sprites[i];
+        const SDL_Surface *img = images[s->image].surface;
+        for (int y = 0; y < s->src.h; y++) {
+            Uint8 *to = (Uint8 *)atlas->pixels + (s->dst.y + y) * atlas->pitch + s->dst.x * 4;
+            memcpy(to, (const Uint8 *)img->pixels + (s->src.y + y) * img->pitch + s->src.x * 4, (size_t)s->src.w * 4);
+            if (s->tint.r == 255 && s->tint.g == 255 && s->tint.b == 255) continue;
+            for (int x = 0; x < s->src.w; x++, to += 4) {
+                /* RGBA32 is R, G, B, A in memory */
+                to[0] = (Uint8)(to[0] * s->tint.r / 255);
+                to[1] = (Uint8)(to[1] * s->tint.g / 255);
+                to[2] = (Uint8)(to[2] * s->tint.b / 255);
+            }
+        }
+    }
+    if (IMG_SavePNG(atlas, path) != 0) fail("cannot write the atlas: %s", SDL_GetError());
+    SDL_FreeSurface(atlas);
+}
+
+/* Sprites named the same as sprite i, and whether it is the first of them */
+static int name_count(int i, bool *first) {
+    int count = 0;
+    *first = true;
+    for (int j = 0; j < sprite_count; j++) {
+        if (strcmp(sprites[j].name, sprites[i].name) != 0) continue;
+        if (j < i) *first = false;
+        count++;
+    }
+    return count;
+}
+
+static void write_manifest(const char *out, const char *list_path, const char *atlas_path, int w, int h) {
+    char path[PATH_LEN + 2];
+    const char *base = strrchr(out, '/') ? strrchr(out, '/') + 1 : out;
+    const char *atlas_file = strrchr(atlas_path, '/') ? strrchr(atlas_path, '/') + 1 : atlas_path;
+    char guard[NAME_LEN + 8];
+    snprintf(guard, sizeof(guard), "%s_H", base);
+    for (char *p = guard; *p; p++) *p = isalnum((unsigned char)*p) ? (char)toupper((unsigned char)*p) : '_';
+
+    snprintf(path, sizeof(path), "%s.h", out);
+    FILE *hf = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s.c", out);
+    FILE *cf = fopen(path, "w");
+    if (hf == NULL || cf == NULL) fail("cannot write %s", out);
+
+    fprintf(hf, "/* Generated by atlas_pack from %s, do not edit */\n", list_path);
+    fprintf(hf, "#ifndef %s\n#define %s\n\n#include <SDL2/SDL.h>\n\n", guard, guard);
+    fprintf(hf, "#define ATLAS_FILE \"%s\"\n#define ATLAS_WIDTH (%d)\n#define ATLAS_HEIGHT (%d)\n\n", atlas_file, w, h);
+    fprintf(cf, "/* Generated by atlas_pack from %s, do not edit */\n#include \"%s.h\"\n", list_path, base);
+    for (int i = 0; i < sprite_count; i++) {
+        bool first;
+        int count = name_count(i, &first);
+        if (!first) continue;
+        char upper[NAME_LEN];
+        for (int k = 0; k < NAME_LEN; k++) upper[k] = (char)toupper((unsigned char)sprites[i].name[k]);
+        if (count == 1) {
+            const SDL_Rect *r = &sprites[i].dst;
+            fprintf(hf, "extern const SDL_Rect atlas_%s;\n", sprites[i].name);
+            fprintf(cf, "\nconst SDL_Rect atlas_%s = { %d, %d, %d, %d };\n", sprites[i].name, r->x, r->y, r->w, r->h);
+            continue;
+        }
+        fprintf(hf, "#define ATLAS_%s_COUNT (%d)\nextern const SDL_Rect atlas_%s[ATLAS_%s_COUNT];\n",
+                upper, count, sprites[i].name, upper);
+        fprintf(cf, "\nconst SDL_Rect atlas_%s[ATLAS_%s_COUNT] = {\n", sprites[i].name, upper);
+        for (int j = i; j < sprite_count; j++) {
+            if (strcmp(sprites[j].name, sprites[i].name) != 0) continue;
+            const SDL_Rect *r = &sprites[j].dst;
+            fprintf(cf, "    { %d, %d, %d, %d }, /* %s line %d */\n", r->x, r->y, r->w, r->h, list_path, sprites[j].line);
+        }
+        fprintf(cf, "};\n");
+    }
+    fprintf(hf, "\n#endif // %s\n", guard);
+    bool ok = !ferror(hf) && !ferror(cf);
+    ok = (fclose(hf) == 0) && ok;
+    ok = (fclose(cf) == 0) && ok;
+    if (!ok) fail("cannot write %s", out);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s SPRITE_LIST ATLAS_PNG OUT\n", argv[0]);
+        return 1;
+    }
+    read_sprite_list(argv[1]);
+    int w, h;
+    pack_smallest(&w, &h);
+    write_atlas(argv[2], w, h);
+    write_manifest(argv[3], argv[1], argv[2], w, h);
+
+    long sprite_area = 0;
+    for (int i = 0; i < sprite_count; i++) sprite_area += (long)sprites[i].src.w * sprites[i].src.h;
+    printf("%s: %dx%d, %d sprites from %d images, %.0f%% of it covered\n",
+           argv[2], w, h, sprite_count, image_count, 100.0 * sprite_area / ((long)w * h));
+    for (int i = 0; i < image_count; i++) SDL_FreeSurface(images[i].surface);
+    return 0;
+}